@@ -24,6 +24,11 @@ static Accel_t* ACCEL = (Accel_t*)&accel;
 
 static thread_t *accelThd = 0;
 static KXTJ3_1057Driver accd;
+// bus lock, the driver does it's own transfers while we hold the bus
+static I2cBusJob_t accelBusLock = {
+  .i2cp = &I2CD1,
+  .client = i2cClient_Accel
+};
 
 static KXTJ3_1057Config acccfg = {
    &I2CD1,
@@ -47,7 +52,9 @@ THD_WORKING_AREA(waAccelThd, 128);
 THD_FUNCTION(AccelThd, arg) {
   (void)arg;
 
+  i2cBusAcquire(&accelBusLock);
   KXTJ3_1057Start(&accd, &acccfg);
+  i2cBusRelease(&accelBusLock);
 
   int16_t values[3] = {0,0,0};
 
@@ -56,7 +63,9 @@ THD_FUNCTION(AccelThd, arg) {
   while (true) {
     chThdSleep(TIME_US2I(10000));
     if (settings.accelerometer_active) {
-      KXTJ3_1057AccelerometerReadRaw(&accd, values);
+      i2cBusAcquire(&accelBusLock);
+      accelBusLock.result = KXTJ3_1057AccelerometerReadRaw(&accd, values);
+      i2cBusRelease(&accelBusLock);
       if ((diagSetValues & diag_Set_InputAcc0) == 0)
         ACCEL->axis[0] = values[0];
       if ((diagSetValues & diag_Set_InputAcc1) == 0)
@@ -87,7 +96,7 @@ void accelInit(void) {
 
 void accelStart(void) {
   // create a thread
-  accelThd = chThdCreate(&accelThdDesc);
+  accelThd = addThdAndCreate(&accelThdDesc);
 }
 
 void accelSettingsChanged(void) { }
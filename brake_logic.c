@@ -14,6 +14,10 @@
 #include "threads.h"
 #include "inputs.h"
 #include "diag.h"
+#include "capture.h"
+#include "session.h"
+#include "logger.h"
+#include "profile.h"
 
 /* it should only be possible to brake this much every 10ms loop
  * else its that all wheels have locked up
@@ -119,9 +123,9 @@ static void calcBrakeForce(void) {
             ((values.speedOnGround - inputs.wheelRPS[ch]) * 1000)
                             / values.speedOnGround;
         uint32_t vlu = force;
-        if (values.slip[ch] > 200) {
+        if (values.slip[ch] > BRAKE_ABS_SLIP_THRESHOLD) {
             // only regulate when above 20% slip, like a car does
-            uint32_t release = values.slip[ch] - 200;
+            uint32_t release = values.slip[ch] - BRAKE_ABS_SLIP_THRESHOLD;
             release *= release; // power of 2
             release >>= 2; // divide by 4
 
@@ -143,7 +147,8 @@ static void calcBrakeForce(void) {
   }
 }
 
-static THD_WORKING_AREA(waBrakeLogicThd, 128);
+// diag stream goes all the way down into the USB driver each lap
+static THD_WORKING_AREA(waBrakeLogicThd, 192);
 static THD_FUNCTION(BrakeLogicThd, arg) {
   (void)arg;
 
@@ -172,6 +177,9 @@ static THD_FUNCTION(BrakeLogicThd, arg) {
       setOut(2, 0);
     } else {
 
+      // brakes just applied, logger switches to fast rate now
+      if (sleepTime != 5 && settings.logAdaptive)
+        loggerWakeup();
       sleepTime = 5; // recalculate every 5ms now (200 times a sec)
 
       // the ABS logic
@@ -211,6 +219,15 @@ static THD_FUNCTION(BrakeLogicThd, arg) {
     if (settings.Brake2_active)
       pwmoutSetDuty(brake2, values.brakeForce_out[2]);
 
+    // uptime must be counted before systime wraps
+    threadsUptimeMs();
+
+    // store this lap for brake event captures
+    captureSample();
+    sessionSample();
+    diagSample();
+    profileSample();
+
   } // end while loop
 }
 
@@ -232,7 +249,7 @@ void brakeLogicInit(void) {
 }
 
 void brakeLogicStart(void) {
-  brklogicp = chThdCreate(&brakeLogicThdDesc);
+  brklogicp = addThdAndCreate(&brakeLogicThdDesc);
 }
 
 void brakeLogicSettingsChanged(void) {
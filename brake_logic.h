@@ -33,6 +33,9 @@ typedef struct {
 
 } Values_t;
 
+// slip in permille where ABS starts to release a brake
+#define BRAKE_ABS_SLIP_THRESHOLD  200U
+
 extern volatile const Values_t values;
 
 void brakeLogicInit(void);
@@ -0,0 +1,301 @@
+/*
+ * capture.c
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#include "capture.h"
+#include "eeprom.h"
+#include "inputs.h"
+#include "brake_logic.h"
+#include "logger.h"
+#include "i2c_bus.h"
+#include "threads.h"
+#include "crc.h"
+#include "usbcfg.h"
+#include <ch.h>
+
+#if CAPTURE_SAMPLES > 0
+
+/*
+ * Memory structure for captures:
+ * slot .. CaptureHeader_t, samples oldest first, unused
+ * slot .. CaptureHeader_t, samples oldest first, unused
+ * ....
+ * each slot is a whole number of pages, slots are used round robin and
+ * the one with highest seq is the newest. Samples are written before
+ * the header, a torn write leaves a header whose crc doesn't match.
+ */
+
+_Static_assert(sizeof(CaptureHeader_t) == CAPTURE_HEADER_SIZE,
+               "CAPTURE_HEADER_SIZE is wrong");
+
+#define SLOT_PAGES \
+  ((CAPTURE_SLOT_SIZE + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE)
+#define SLOT_SIZE  (SLOT_PAGES * EEPROM_PAGE_SIZE)
+#define SLOT_CNT   (EEPROM_CAPTURE_SIZE / SLOT_SIZE)
+
+_Static_assert(SLOT_CNT > 0, "Capture region too small for one capture");
+
+typedef enum {
+  ringArmed,  // sampling, waiting for a trigger
+  ringPost,   // triggered, sampling what comes after
+  ringFrozen  // waiting to be written to EEPROM
+} RingState_e;
+
+// ---------------------------------------------------------------
+// private stuff for this module
+
+// only touched by brake loop, except when frozen
+static CaptureSample_t ring[CAPTURE_SAMPLES];
+static uint8_t head;        // next sample goes here
+static uint8_t filled;      // samples taken since armed, max CAPTURE_SAMPLES
+static uint8_t postLeft;    // samples left to take after trigger
+static systime_t lastAt;    // when sample before was taken
+static bool wasStill = true,
+            wasReleasing,
+            wasDecel;
+static CaptureHeader_t hdr; // for the capture being taken or frozen
+static volatile uint8_t state = ringArmed;
+
+// guards slots, used from logger thread and comms jobs
+static semaphore_t slotSem;
+static bool slotsScanned;
+static uint8_t nextSlot;
+static uint32_t nextSeq;
+static ee24_arg_t arg = {&capture_ee, 0, NULL, 0, 0, {0, 0}, i2cClient_Logger};
+
+static uint8_t maxRPS(const CaptureSample_t *s) {
+  uint8_t rps = s->wheelRPS[0];
+  if (rps < s->wheelRPS[1])
+    rps = s->wheelRPS[1];
+  if (rps < s->wheelRPS[2])
+    rps = s->wheelRPS[2];
+  return rps;
+}
+
+static uint8_t checkTrigger(const CaptureSample_t *s) {
+  uint8_t trig = captureTrig_None;
+
+  // ABS releases a brake when slip goes above threshold
+  bool releasing = false;
+  for (uint8_t ch = 0; ch < 3; ++ch)
+    if (values.slip[ch] > BRAKE_ABS_SLIP_THRESHOLD)
+      releasing = true;
+  if (releasing && !wasReleasing)
+    trig = captureTrig_ABS;
+  wasReleasing = releasing;
+
+  const bool still = values.speedOnGround == 0;
+  if (!still && wasStill)
+    trig = captureTrig_Touchdown;
+  wasStill = still;
+
+  bool decel = false;
+  if (filled >= CAPTURE_DECEL_SAMPLES) {
+    const uint8_t idx = (head + CAPTURE_SAMPLES - CAPTURE_DECEL_SAMPLES) %
+                           CAPTURE_SAMPLES;
+    const uint8_t before = maxRPS(&ring[idx]), now = maxRPS(s);
+    decel = before > now && (uint8_t)(before - now) >= CAPTURE_DECEL_RPS;
+  }
+  if (decel && !wasDecel)
+    trig = captureTrig_HardDecel;
+  wasDecel = decel;
+
+  return trig;
+}
+
+static void takeSample(CaptureSample_t *s) {
+  const systime_t now = chVTGetSystemTimeX();
+  const uint32_t dt = TIME_I2MS(chTimeDiffX(lastAt, now));
+  lastAt = now;
+
+  s->dt = dt < 0xFF ? (uint8_t)dt : 0xFF;
+  s->brakeForce = values.brakeForce;
+  for (uint8_t ch = 0; ch < 3; ++ch) {
+    s->brakeForce_out[ch] = values.brakeForce_out[ch];
+    s->wheelRPS[ch] = inputs.wheelRPS[ch];
+    // 0-1000 permille to 0-250
+    s->slip[ch] = values.slip[ch] < 1000 ? values.slip[ch] / 4 : 250;
+  }
+  s->speedOnGround = values.speedOnGround;
+  s->acceleration = (int8_t)(values.acceleration / 64);
+}
+
+/**
+ * @brief write len bytes to capture region, any length
+ */
+static msg_t writeBytes(uint32_t offset, uint8_t *buf, uint32_t len) {
+  msg_t msg = MSG_OK;
+  arg.offset = offset;
+  arg.buf = buf;
+  while (len > 0 && msg == MSG_OK) {
+    arg.len = len < EEPROM_PAGE_SIZE ? len : EEPROM_PAGE_SIZE;
+    msg = ee24m01r_write(&arg);
+    arg.offset += arg.len;
+    arg.buf += arg.len;
+    len -= arg.len;
+  }
+  return msg;
+}
+
+/**
+ * @brief find slot after the newest capture, from the slot headers
+ */
+static msg_t scanSlots(void) {
+  CaptureHeader_t h;
+  uint32_t newest = 0;
+  nextSlot = 0;
+
+  arg.buf = (uint8_t*)&h;
+  arg.len = sizeof(h);
+  for (uint8_t i = 0; i < SLOT_CNT; ++i) {
+    arg.offset = (uint32_t)i * SLOT_SIZE;
+    const msg_t msg = ee24m01r_read(&arg);
+    if (msg != MSG_OK)
+      return msg;
+
+    // erased or never written slots fail these
+    if (h.sampleSize != sizeof(CaptureSample_t) || h.samples == 0 ||
+        h.samples > CAPTURE_SAMPLES || h.preSamples >= h.samples)
+    {
+      continue;
+    }
+    const uint32_t seq = (uint32_t)h.seq[0] << 24 | (uint32_t)h.seq[1] << 16 |
+                         (uint32_t)h.seq[2] << 8 | h.seq[3];
+    if (seq >= newest) {
+      newest = seq;
+      nextSlot = (i + 1) % SLOT_CNT;
+    }
+  }
+  nextSeq = newest + 1;
+  slotsScanned = true;
+  return MSG_OK;
+}
+
+/**
+ * @brief write frozen ring to next slot, samples first, header last
+ */
+static msg_t writeSlot(void) {
+  const uint32_t slot = (uint32_t)nextSlot * SLOT_SIZE;
+  const uint8_t first = (head + CAPTURE_SAMPLES - hdr.samples) % CAPTURE_SAMPLES;
+  // ring wraps at most once
+  const uint8_t cnt1 = first + hdr.samples > CAPTURE_SAMPLES ?
+                         CAPTURE_SAMPLES - first : hdr.samples,
+                cnt2 = hdr.samples - cnt1;
+
+  TO_BIG_ENDIAN_32(hdr.seq, nextSeq);
+  uint8_t crc = crc8((uint8_t*)&hdr, sizeof(hdr) - 1);
+  crc = crc8Update(crc, (uint8_t*)&ring[first], cnt1 * sizeof(ring[0]));
+  crc = crc8Update(crc, (uint8_t*)&ring[0], cnt2 * sizeof(ring[0]));
+  hdr.crc = crc;
+
+  msg_t msg = writeBytes(slot + sizeof(hdr), (uint8_t*)&ring[first],
+                         cnt1 * sizeof(ring[0]));
+  if (msg == MSG_OK && cnt2 > 0)
+    msg = writeBytes(slot + sizeof(hdr) + cnt1 * sizeof(ring[0]),
+                     (uint8_t*)&ring[0], cnt2 * sizeof(ring[0]));
+  if (msg == MSG_OK)
+    msg = writeBytes(slot, (uint8_t*)&hdr, sizeof(hdr));
+
+  // move on even if write failed, slot might be bad
+  nextSlot = (nextSlot + 1) % SLOT_CNT;
+  ++nextSeq;
+  return msg;
+}
+
+// ---------------------------------------------------------------
+// public stuff for this module
+
+void captureSample(void) {
+  if (state == ringFrozen)
+    return;
+
+  CaptureSample_t *s = &ring[head];
+  takeSample(s);
+
+  if (state == ringArmed) {
+    const uint8_t trig = checkTrigger(s);
+    if (filled < CAPTURE_SAMPLES)
+      ++filled;
+    if (trig != captureTrig_None) {
+      hdr.trigger = trig;
+      hdr.preSamples = filled <= CAPTURE_PRE_SAMPLES ?
+                         (uint8_t)(filled - 1) : CAPTURE_PRE_SAMPLES;
+      hdr.samples = hdr.preSamples;
+      // systime wraps every 6.5s, trigger time needs uptime
+      const uint32_t ms = threadsUptimeMs();
+      TO_BIG_ENDIAN_32(hdr.timeMs, ms);
+      postLeft = CAPTURE_SAMPLES - CAPTURE_PRE_SAMPLES;
+      state = ringPost;
+    }
+  }
+
+  head = (head + 1) % CAPTURE_SAMPLES;
+
+  if (state == ringPost) {
+    ++hdr.samples;
+    if (--postLeft == 0) {
+      state = ringFrozen;
+      loggerWakeup();
+    }
+  }
+}
+
+msg_t captureFlush(void) {
+  if (state != ringFrozen)
+    return MSG_OK;
+  // host is reading captures, try again later
+  if (chSemWaitTimeout(&slotSem, TIME_IMMEDIATE) != MSG_OK)
+    return MSG_OK;
+
+  msg_t msg = MSG_OK;
+  if (!slotsScanned)
+    msg = scanSlots();
+  if (msg == MSG_OK) {
+    hdr.sampleSize = sizeof(CaptureSample_t);
+    msg = writeSlot();
+  }
+  chSemSignal(&slotSem);
+
+  // pre trigger samples start over with an empty ring
+  filled = 0;
+  state = ringArmed;
+  return msg;
+}
+
+void captureReadAll(usbpkg_t *sndpkg) {
+  chSemWait(&slotSem);
+  msg_t msg = slotsScanned ? MSG_OK : scanSlots();
+  if (msg == MSG_OK)
+    msg = loggerSendPartition(sndpkg, &capture_ee,
+                              (uint32_t)nextSlot * SLOT_SIZE);
+  chSemSignal(&slotSem);
+
+  INIT_PKG(*sndpkg,
+           msg == MSG_OK ? commsCmd_OK : commsCmd_Error,
+           sndpkg->onefrm.reqId);
+  usbWaitTransmit(sndpkg);
+}
+
+void captureInit(void) {
+  chSemObjectInit(&slotSem, 1);
+  lastAt = chVTGetSystemTimeX();
+}
+
+#else
+
+void captureSample(void) {}
+
+msg_t captureFlush(void) {
+  return MSG_OK;
+}
+
+void captureReadAll(usbpkg_t *sndpkg) {
+  commsSendNowWithCmd(sndpkg, commsCmd_Error);
+}
+
+void captureInit(void) {}
+
+#endif /* CAPTURE_SAMPLES > 0 */
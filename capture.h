@@ -0,0 +1,103 @@
+/*
+ * capture.h
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+#include "comms.h"
+#include <chtypes.h>
+
+/*
+ * Brake event capture. The brake loop stores a sample each lap in a
+ * RAM ring, when a trigger fires the samples before it and the
+ * samples after it are frozen and written to the capture region in
+ * EEPROM by the logger thread.
+ */
+
+// RAM used by the ring is CAPTURE_SAMPLES * sizeof(CaptureSample_t),
+// 0 removes capture altogether
+#ifndef CAPTURE_SAMPLES
+# define CAPTURE_SAMPLES       40U
+#endif
+
+// how many of the samples that are from before the trigger
+#ifndef CAPTURE_PRE_SAMPLES
+# define CAPTURE_PRE_SAMPLES   (CAPTURE_SAMPLES / 2U)
+#endif
+
+// wheel speed must drop this many revs/sec within
+// CAPTURE_DECEL_SAMPLES samples to count as a hard decel
+#ifndef CAPTURE_DECEL_RPS
+# define CAPTURE_DECEL_RPS     10U
+#endif
+#ifndef CAPTURE_DECEL_SAMPLES
+# define CAPTURE_DECEL_SAMPLES 4U
+#endif
+
+#if CAPTURE_SAMPLES > 255U || \
+    (CAPTURE_SAMPLES > 0 && CAPTURE_PRE_SAMPLES >= CAPTURE_SAMPLES)
+# error "CAPTURE_PRE_SAMPLES must be less than CAPTURE_SAMPLES, max 255"
+#endif
+
+typedef enum {
+  captureTrig_None      = 0,
+  captureTrig_ABS       = 1, // ABS started to release a brake
+  captureTrig_Touchdown = 2, // wheels spun up from stand still
+  captureTrig_HardDecel = 3, // wheel speed dropped fast
+} CaptureTrigger_e;
+
+/**
+ * @brief one lap in brake loop, all values fit in a byte
+ */
+typedef struct {
+  uint8_t dt;                 // ms since sample before
+  uint8_t brakeForce;         // wanted brake force
+  uint8_t brakeForce_out[3];
+  uint8_t speedOnGround;
+  uint8_t wheelRPS[3];
+  uint8_t slip[3];            // slip in 0.4% steps, 250 is 100%
+  int8_t acceleration;        // values.acceleration / 64
+} CaptureSample_t;
+
+/**
+ * @brief first in each capture slot in EEPROM, samples follow
+ * crc covers the header up to crc and all samples
+ */
+typedef struct {
+  uint8_t seq[4];       // big endian, increments for each capture
+  uint8_t timeMs[4];    // big endian, ms since boot at trigger
+  uint8_t trigger;      // CaptureTrigger_e
+  uint8_t preSamples;   // samples before the trigger sample
+  uint8_t samples;      // samples stored after header
+  uint8_t sampleSize;   // sizeof(CaptureSample_t)
+  uint8_t crc;
+} CaptureHeader_t;
+
+#define CAPTURE_HEADER_SIZE  13U
+#define CAPTURE_SLOT_SIZE \
+  (CAPTURE_HEADER_SIZE + CAPTURE_SAMPLES * sizeof(CaptureSample_t))
+
+void captureInit(void);
+
+/**
+ * @brief sample values, called from brake loop each lap
+ */
+void captureSample(void);
+
+/**
+ * @brief write a frozen capture to EEPROM, called by logger thread
+ * @returns MSG_OK also when there was nothing to write
+ */
+msg_t captureFlush(void);
+
+/**
+ * @brief send whole capture region to host
+ */
+void captureReadAll(usbpkg_t *sndpkg);
+
+#endif /* CAPTURE_H_ */
@@ -9,7 +9,11 @@
 #include "threads.h"
 #include "usbcfg.h"
 #include "logger.h"
+#include "capture.h"
+#include "session.h"
 #include "diag.h"
+#include "settings.h"
+#include "profile.h"
 
 #include <hal.h>
 #include <halconf.h>
@@ -18,7 +22,7 @@
 
 // this file handle all serial IO
 
-#define COMMS_VERSION 0x01u // bump on every API change i USB communication
+#define COMMS_VERSION 0x0Du // bump on every API change i USB communication
 
 // ------------------------------------------------------------------
 // module private stuff
@@ -26,6 +30,12 @@ static thread_t *commsThdp = 0;
 //static CommsReq_t cmd;
 static usbpkg_t rcvpkg, sndpkg;
 
+// long commands run in settings thread, one at a time, so this thread
+// keeps answering short ones meanwhile
+static usbpkg_t jobRcv, jobSnd;
+static volatile bool jobBusy, jobCancel;
+static volatile uint32_t jobDone, jobTotal;
+
 static const char FwHash[] = QUOTE(FW_VERSION);
 
 static void commsFwHash(usbpkg_t *sndpkg) {
@@ -36,6 +46,98 @@ static void commsFwHash(usbpkg_t *sndpkg) {
 }
 
 
+/**
+ * @brief commands with a single frame reply that may be batched
+ */
+static bool batchable(uint8_t cmd) {
+  switch ((CommsCmdType_e)cmd) {
+  case commsCmd_Ping:
+  case commsCmd_version:
+  case commsCmd_fwHash:
+  case commsCmd_SettingsGetAll:
+  case commsCmd_SettingsFieldInfo:
+  case commsCmd_SettingsGetFields:
+  case commsCmd_SettingsSetFields:
+  case commsCmd_LogSessionStats:
+  case commsCmd_DiagReadAll:
+  case commsCmd_DiagSetVlu:
+  case commsCmd_DiagClearVlu:
+  case commsCmd_DiagI2cStats:
+  case commsCmd_DiagProfile:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief hand rcvpkg over to settings thread, Error if a job is running
+ * The job replies as the command always has, with its own reqId.
+ */
+static void queueJob(void) {
+  if (jobBusy) {
+    commsSendNowWithCmd(&sndpkg, commsCmd_Error);
+    return;
+  }
+  memcpy(jobRcv.u8buf, rcvpkg.u8buf, rcvpkg.onefrm.len);
+  jobDone = jobTotal = 0;
+  jobCancel = false;
+  jobBusy = true;
+  settingsWakeWorker();
+}
+
+/**
+ * @brief reply busy, cmd, reqId, done[4], total[4] for the newest job
+ */
+static void jobStatus(void) {
+  PKG_PUSH(sndpkg, jobBusy);
+  PKG_PUSH(sndpkg, jobRcv.onefrm.cmd);
+  PKG_PUSH(sndpkg, jobRcv.onefrm.reqId);
+  PKG_PUSH_32(sndpkg, jobDone);
+  PKG_PUSH_32(sndpkg, jobTotal);
+  usbWaitTransmit(&sndpkg);
+}
+
+static void routeCmd(void);
+
+/**
+ * @brief run each sub request in a Batch frame, as if it came alone
+ * A sub request is len, cmd, data, a frame without reqId. A Batch frame
+ * with the number of sub requests goes first, then each gets its usual
+ * reply with the reqId of the batch.
+ */
+static void routeBatch(void) {
+  // rcvpkg is reused for each sub request
+  static uint8_t batch[sizeof(rcvpkg.onefrm.data)];
+  const uint8_t reqId = rcvpkg.onefrm.reqId,
+                len = rcvpkg.onefrm.len > 3 ? rcvpkg.onefrm.len - 3 : 0;
+  uint8_t pos = 0, cnt = 0;
+  memcpy(batch, rcvpkg.onefrm.data, len);
+
+  // a broken sub request ends the batch
+  while (pos + 2 <= len && batch[pos] >= 2 && pos + batch[pos] <= len) {
+    pos += batch[pos];
+    ++cnt;
+  }
+  PKG_PUSH(sndpkg, cnt);
+  if (usbQueueTransmit(&sndpkg) != MSG_OK)
+    return;
+
+  for (pos = 0; cnt > 0; --cnt) {
+    const uint8_t subLen = batch[pos], cmd = batch[pos + 1];
+    INIT_PKG(rcvpkg, cmd, reqId);
+    memcpy(rcvpkg.onefrm.data, &batch[pos + 2], subLen - 2);
+    rcvpkg.onefrm.len += subLen - 2;
+    if (batchable(cmd)) {
+      routeCmd();
+    } else {
+      INIT_PKG(sndpkg, cmd, reqId);
+      commsSendNowWithCmd(&sndpkg, commsCmd_Error);
+    }
+    pos += subLen;
+  }
+}
+
 static void routeCmd(void) {
   INIT_PKG(sndpkg, rcvpkg.onefrm.cmd, rcvpkg.onefrm.reqId);
 
@@ -57,11 +159,34 @@ static void routeCmd(void) {
   case commsCmd_SettingsGetAll:
     settingsGetAll(&sndpkg);
     break;
-  case commsCmd_LogGetAll:
-    loggerReadAll(&sndpkg);
+  case commsCmd_SettingsFieldInfo:
+    settingsFieldInfo(&sndpkg, &rcvpkg);
     break;
+  case commsCmd_SettingsGetFields:
+    settingsGetFields(&sndpkg, &rcvpkg);
+    break;
+  case commsCmd_SettingsSetFields:
+    settingsSetFields(&sndpkg, &rcvpkg);
+    break;
+  case commsCmd_SettingsTune:
+    settingsTune(&sndpkg);
+    break;
+  case commsCmd_SettingsCommit:
+    settingsTuneCommit(&sndpkg);
+    break;
+  case commsCmd_SettingsRevert:
+    settingsTuneRevert(&sndpkg);
+    break;
+  case commsCmd_LogGetAll:
   case commsCmd_LogClearAll:
-    loggerClearAll(&sndpkg);
+  case commsCmd_CaptureGetAll:
+  case commsCmd_LogGetSince:
+  case commsCmd_LogSessions:
+  case commsCmd_LogGetRange:
+    queueJob();
+    break;
+  case commsCmd_LogSessionStats:
+    sessionReadStats(&sndpkg);
     break;
   case commsCmd_DiagReadAll:
     diagReadData(&sndpkg);
@@ -72,6 +197,18 @@ static void routeCmd(void) {
   case commsCmd_DiagClearVlu:
     diagClearVlu(&sndpkg, &rcvpkg);
     break;
+  case commsCmd_DiagI2cStats:
+    diagI2cStats(&sndpkg, &rcvpkg);
+    break;
+  case commsCmd_DiagProfile:
+    profileRead(&sndpkg, &rcvpkg);
+    break;
+  case commsCmd_DiagSubscribe:
+    diagSubscribe(&sndpkg, &rcvpkg);
+    break;
+  case commsCmd_Batch:
+    routeBatch();
+    break;
   case commsCmd_version:
     PKG_PUSH(sndpkg, COMMS_VERSION);
     usbWaitTransmit(&sndpkg);
@@ -79,6 +216,14 @@ static void routeCmd(void) {
   case commsCmd_fwHash:
     commsFwHash(&sndpkg);
     break;
+  case commsCmd_JobStatus:
+    jobStatus();
+    break;
+  case commsCmd_JobCancel:
+    // job notices at its next EEPROM read and ends with Error
+    jobCancel = jobBusy;
+    commsSendNowWithCmd(&sndpkg, jobBusy ? commsCmd_OK : commsCmd_Error);
+    break;
   default:
     commsSendNowWithCmd(&sndpkg, commsCmd_Error);
   }
@@ -96,7 +241,7 @@ static void reInitializeUsb(void) {
   usbConnectBus(&USBD1);
 }
 
-THD_WORKING_AREA(waCommsThd, 196);
+THD_WORKING_AREA(waCommsThd, 196 + EE24M01R_STACK_USE);
 THD_FUNCTION(CommsThd, arg) {
   (void)arg;
 
@@ -128,5 +273,44 @@ static thread_descriptor_t commsThdDesc = {
 void commsInit(void) {}
 
 void commsStart(void) {
-  commsThdp = chThdCreate(&commsThdDesc);
+  commsThdp = addThdAndCreate(&commsThdDesc);
+}
+
+void commsRunJob(void) {
+  if (!jobBusy)
+    return;
+
+  INIT_PKG(jobSnd, jobRcv.onefrm.cmd, jobRcv.onefrm.reqId);
+  switch((CommsCmdType_e)jobRcv.onefrm.cmd) {
+  case commsCmd_LogGetAll:
+    loggerReadAll(&jobSnd);
+    break;
+  case commsCmd_LogClearAll:
+    loggerClearAll(&jobSnd);
+    break;
+  case commsCmd_CaptureGetAll:
+    captureReadAll(&jobSnd);
+    break;
+  case commsCmd_LogGetSince:
+    loggerReadSince(&jobSnd, &jobRcv);
+    break;
+  case commsCmd_LogSessions:
+    loggerReadSessions(&jobSnd);
+    break;
+  case commsCmd_LogGetRange:
+    loggerReadRange(&jobSnd, &jobRcv);
+    break;
+  default:
+    break;
+  }
+  jobBusy = false;
+}
+
+void commsJobProgress(uint32_t done, uint32_t total) {
+  jobDone = done;
+  jobTotal = total;
+}
+
+bool commsJobCancelled(void) {
+  return jobCancel;
 }
@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #define _QUOTE(arg) #arg
 #define QUOTE(arg) _QUOTE(arg)
@@ -89,16 +90,34 @@ typedef enum {
   commsCmd_SettingsSetDefault    = 0x07u,
   commsCmd_SettingsSaveAll       = 0x08u,
   commsCmd_SettingsGetAll        = 0x09u,
+  commsCmd_SettingsFieldInfo     = 0x0Au,
+  commsCmd_SettingsGetFields     = 0x0Bu,
+  commsCmd_SettingsSetFields     = 0x0Cu,
+  commsCmd_SettingsTune          = 0x0Du, // changes stay in RAM until commit
+  commsCmd_SettingsCommit        = 0x0Eu,
+  commsCmd_SettingsRevert        = 0x0Fu,
 
   commsCmd_LogGetAll             = 0x10u,
   commsCmd_LogClearAll           = 0x11u,
+  commsCmd_CaptureGetAll         = 0x12u,
+  commsCmd_LogGetSince           = 0x13u,
+  commsCmd_LogSessions           = 0x14u,
+  commsCmd_LogGetRange           = 0x15u,
+  commsCmd_LogSessionStats       = 0x16u,
 
   commsCmd_DiagReadAll           = 0x18u,
   commsCmd_DiagSetVlu            = 0x19u,
   commsCmd_DiagClearVlu          = 0x1Au,
+  commsCmd_DiagI2cStats          = 0x1Bu,
+  commsCmd_DiagSubscribe         = 0x1Cu,
+  commsCmd_DiagStream            = 0x1Du, // pushed by device, never requested
+  commsCmd_Batch                 = 0x1Eu, // several requests in one frame
+  commsCmd_DiagProfile           = 0x1Fu,
 
   commsCmd_version               = 0x20u,
   commsCmd_fwHash                = 0x21u,
+  commsCmd_JobStatus             = 0x22u, // progress of a long command
+  commsCmd_JobCancel             = 0x23u,
   commsCmd_OK                    = 0x7F,
 } CommsCmdType_e;
 
@@ -118,7 +137,7 @@ typedef union __attribute__((__packed__)) {
     uint8_t reqId;
     uint8_t pkgNr[2]; // pkg nr 0 is a header byte for many frames
     uint8_t totalSize[4]; // size in bytes data which this multiframe sends
-    uint8_t logNextAddress[4]; // the next address to store a log in EEPROM
+    uint8_t logNextAddress[4]; // log read: offset of page being written
   } headerfrm;
   struct __attribute__((__packed__)) {
     uint8_t len; // length of data in this specific package
@@ -133,6 +152,22 @@ void commsInit(void);
 
 void commsStart(void);
 
+/**
+ * @brief run the long command comms thread handed over, if any
+ * Called by settings thread, which is idle most of the time.
+ */
+void commsRunJob(void);
+
+/**
+ * @brief long command tells how far it has come, for JobStatus
+ */
+void commsJobProgress(uint32_t done, uint32_t total);
+
+/**
+ * @brief true when host has asked to cancel the running long command
+ */
+bool commsJobCancelled(void);
+
 /**
  * @breif send response to host
  */
@@ -0,0 +1,24 @@
+/*
+ * crc.c
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#include "crc.h"
+
+// ----------------------------------------------------------------
+// Public stuff for this module
+
+uint8_t crc8Update(uint8_t crc, const uint8_t *data, size_t len) {
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; ++i)
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+uint8_t crc8(const uint8_t *data, size_t len) {
+  return crc8Update(0, data, len);
+}
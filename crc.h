@@ -0,0 +1,26 @@
+/*
+ * crc.h
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief CRC-8, polynomial 0x07, init 0, used to validate EEPROM records
+ * Bitwise to save flash, we only checksum a couple of pages at boot.
+ * Must match crc8() in webfrontend logger.js
+ */
+uint8_t crc8(const uint8_t *data, size_t len);
+
+/**
+ * @brief continue a CRC-8 over another block
+ */
+uint8_t crc8Update(uint8_t crc, const uint8_t *data, size_t len);
+
+#endif /* CRC_H_ */
@@ -13,6 +13,8 @@
 #include "inputs.h"
 #include "usbcfg.h"
 #include "logger.h"
+#include "i2c_bus.h"
+#include "threads.h"
 
 
 // this file contains logic to see real time data and steer output data
@@ -30,22 +32,22 @@ volatile const uint16_t diagSetValues = 0;
 // --------------------------------------------------------------
 // private stuff to this module
 
-// ---------------------------------------------------------------
-// public stuff to this module
-
-void diagInit(void) {
-  DIAG_SET_VALUES = 0;
+// systicks to us, saturates at 16bit max
+static uint16_t ticksToUs16(uint32_t ticks) {
+  const uint32_t us = TIME_I2US(ticks);
+  return us > 0xFFFFu ? 0xFFFFu : (uint16_t)us;
 }
 
-void diagStart(void) { }
+// subscription, set by comms thread, read by brake loop
+static volatile sysinterval_t streamPeriod; // 0 when not subscribed
+static volatile uint8_t streamReqId;
+// only touched by brake loop, brake loop stack is too small for a pkg
+static usbpkg_t streamPkg;
+static systime_t streamAt;
+static uint16_t streamSeq, streamDropped;
 
-/**
- * @brief responds with current data as it is seen now
- */
-void diagReadData(usbpkg_t *sndpkg) {
-  DiagReadVluPkg_t *diagPkg = (DiagReadVluPkg_t*)&sndpkg->onefrm.data[0];
+static void fillVlu(DiagReadVluPkg_t *diagPkg) {
   // these must be aligned to declaration in struct
-
   for(uint8_t i = 0; i < 3; ++i) {
     TO_BIG_ENDIAN_16(&diagPkg->accelAxis[i],
                      (int16_t)accel.axis[i]);
@@ -61,6 +63,23 @@ void diagReadData(usbpkg_t *sndpkg) {
   diagPkg->speedOnGround    = values.speedOnGround;
   diagPkg->brakeForceIn     = inputs.brakeForce;
   diagPkg->brakeForceCalc   = values.brakeForce;
+}
+
+// ---------------------------------------------------------------
+// public stuff to this module
+
+void diagInit(void) {
+  DIAG_SET_VALUES = 0;
+}
+
+void diagStart(void) { }
+
+/**
+ * @brief responds with current data as it is seen now
+ */
+void diagReadData(usbpkg_t *sndpkg) {
+  DiagReadVluPkg_t *diagPkg = (DiagReadVluPkg_t*)&sndpkg->onefrm.data[0];
+  fillVlu(diagPkg);
 
   sndpkg->onefrm.len += sizeof(*diagPkg);
   usbWaitTransmit(sndpkg); //commsSendNow(sndpkg);
@@ -174,3 +193,72 @@ void diagClearVlu(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
 void diagClearAllForced(void) {
   DIAG_SET_VALUES = 0;
 }
+
+void diagI2cStats(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
+  DiagI2cStatsPkg_t *pkg = (DiagI2cStatsPkg_t*)sndpkg->onefrm.data;
+
+  for (uint8_t i = 0; i < i2cClient_Cnt; ++i, ++pkg) {
+    const volatile I2cBusStats_t *st = &i2cBusStats[i];
+    const uint32_t avg = st->jobs ? st->totWait / st->jobs : 0;
+    TO_BIG_ENDIAN_16(&pkg->jobs, st->jobs);
+    TO_BIG_ENDIAN_16(&pkg->errors, st->errors);
+    TO_BIG_ENDIAN_16(&pkg->avgWait, ticksToUs16(avg));
+    TO_BIG_ENDIAN_16(&pkg->maxWait, ticksToUs16(st->maxWait));
+    TO_BIG_ENDIAN_16(&pkg->maxHold, ticksToUs16(st->maxHold));
+  }
+  sndpkg->onefrm.len += sizeof(DiagI2cStatsPkg_t) * i2cClient_Cnt;
+
+  if (rcvpkg->onefrm.len > 3 && rcvpkg->onefrm.data[0])
+    i2cBusClearStats();
+
+  usbWaitTransmit(sndpkg);
+}
+
+void diagSubscribe(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
+  if (rcvpkg->onefrm.len != 5) {
+    commsSendNowWithCmd(sndpkg, commsCmd_Error);
+    return;
+  }
+
+  uint16_t ms = FROM_BIG_ENDIAN_16(rcvpkg->onefrm.data);
+  if (ms > 0 && ms < DIAG_STREAM_MIN_MS)
+    ms = DIAG_STREAM_MIN_MS;
+  else if (ms > DIAG_STREAM_MAX_MS)
+    ms = DIAG_STREAM_MAX_MS;
+
+  // brake loop has higher priority, it is never in the middle of a lap
+  chSysLock();
+  streamReqId = rcvpkg->onefrm.reqId;
+  streamPeriod = TIME_MS2I(ms);
+  streamSeq = streamDropped = 0;
+  chSysUnlock();
+
+  // no snapshots after this reply when stopped
+  commsSendNowWithCmd(sndpkg, commsCmd_OK);
+}
+
+void diagSample(void) {
+  const sysinterval_t period = streamPeriod;
+  if (period == 0)
+    return;
+  const systime_t now = chVTGetSystemTimeX();
+  if (chTimeDiffX(streamAt, now) < period)
+    return;
+  streamAt = now;
+
+  DiagStreamPkg_t *pkg = (DiagStreamPkg_t*)streamPkg.onefrm.data;
+  INIT_PKG(streamPkg, commsCmd_DiagStream, streamReqId);
+  TO_BIG_ENDIAN_16(pkg->seq, streamSeq);
+  ++streamSeq;
+  const uint32_t ms = threadsUptimeMs();
+  TO_BIG_ENDIAN_32(pkg->timeMs, ms);
+  TO_BIG_ENDIAN_16(pkg->dropped, streamDropped);
+  fillVlu(&pkg->vlu);
+  streamPkg.onefrm.len += sizeof(*pkg);
+
+  const msg_t msg = usbTryTransmit(&streamPkg);
+  if (msg == MSG_TIMEOUT && streamDropped < 0xFFFF)
+    ++streamDropped;
+  else if (msg == MSG_RESET)
+    streamPeriod = 0; // host is gone, it subscribes again
+}
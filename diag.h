@@ -51,6 +51,24 @@ typedef struct __attribute__((__packed__)) {
 } DiagReadVluPkg_t ;
 
 
+// fastest a host can subscribe to, brake loop laps this often at most
+#define DIAG_STREAM_MIN_MS  5U
+// slowest, period is measured in systime which wraps every 6.5s
+#define DIAG_STREAM_MAX_MS  5000U
+
+/**
+ * @brief pushed as commsCmd_DiagStream after a subscribe, all multibyte
+ *        fields big endian
+ * seq counts snapshots taken, also those dropped because both USB IN
+ * buffers were taken, dropped counts those since subscribe
+ */
+typedef struct __attribute__((__packed__)) {
+  uint8_t seq[2];
+  uint8_t timeMs[4];     // since boot
+  uint8_t dropped[2];    // saturates at 0xFFFF
+  DiagReadVluPkg_t vlu;
+} DiagStreamPkg_t;
+
 /**
  * @brief client sends this package when activating a value
  */
@@ -80,6 +98,18 @@ typedef struct __attribute__((__packed__)) {
   setVluPkgType_t type;
 } DiagClrVluPkg_t;
 
+/**
+ * @brief I2C statistics for one client, times in microseconds
+ * one for each I2cBusClient_e is sent in response
+ */
+typedef struct __attribute__((__packed__)) {
+  uint16_t jobs,
+           errors,
+           avgWait,
+           maxWait,
+           maxHold;
+} DiagI2cStatsPkg_t;
+
 
 extern volatile const uint16_t diagSetValues;
 
@@ -98,4 +128,24 @@ void diagClearVlu(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
 
 void diagClearAllForced(void);
 
+/**
+ * @brief responds with I2C bus latency statistics for each client
+ * clears statistics afterwards if first data byte is set
+ */
+void diagI2cStats(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+/**
+ * @brief start or stop pushing snapshots to host
+ * data is period in ms, big endian 16 bit, 0 stops, clamped to
+ * DIAG_STREAM_MIN_MS - DIAG_STREAM_MAX_MS. Snapshots are sent
+ * with the reqId of this request until stopped or USB is gone.
+ */
+void diagSubscribe(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+/**
+ * @brief push a snapshot when period is due, called from brake loop
+ *        each lap, never blocks
+ */
+void diagSample(void);
+
 #endif /* DIAG_H_ */
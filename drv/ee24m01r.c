@@ -11,6 +11,7 @@
 #include <halconf.h>
 #include <ch.h>
 #include "board.h"
+#include <string.h>
 
 // -----------------------------------------------------------------
 // private stuff to this module
@@ -28,6 +29,79 @@ static systime_t calc_12c_timeout(uint32_t bytes) {
   return TIME_US2I(tmo);
 }
 
+// shared transmit buffer, only valid while we own the bus
+static uint8_t wrbuf[EE24M01R_PAGE_SIZE + 2];
+
+/**
+ * @brief run a transfer, retry while the EEPROM is busy
+ * @description the EEPROM NACKs it's address while a write cycle is in
+ *              progress, retry until it ACKs or the write time has passed.
+ *              The bus is released between each try.
+ * @job the bus job, rx part must be set by caller
+ * @memAddr 2 byte memory address
+ * @data if not NULL write len bytes from data, else only address
+ */
+static msg_t transfer(I2cBusJob_t *job, const uint8_t *memAddr,
+                      const uint8_t *data, uint16_t len)
+{
+  const systime_t start = chVTGetSystemTimeX();
+  const sysinterval_t maxTime = TIME_MS2I(EE24M01R_WRITE_TIME) +
+                                TIME_US2I(EE24M01R_POLL_INTERVAL);
+  msg_t msg;
+
+  while (true) {
+    i2cBusAcquire(job);
+    if (data != NULL) {
+      wrbuf[0] = memAddr[0];
+      wrbuf[1] = memAddr[1];
+      memcpy(&wrbuf[2], data, len);
+      job->txbuf = wrbuf;
+      job->txbytes = len + 2;
+      // disable write lock write pin
+      palClearLine(LINE_I2C_WC);
+    } else {
+      job->txbuf = memAddr;
+      job->txbytes = 2;
+    }
+
+    // NACKs while we may still retry are not bus errors
+    job->poll = chTimeDiffX(start, chVTGetSystemTimeX()) < maxTime;
+    msg = i2cBusRunLocked(job);
+
+    if (data != NULL) // re-enable write lock, starts write cycle
+      palSetLine(LINE_I2C_WC);
+    if (msg == MSG_RESET) // a busy EEPROM is not a bus error
+      job->result = MSG_OK;
+    i2cBusRelease(job);
+
+    if (msg != MSG_RESET ||
+        chTimeDiffX(start, chVTGetSystemTimeX()) >= maxTime)
+    {
+      return msg;
+    }
+    chThdSleep(TIME_US2I(EE24M01R_POLL_INTERVAL));
+  }
+}
+
+/**
+ * @brief wait for the write cycle started by the last write to finish
+ */
+static msg_t wait_write_cycle(I2cBusJob_t *job, const uint8_t *memAddr)
+{
+#if EE24M01R_USE_ACK_POLLING
+  // it takes at least this long, no need to disturb the bus before
+  chThdSleep(TIME_US2I(EE24M01R_POLL_INTERVAL));
+  job->rxbytes = 0;
+  job->timeout = calc_12c_timeout(0);
+  return transfer(job, memAddr, NULL, 0);
+#else
+  (void)job;
+  (void)memAddr;
+  chThdSleep(TIME_MS2I(EE24M01R_WRITE_TIME));
+  return MSG_OK;
+#endif
+}
+
 typedef msg_t (*funcPtr_t)(ee24_arg_t *arg);
 
 static msg_t page_split(ee24_arg_t *arg, funcPtr_t func) {
@@ -72,12 +146,53 @@ static msg_t page_split(ee24_arg_t *arg, funcPtr_t func) {
   return msg;
 }
 
+/**
+ * @brief writes one page aligned range, job is on stack here and not in
+ *        ee24m01r_write so page_split recursion only holds one at a time
+ */
+static msg_t __attribute__((noinline)) write_chunks(ee24_arg_t *arg)
+{
+  I2cBusJob_t job;
+  msg_t status = MSG_OK;
+  job.i2cp = arg->eep->i2cp;
+  job.sad = arg->sad;
+  job.client = arg->client;
+  uint16_t memAddr = (arg->memAddrBuf[0] << 8) | arg->memAddrBuf[1];
+  const uint16_t maxChunk = arg->eep->writeChunk ?
+                              arg->eep->writeChunk : EE24M01R_WRITE_CHUNK_SIZE;
+
+  // write in chunks, bus is free for other clients in between
+  for (uint16_t pos = 0; pos < arg->len && status == MSG_OK;) {
+    uint16_t chunk = arg->len - pos;
+    if (chunk > maxChunk)
+      chunk = maxChunk;
+
+    const uint8_t addr[2] = {
+      (memAddr & 0xFF00) >> 8,
+      (memAddr & 0x00FF) >> 0
+    };
+
+    job.rxbytes = 0;
+    job.timeout = calc_12c_timeout(chunk + 2);
+    status = transfer(&job, addr, &arg->buf[pos], chunk);
+
+    // wait for eeprom to finish writing data
+    if (status == MSG_OK)
+      status = wait_write_cycle(&job, addr);
+
+    pos += chunk;
+    memAddr += chunk;
+  }
+
+  return status;
+}
+
 // -----------------------------------------------------------------
 // public stuff to this module
 
 
 /**
- * @brief read from eeprom in chunks of up to 256 bytes
+ * @brief sequential read from eeprom, split only where bank changes
  * @description reads len bytes from partition from addr and forward
  *
  * @eep pointer to a ee24partition_t
@@ -88,37 +203,37 @@ static msg_t page_split(ee24_arg_t *arg, funcPtr_t func) {
  */
 msg_t ee24m01r_read(ee24_arg_t *arg)
 {
-  osalDbgAssert(arg->len <= EE24M01R_PAGE_SIZE, "Can't read more than pageSize");
-
-  uint8_t *origBuf = arg->buf;
-  msg_t status;
-
-  const uint32_t beginAddr = arg->eep->startAddr + arg->offset;
-
-  // sad is 7 based bit nr 2 in SAD represents high or low addrs so 0x01 -> sad: 0bxxxxxx1x
-  arg->sad = arg->eep->i2cAddrBase | (beginAddr & 0x010000) >> 16;
-
-  arg->memAddrBuf[0] = (beginAddr & 0xFF00) >> 8;
-  arg->memAddrBuf[1] = (beginAddr & 0x00FF) >> 0;
-
   osalDbgAssert((arg->offset + arg->len) <= arg->eep->size,
              "out of device bounds");
 
-#if I2C_USE_MUTUAL_EXCLUSION
-  i2cAcquireBus(arg->eep->i2cp);
-#endif
-  status = i2cMasterTransmitTimeout(arg->eep->i2cp, arg->sad,
-                                    arg->memAddrBuf, 2,
-                                    arg->buf, arg->len,
-                                    calc_12c_timeout(arg->len));
-
-#if I2C_USE_MUTUAL_EXCLUSION
-  i2cReleaseBus(arg->eep->i2cp);
-#endif
-
-  // restore
-  arg->len += (uint8_t)((uint32_t)arg->buf - (uint32_t)origBuf);
-  arg->buf = origBuf;
+  msg_t status = MSG_OK;
+  uint32_t addr = arg->eep->startAddr + arg->offset;
+  uint16_t pos = 0;
+
+  I2cBusJob_t job;
+  job.i2cp = arg->eep->i2cp;
+  job.client = arg->client;
+
+  while (pos < arg->len && status == MSG_OK) {
+    // address counter wraps within bank, continue in next bank
+    uint32_t len = EE24M01R_BANK_ADDR_SPAN - (addr & (EE24M01R_BANK_ADDR_SPAN - 1));
+    if (len > (uint32_t)(arg->len - pos))
+      len = arg->len - pos;
+
+    // sad is 7 based bit nr 2 in SAD represents high or low addrs so 0x01 -> sad: 0bxxxxxx1x
+    arg->sad = arg->eep->i2cAddrBase | (addr & 0x010000) >> 16;
+    arg->memAddrBuf[0] = (addr & 0xFF00) >> 8;
+    arg->memAddrBuf[1] = (addr & 0x00FF) >> 0;
+
+    job.sad = arg->sad;
+    job.rxbuf = &arg->buf[pos];
+    job.rxbytes = len;
+    job.timeout = calc_12c_timeout(len);
+    status = transfer(&job, arg->memAddrBuf, NULL, 0);
+
+    pos += len;
+    addr += len;
+  }
 
   return status;
 }
@@ -144,39 +259,10 @@ msg_t ee24m01r_write(ee24_arg_t *arg)
   msg_t status = page_split(arg, &ee24m01r_write);
   if (status != MSG_OK) return status;
 
-  static uint8_t buf[EE24M01R_PAGE_SIZE + 2];
-
-// aquire bus to use as a mutex to not access writebuffer inadvertantly
-#if I2C_USE_MUTUAL_EXCLUSION
-  i2cAcquireBus(arg->eep->i2cp);
-#endif
-
-  // disable write lock write pin
-  palClearLine(LINE_I2C_WC);
-
-  // copy data to transmit buffer
-  buf[0] = arg->memAddrBuf[0];
-  buf[1] = arg->memAddrBuf[1];
-  for(uint32_t i = 0; i < arg->len; ++i)
-    buf[i + 2] = arg->buf[i];
-
-  // write to memory
-  status = i2cMasterTransmitTimeout(arg->eep->i2cp, arg->sad,
-                                    buf, arg->len+2, NULL, 0,
-                                    calc_12c_timeout(arg->len+2) +
-                                    TIME_MS2I(EE24M01R_WRITE_TIME));
-  // re-enable write lock, start write cycle
-  palSetLine(LINE_I2C_WC);
-
-#if I2C_USE_MUTUAL_EXCLUSION
-  i2cReleaseBus(arg->eep->i2cp);
-#endif
-
-  // wait for eeprom to finish writing data
-  chThdSleep(TIME_MS2I(EE24M01R_WRITE_TIME));
+  status = write_chunks(arg);
 
   // restore
-  arg->len += (uint8_t)((uint32_t)arg->buf - (uint32_t)origBuf);;
+  arg->len += (uint16_t)(arg->buf - origBuf);
   arg->buf = origBuf;
 
   return status;
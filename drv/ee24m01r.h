@@ -9,6 +9,7 @@
 #define DRV_EE24M01R_H_
 
 #include <hal.h>
+#include "i2c_bus.h"
 
 // driver for EEPROM 1Mbit 24M01R
 
@@ -33,11 +34,29 @@
 /* start address is at 0 but the 16th bit is set with a different i2c address */
 #define EE24M01R_BANK2_START_ADDR      0U
 #define EE24M01R_BANK2_END_ADDR        (EE24M01R_BANK1_CAPACITY - EE24M01R_BANK1_START_ADDR -1)
+// bit 16 of the memory address goes in device select, a sequential
+// read rolls over within those 64k
+#define EE24M01R_BANK_ADDR_SPAN        0x10000U
 
 #define EE24M01R_READ_BIT              0x01U
 
 #define EE24M01R_PAGE_SIZE             256U
-#define EE24M01R_WRITE_TIME            5U /* in milliseconds */
+#define EE24M01R_WRITE_TIME            5U /* in milliseconds, max from datasheet */
+
+/* poll the EEPROM until it ACKs instead of always waiting
+   EE24M01R_WRITE_TIME after a write, most write cycles are shorter */
+#if !defined(EE24M01R_USE_ACK_POLLING)
+#define EE24M01R_USE_ACK_POLLING       TRUE
+#endif
+#define EE24M01R_POLL_INTERVAL         200U /* in microseconds */
+
+/* longest write transfer that holds the bus, a page write is split in
+   chunks this big so queued accelerometer reads can get in between.
+   Each chunk is its own write cycle in the EEPROM, a partition can
+   set it's own size in writeChunk. */
+#if !defined(EE24M01R_WRITE_CHUNK_SIZE)
+#define EE24M01R_WRITE_CHUNK_SIZE      64U
+#endif
 
 // A partition can stretch over low and high bytes (flip the 16th bit i i2C address)
 typedef struct {
@@ -45,8 +64,13 @@ typedef struct {
   uint8_t i2cAddrBase; /* I2C addr excluding R/W bit (7-bit) */
   uint32_t startAddr; /* the first address in this partition */
   uint32_t size;   /* how many bytes in partition */
+  uint16_t writeChunk; /* max bytes in one write transfer,
+                          0 uses EE24M01R_WRITE_CHUNK_SIZE */
 } ee24partition_t;
 
+// stack a read or write needs for its bus job, add to callers working area
+#define EE24M01R_STACK_USE  sizeof(I2cBusJob_t)
+
 // a argument struct
 typedef struct {
   const ee24partition_t *eep; /* @eep pointer to a ee24partition_t */
@@ -55,11 +79,13 @@ typedef struct {
   i2caddr_t sad;         /* slave adress i2c*/
   uint16_t len;          /* len number of bytes read, start at offset and move forward until len*/
   uint8_t memAddrBuf[2];   /* memory address in EEPROM*/
+  uint8_t client;        /* I2cBusClient_e, who is using the bus */
 } ee24_arg_t;
 
 /**
- * @brief read from eeprom in chunks of up to 256 bytes
- * @description reads len bytes from partition from addr and forward
+ * @brief sequential read from eeprom, any length
+ * @description reads len bytes from partition from addr and forward,
+ *              one transfer per 64k bank the range touches
  * @eep pointer to a ee24partition_t
  * @offset read from this addr, offset=0 is from start
  * @buf read data gets put here, must be at least of size len
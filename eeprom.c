@@ -7,6 +7,7 @@
 
 #include "cfg/halconf.h"
 #include "eeprom.h"
+#include "logger.h"
 #include "ee24m01r.h"
 #include <hal.h>
 #include <stdint.h>
@@ -14,6 +15,17 @@
 // -----------------------------------------------------------------
 // private stuff for this module
 
+_Static_assert(EEPROM_SETTINGS_SLOT_SIZE <= EEPROM_PAGE_SIZE,
+               "Settings slot does not fit in a page");
+_Static_assert(EEPROM_LOG_HEADER_ADDR + EEPROM_LOG_HEADER_SIZE <=
+                 EEPROM_SETTINGS_START_ADDR,
+               "Log header overlaps settings");
+_Static_assert(EEPROM_SETTINGS_END_ADDR < EEPROM_LOG_START_ADDR,
+               "Settings overlaps log");
+_Static_assert(EEPROM_CAPTURE_START_ADDR + EEPROM_CAPTURE_SIZE <=
+                 EE24M01R_TOTAL_CAPACITY,
+               "Captures does not fit in EEPROM");
+
 
 // -----------------------------------------------------------------
 // Public stuff for this module
@@ -25,11 +37,35 @@ ee24partition_t settings_ee = {
   EEPROM_SETTINGS_SIZE
 };
 
+ee24partition_t loghdr_ee = {
+  &I2CD1,
+  EE24M01R_I2C_LOW_BANK(0),
+  EEPROM_LOG_HEADER_ADDR,
+  EEPROM_LOG_HEADER_SIZE
+};
+
 ee24partition_t log_ee = {
   &I2CD1,
   EE24M01R_I2C_LOW_BANK(0),
   EEPROM_LOG_START_ADDR,
-  EEPROM_LOG_SIZE
+  EEPROM_LOG_SIZE,
+  EEPROM_PAGE_SIZE // whole pages, each chunk costs a write cycle
+};
+
+ee24partition_t session_ee = {
+  &I2CD1,
+  EE24M01R_I2C_LOW_BANK(0),
+  EEPROM_SESSION_START_ADDR,
+  EEPROM_SESSION_SIZE,
+  EEPROM_PAGE_SIZE
+};
+
+ee24partition_t capture_ee = {
+  &I2CD1,
+  EE24M01R_I2C_LOW_BANK(0),
+  EEPROM_CAPTURE_START_ADDR,
+  EEPROM_CAPTURE_SIZE,
+  EEPROM_PAGE_SIZE
 };
 
 void eepromInit(void) {}
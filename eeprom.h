@@ -9,28 +9,48 @@
 #define EEPROM_H_
 
 #include "settings.h"
+#include "capture.h"
+#include "session.h"
 //#include <hal_eeprom.h>
 #include <ee24m01r.h>
 
 #define EEPROM_PAGE_SIZE             EE24M01R_PAGE_SIZE
-#define EEPROM_SETTINGS_START_ADDR   (0U)
-#define EEPROM_SETTINGS_SIZE       (sizeof(Settings_t))
+// log header is first in first page, before settings slot A
+#define EEPROM_LOG_HEADER_ADDR     0U
+#define EEPROM_LOG_HEADER_SIZE     LOG_HEADER_SIZE // from logger.h
+// settings slot A is last in first page and slot B first in second
+// page, each save writes one page only and both load in one read
+#define EEPROM_SETTINGS_SLOT_SIZE  (sizeof(Settings_slot_t))
+#define EEPROM_SETTINGS_START_ADDR (EEPROM_PAGE_SIZE - EEPROM_SETTINGS_SLOT_SIZE)
+#define EEPROM_SETTINGS_SIZE       (2 * EEPROM_SETTINGS_SLOT_SIZE)
 #define EEPROM_SETTINGS_END_ADDR                            \
             (EEPROM_SETTINGS_START_ADDR + EEPROM_SETTINGS_SIZE -1)
-#define EEPROM_LOG_START_ADDR  (EEPROM_SETTINGS_END_ADDR + 1)
-#define EEPROM_LOG_SIZE        (EE24M01R_TOTAL_CAPACITY - EEPROM_SETTINGS_SIZE)
-                                /*- 4 -4 due to next address is stored last in sector 2*/
-// addrs as in I2C bus address
-#define EEPROM_LOG_NEXT_ADDR_LOC \
-  (EE24M01R_TOTAL_CAPACITY -1 - 4 - EEPROM_SETTINGS_SIZE)
-// addr as in address in LOG partition
-#define EEPROM_LOG_NEXT_ADDR_OFFSET \
-  (EEPROM_LOG_NEXT_ADDR_LOC - EEPROM_LOG_START_ADDR)
+// brake event captures are in the last pages
+#ifndef EEPROM_CAPTURE_PAGES
+# if CAPTURE_SAMPLES > 0
+#  define EEPROM_CAPTURE_PAGES  24U
+# else
+#  define EEPROM_CAPTURE_PAGES  0U
+# endif
+#endif
+#define EEPROM_CAPTURE_SIZE    (EEPROM_CAPTURE_PAGES * EEPROM_PAGE_SIZE)
+// log starts at third page and is page aligned,
+// the logger writes whole pages
+#define EEPROM_LOG_START_ADDR  (2 * EEPROM_PAGE_SIZE)
+#define EEPROM_LOG_PAGES       (EE24M01R_TOTAL_CAPACITY / EEPROM_PAGE_SIZE - 2 \
+                                  - EEPROM_SESSION_PAGES - EEPROM_CAPTURE_PAGES)
+#define EEPROM_LOG_SIZE        (EEPROM_LOG_PAGES * EEPROM_PAGE_SIZE)
+// session directory is between log and captures
+#define EEPROM_SESSION_START_ADDR  (EEPROM_LOG_START_ADDR + EEPROM_LOG_SIZE)
+#define EEPROM_SESSION_SIZE    (EEPROM_SESSION_PAGES * EEPROM_PAGE_SIZE)
+#define EEPROM_CAPTURE_START_ADDR  \
+            (EEPROM_SESSION_START_ADDR + EEPROM_SESSION_SIZE)
 
 void eepromInit(void);
 
 //extern EepromFileStream *settings_fs, *log_bank1_fs, *log_bank2_fs;
 
-extern ee24partition_t settings_ee, log_ee;
+extern ee24partition_t settings_ee, loghdr_ee, log_ee, session_ee,
+                       capture_ee;
 
 #endif /* EEPROM_H_ */
@@ -47,20 +47,42 @@ const CommsCmdType_e = {
   commsCmd_SettingsSetDefault    : 0x07,
   commsCmd_SettingsSaveAll       : 0x08,
   commsCmd_SettingsGetAll        : 0x09,
+  commsCmd_SettingsFieldInfo     : 0x0A,
+  commsCmd_SettingsGetFields     : 0x0B,
+  commsCmd_SettingsSetFields     : 0x0C,
+  commsCmd_SettingsTune          : 0x0D,
+  commsCmd_SettingsCommit        : 0x0E,
+  commsCmd_SettingsRevert        : 0x0F,
 
   commsCmd_LogGetAll             : 0x10,
   commsCmd_LogClearAll           : 0x11,
+  commsCmd_CaptureGetAll         : 0x12,
+  commsCmd_LogGetSince           : 0x13,
+  commsCmd_LogSessions           : 0x14,
+  commsCmd_LogGetRange           : 0x15,
+  commsCmd_LogSessionStats       : 0x16,
 
   commsCmd_DiagReadAll           : 0x18,
   commsCmd_DiagSetVlu            : 0x19,
   commsCmd_DiagClearVlu          : 0x1A,
+  commsCmd_DiagI2cStats          : 0x1B,
+  commsCmd_DiagSubscribe         : 0x1C,
+  commsCmd_DiagStream            : 0x1D,
+  commsCmd_Batch                 : 0x1E,
+  commsCmd_DiagProfile           : 0x1F,
 
   commsCmd_version               : 0x20,
   commsCmd_fwHash                : 0x21,
+  commsCmd_JobStatus             : 0x22,
+  commsCmd_JobCancel             : 0x23,
   commsCmd_OK                    : 0x7F,
 };
 module.exports.CommsCmdType_e = CommsCmdType_e;
 
+// must match COMMS_VERSION in comms.c
+const COMMS_VERSION = 0x0D;
+module.exports.COMMS_VERSION = COMMS_VERSION;
+
 class usbpkg_t {
   u8buf = [];
   len = -1;
@@ -117,19 +139,47 @@ module.exports.initComms = initComms;
 
 // when we recieve data from RC-gearbrake board
 function onRecieve(data) {
-  const pkg = usbpkg_t.parse(data);
-  if (pkg === false) return;
+  // a chunk from serial port may hold several frames when streaming
+  for (let pos = 0; pos < data.length && data[pos] > 0; pos += data[pos]) {
+    const pkg = usbpkg_t.parse(data.slice(pos, pos + data[pos]));
+    if (pkg !== false)
+      routePkg(pkg);
+  }
+}
+module.exports.onRecieve = onRecieve;
+
+function routePkg(pkg) {
+  // pushed by device after subscribeDiag, not a reply
+  if (pkg.cmd === CommsCmdType_e.commsCmd_DiagStream) {
+    if (streamCb)
+      streamCb(DiagStreamPkg_t.parse(pkg.onefrm().data));
+    return;
+  }
 
   const idx = promises.findIndex(p=>p.reqId===pkg.reqId);
-  const prom = promises.splice(idx, 1)[0];
-  if (!prom)
+  if (idx < 0)
     return;
+  const prom = promises[idx];
+  if (prom.frames) {
+    // batch reply, count frame first then one frame per sub request
+    if (prom.frames.length === 0)
+      prom.left = pkg.cmd === CommsCmdType_e.commsCmd_Batch ?
+                    pkg.onefrm().data[0] : 0;
+    else
+      --prom.left;
+    prom.frames.push(pkg);
+    if (prom.left > 0)
+      return;
+  }
+  promises.splice(idx, 1);
 
   clearTimeout(prom.tmr);
 
   const resolve = (data) =>prom.resolve(data),
         reject = (data) =>prom.reject(data);
 
+  if (prom.frames)
+    return resolve(prom.frames);
   if (prom.returnRaw)
     return resolve(pkg);
 
@@ -154,8 +204,16 @@ function onRecieve(data) {
   case CommsCmdType_e.commsCmd_DiagSetVlu:
     console.error('Should not get command DiagSetVlu as response');
     return reject(pkg);
+  case CommsCmdType_e.commsCmd_DiagI2cStats:
+    return resolve(DiagI2cStatsPkg_t.parse(pkg.onefrm().data));
+  case CommsCmdType_e.commsCmd_DiagProfile:
+    return resolve(DiagProfilePkg_t.parse(pkg.onefrm().data));
   case CommsCmdType_e.commsCmd_LogClearAll:
   case CommsCmdType_e.commsCmd_LogGetAll: // fallthrough
+  case CommsCmdType_e.commsCmd_LogGetSince:
+  case CommsCmdType_e.commsCmd_LogSessions:
+  case CommsCmdType_e.commsCmd_LogGetRange:
+  case CommsCmdType_e.commsCmd_LogSessionStats:
     console.info('Log not implemented');
     return reject(pkg);
   case CommsCmdType_e.commsCmd_Reset:
@@ -174,11 +232,10 @@ function onRecieve(data) {
     return reject(pkg);
   }
 }
-module.exports.onRecieve = onRecieve;
 
 let reqId = 0;
 const promises = [];
-function sendBuf(buf, cmd, returnRaw = false) {
+function sendBuf(buf, cmd, returnRaw = false, frames = null) {
   const tmr = setTimeout(()=>{
     const cmds = Object.keys(CommsCmdType_e);
     console.log("Timeout, no response from gearbrake, CMD:", cmd,
@@ -187,7 +244,7 @@ function sendBuf(buf, cmd, returnRaw = false) {
   }, 2000);
   return new Promise((resolve, reject)=>{
     const pkg = usbpkg_t.parse([3+buf.length, cmd, reqId, ...buf]);
-    promises.push({reqId, resolve, reject, tmr, returnRaw});
+    promises.push({reqId, resolve, reject, tmr, returnRaw, frames});
     if (++reqId > 255)
       reqId = 0;
     if (port && port.isOpen)
@@ -200,6 +257,17 @@ function sendBuf(buf, cmd, returnRaw = false) {
 }
 module.exports.sendBuf = sendBuf;
 
+// subs is [{cmd, data}], resolves to all frames in reply, Batch frame first
+function sendBatch(subs) {
+  const buf = [];
+  for (const sub of subs) {
+    const data = sub.data || [];
+    buf.push(2 + data.length, sub.cmd, ...data);
+  }
+  return sendBuf(buf, CommsCmdType_e.commsCmd_Batch, true, []);
+}
+module.exports.sendBatch = sendBatch;
+
 
 // diag things
 async function fetchDiagValues() {
@@ -222,6 +290,27 @@ async function clearDiag(diagType) {
 }
 module.exports.clearDiag = clearDiag;
 
+let streamCb = null;
+async function subscribeDiag(periodMs, callback = null) {
+  streamCb = periodMs > 0 ? callback : null;
+  const res = await sendBuf(toBigEnd16(periodMs),
+                            CommsCmdType_e.commsCmd_DiagSubscribe);
+  return res;
+}
+module.exports.subscribeDiag = subscribeDiag;
+
+async function fetchI2cStats(clear = false) {
+  const stats = await sendBuf([clear ? 1 : 0], CommsCmdType_e.commsCmd_DiagI2cStats);
+  return stats;
+}
+module.exports.fetchI2cStats = fetchI2cStats;
+
+async function fetchProfile(clear = false) {
+  const prof = await sendBuf([clear ? 1 : 0], CommsCmdType_e.commsCmd_DiagProfile);
+  return prof;
+}
+module.exports.fetchProfile = fetchProfile;
+
 
 // settings things
 async function fetchSettings() {
@@ -242,6 +331,48 @@ async function defaultSettings() {
 }
 module.exports.defaultSettings = defaultSettings;
 
+// FNV-1a of name folded to 16 bits, as field info from device
+function nameHash(name) {
+  let h = 0x811C9DC5;
+  for (let i = 0; i < name.length; ++i)
+    h = Math.imul(h ^ name.charCodeAt(i), 0x01000193) >>> 0;
+  return ((h >>> 16) ^ h) & 0xFFFF;
+}
+module.exports.nameHash = nameHash;
+
+// resolves to [{id, hash, max, notify}] for all settings fields
+async function fetchSettingsFields() {
+  const fields = [];
+  let data;
+  do {
+    const pkg = await sendBuf([fields.length],
+                              CommsCmdType_e.commsCmd_SettingsFieldInfo, true);
+    data = pkg.onefrm().data;
+    for (let i = 0; i + 5 <= data.length; i += 5)
+      fields.push({id: data[i], hash: data[i+1] << 8 | data[i+2],
+                   max: data[i+3], notify: data[i+4]});
+  } while (data.length > 0);
+  return fields;
+}
+module.exports.fetchSettingsFields = fetchSettingsFields;
+
+// resolves to values of fields with ids, in same order
+async function getSettingsFields(ids) {
+  const pkg = await sendBuf(ids, CommsCmdType_e.commsCmd_SettingsGetFields, true);
+  const data = pkg.onefrm().data, vlus = [];
+  for (let i = 0; i + 3 <= data.length; i += 3)
+    vlus.push(data[i+2]);
+  return vlus;
+}
+module.exports.getSettingsFields = getSettingsFields;
+
+// fields is [{id, vlu}], resolves to the reply frame
+async function setSettingsFields(fields) {
+  return await sendBuf(fields.flatMap(f=>[f.id, 1, f.vlu]),
+                       CommsCmdType_e.commsCmd_SettingsSetFields, true);
+}
+module.exports.setSettingsFields = setSettingsFields;
+
 /*
 // out as in USB host out, ie in to this device
 typedef union {
@@ -259,7 +390,7 @@ typedef union {
     uint8_t reqId;
     uint8_t pkgNr[2]; // pkg nr 0 is a header byte for many frames
     uint8_t totalSize[4]; // size in bytes data which this multiframe sends
-    uint8_t logNextAddress[4]; // the next address to store a log in EEPROM
+    uint8_t logNextAddress[4]; // log read: offset of page being written
   } headerfrm;
   struct {
     uint8_t len; // length of data in this specific package
@@ -320,6 +451,24 @@ class DiagReadVluPkg_t {
 }
 module.exports.DiagReadVluPkg_t = DiagReadVluPkg_t;
 
+class DiagStreamPkg_t {
+  seq = 0;
+  timeMs = 0;
+  dropped = 0;
+  vlu = new DiagReadVluPkg_t();
+
+  static parse(data) {
+    const pkg = new DiagStreamPkg_t();
+    pkg.seq = fromBigEnd16(data.slice(0, 2));
+    pkg.timeMs = ((data[2] << 24) | (data[3] << 16) |
+                  (data[4] << 8) | data[5]) >>> 0;
+    pkg.dropped = fromBigEnd16(data.slice(6, 8));
+    pkg.vlu = DiagReadVluPkg_t.parse(data.slice(8));
+    return pkg;
+  }
+}
+module.exports.DiagStreamPkg_t = DiagStreamPkg_t;
+
 /**
  * @brief this data package is returned to client when requesting realtime data
  */
@@ -341,8 +490,74 @@ typedef struct __attribute__((__packed__)) {
           // 27 bytes here
           // should align to 28 bits
 } DiagReadVluPkg_t ;
+
+// pushed as commsCmd_DiagStream after a subscribe
+typedef struct __attribute__((__packed__)) {
+  uint8_t seq[2];
+  uint8_t timeMs[4];     // since boot
+  uint8_t dropped[2];    // saturates at 0xFFFF
+  DiagReadVluPkg_t vlu;
+} DiagStreamPkg_t;
 */
 
+/**
+ * @brief I2C bus statistics, one entry per I2cBusClient_e
+ */
+class DiagI2cStatsPkg_t {
+  static Clients = ['accel', 'settings', 'logger', 'comms'];
+  static size = 10;
+
+  static parse(data) {
+    const res = {};
+    DiagI2cStatsPkg_t.Clients.forEach((name, i)=>{
+      const d = data.slice(i * DiagI2cStatsPkg_t.size);
+      res[name] = {
+        jobs:    fromBigEnd16(d.slice(0,2)),
+        errors:  fromBigEnd16(d.slice(2,4)),
+        avgWait: fromBigEnd16(d.slice(4,6)),
+        maxWait: fromBigEnd16(d.slice(6,8)),
+        maxHold: fromBigEnd16(d.slice(8,10)),
+      };
+    });
+    return res;
+  }
+}
+module.exports.DiagI2cStatsPkg_t = DiagI2cStatsPkg_t;
+
+/**
+ * @brief CPU load in permille, stacks in bytes by thread prio then idle
+ *        and ISR, ISR times in cycles at cpuMHz, latency in us
+ */
+class DiagProfilePkg_t {
+  static Stacks = ['brake', 'accel', 'logger', 'comms', 'settings',
+                   'idle', 'isr'];
+  static Isrs = ['tim2', 'wheelDma'];
+  static I2cErrors = ['timeouts', 'busErrors', 'arbLost', 'nacks', 'overruns'];
+
+  static parse(data) {
+    const u16 = (pos)=>fromBigEnd16(data.slice(pos, pos + 2));
+    const res = {
+      cpuLoad: u16(0), cpuLoadMax: u16(2), cpuMHz: data[4],
+      stacks: {}, isrs: {}, i2cErrors: {}
+    };
+    let pos = 5;
+    for (const name of DiagProfilePkg_t.Stacks) {
+      res.stacks[name] = {size: u16(pos), unused: u16(pos + 2)};
+      pos += 4;
+    }
+    for (const name of DiagProfilePkg_t.Isrs) {
+      res.isrs[name] = {maxCycles: u16(pos), maxLatency: u16(pos + 2)};
+      pos += 4;
+    }
+    for (const name of DiagProfilePkg_t.I2cErrors) {
+      res.i2cErrors[name] = u16(pos);
+      pos += 2;
+    }
+    return res;
+  }
+}
+module.exports.DiagProfilePkg_t = DiagProfilePkg_t;
+
 const setVluPkgType_e = {
   diag_Set_Invalid : 0,
   // these must be in this order, with bitmask values
@@ -478,8 +693,8 @@ const settingDefines = {
 module.exports.settingDefines = settingDefines;
 
 class Settings_header_t {
-  storageVersion = 0x0001;
-  size = 0x000B;
+  storageVersion = 0x0002;
+  size = 0x000D;
   serialize() {
     return [
       ...toBigEnd16(this.storageVersion),
@@ -536,6 +751,11 @@ class Settings_t {
   WheelSensor1_pulses_per_rev = 0;
   WheelSensor2_pulses_per_rev = 0;
 
+  // begin fourth bitfield
+  logFastPeriodicity = settingDefines.SETTINGS_LOG_40MS;
+  logAdaptive = 1;
+  logFastSpeed = 20;
+
   static parse(data) {
     const pkg = new Settings_t();
     pkg.header = Settings_header_t.parse(data.slice(0,4));
@@ -565,6 +785,10 @@ class Settings_t {
     pkg.WheelSensor0_pulses_per_rev = data[12];
     pkg.WheelSensor1_pulses_per_rev = data[13];
     pkg.WheelSensor2_pulses_per_rev = data[14];
+    // fourth bitfield
+    pkg.logFastPeriodicity = (data[15] & 0x07);
+    pkg.logAdaptive        = (data[15] & 0x08) >> 3;
+    pkg.logFastSpeed       = data[16];
     return pkg;
   }
 
@@ -581,7 +805,9 @@ class Settings_t {
       this._thirdBitfield(),
       this.WheelSensor0_pulses_per_rev,
       this.WheelSensor1_pulses_per_rev,
-      this.WheelSensor2_pulses_per_rev
+      this.WheelSensor2_pulses_per_rev,
+      this._fourthBitfield(),
+      this.logFastSpeed
     ];
     this.header.size = buf.length;
     buf.unshift(...this.header.serialize());
@@ -613,6 +839,12 @@ class Settings_t {
       ((this.logPeriodicity & 0x07) << 3)
     );
   }
+  _fourthBitfield() {
+    return (
+      (this.logFastPeriodicity & 0x07) |
+      ((this.logAdaptive & 0x01) << 3)
+    );
+  }
 }
 module.exports.Settings_t = Settings_t;
 
@@ -676,5 +908,14 @@ typedef struct {
   uint8_t WheelSensor1_pulses_per_rev;
   uint8_t WheelSensor2_pulses_per_rev;
 
+  // next byte
+  // how often we log while braking or fast, logPeriodicity is used
+  // the rest of the time
+  uint8_t logFastPeriodicity: 3;
+  // 0=always log at logPeriodicity
+  uint8_t logAdaptive: 1;
+  // log fast above this speed on ground, revs/sec, 0 only when braking
+  uint8_t logFastSpeed;
+
 } Settings_t;
 */
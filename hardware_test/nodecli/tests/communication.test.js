@@ -3,7 +3,7 @@
  */
 
 const {
-  sendBuf, CommsCmdType_e,
+  sendBuf, sendBatch, CommsCmdType_e, COMMS_VERSION,
   fetchDiagValues, setDiag,
   clearDiag, fetchSettings,
   saveSettings
@@ -33,7 +33,23 @@ test('VERSION', async ()=>{
   const frm = res.onefrm();
   expect(frm.cmd).toBe(CommsCmdType_e.commsCmd_version);
   expect(frm.len).toBe(4);
-  expect(frm.data[0]).toBe(1);
+  expect(frm.data[0]).toBe(COMMS_VERSION);
+});
+
+test('BATCH', async ()=>{
+  const frms = (await sendBatch([
+    {cmd: CommsCmdType_e.commsCmd_Ping},
+    {cmd: CommsCmdType_e.commsCmd_version},
+    {cmd: CommsCmdType_e.commsCmd_Reset} // not allowed in a batch
+  ])).map(pkg=>pkg.onefrm());
+  expect(frms.length).toBe(4);
+  expect(frms[0].cmd).toBe(CommsCmdType_e.commsCmd_Batch);
+  expect(frms[0].data[0]).toBe(3);
+  expect(frms[1].cmd).toBe(CommsCmdType_e.commsCmd_Pong);
+  expect(frms[2].cmd).toBe(CommsCmdType_e.commsCmd_version);
+  expect(frms[2].data[0]).toBe(COMMS_VERSION);
+  expect(frms[3].cmd).toBe(CommsCmdType_e.commsCmd_Error);
+  expect(frms.every(frm=>frm.reqId===frms[0].reqId)).toBe(true);
 });
 
 test('ERROR', async ()=>{
@@ -50,10 +66,53 @@ test('OK_IS_ERROR', async ()=>{
   expect(frm.len).toBe(3);
 });
 
+test('LOG_SINCE_WITHOUT_SEQ', async ()=>{
+  // seq of newest page host has is required
+  const res = await sendBuf([0, 0], CommsCmdType_e.commsCmd_LogGetSince, true);
+  const frm = res.onefrm();
+  expect(frm.cmd).toBe(CommsCmdType_e.commsCmd_Error);
+  expect(frm.len).toBe(3);
+});
+
+test('LOG_RANGE_WITHOUT_SEQ', async ()=>{
+  // first and last seq is required
+  const res = await sendBuf([0, 0, 0, 0], CommsCmdType_e.commsCmd_LogGetRange, true);
+  const frm = res.onefrm();
+  expect(frm.cmd).toBe(CommsCmdType_e.commsCmd_Error);
+  expect(frm.len).toBe(3);
+});
+
 test('FW_HASH', async ()=>{
   const res = await sendBuf([], CommsCmdType_e.commsCmd_fwHash, true);
   const frm = res.onefrm();
   expect(frm.cmd).toBe(CommsCmdType_e.commsCmd_fwHash);
   expect(frm.len).toBe(10);
   expect(frm.data.map(c=>String.fromCharCode(c)).join('')).toBeAlphaNumeric();
-});
\ No newline at end of file
+});
+test('LONG_CMD_RUNS_BESIDE', async ()=>{
+  const C = CommsCmdType_e;
+  // resolves at header frame, the rest of the log is still coming
+  const hdr = (await sendBuf([], C.commsCmd_LogGetAll, true)).onefrm();
+  expect(hdr.cmd).toBe(C.commsCmd_LogGetAll | 0x80);
+
+  const pong = (await sendBuf([], C.commsCmd_Ping, true)).onefrm();
+  expect(pong.cmd).toBe(C.commsCmd_Pong);
+
+  const st = (await sendBuf([], C.commsCmd_JobStatus, true)).onefrm();
+  expect(st.cmd).toBe(C.commsCmd_JobStatus);
+  expect(st.len).toBe(14);
+  expect(st.data[1]).toBe(C.commsCmd_LogGetAll);
+  expect(st.data[2]).toBe(hdr.reqId);
+  const done = st.data.slice(3, 7).reduce((v, b)=>v * 256 + b, 0),
+        total = st.data.slice(7, 11).reduce((v, b)=>v * 256 + b, 0);
+  expect(done).toBeLessThanOrEqual(total);
+
+  // only one long command at a time
+  if (st.data[0]) {
+    const busy = (await sendBuf([], C.commsCmd_CaptureGetAll, true)).onefrm();
+    expect(busy.cmd).toBe(C.commsCmd_Error);
+  }
+
+  const cancel = (await sendBuf([], C.commsCmd_JobCancel, true)).onefrm();
+  expect(cancel.cmd).toBe(st.data[0] ? C.commsCmd_OK : C.commsCmd_Error);
+});
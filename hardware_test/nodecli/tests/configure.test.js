@@ -8,7 +8,9 @@ const {
   clearDiag, fetchSettings,
   saveSettings,
   Settings_t,
-  defaultSettings
+  defaultSettings,
+  nameHash, fetchSettingsFields,
+  getSettingsFields, setSettingsFields
 } = require('../RC_talk_layer');
 
 const {setupRc, closeRc} = require('../test_setup');
@@ -62,4 +64,54 @@ test("Set default settings", async ()=>{
   const sett = await fetchSettings();
   const jsDefault = new Settings_t();
   expect(sett).toEqual(jsDefault);
-});
\ No newline at end of file
+});
+test("Settings fields", async ()=>{
+  const fields = await fetchSettingsFields();
+  const byName = (name)=>fields.find(f=>f.hash === nameHash(name));
+  // every field in Settings_t is there
+  for (const key of Object.keys(new Settings_t()).filter(k=>k !== 'header'))
+    expect(byName(key)).toBeDefined();
+
+  const sett = await fetchSettings();
+  const ppr = byName('WheelSensor1_pulses_per_rev'),
+        force = byName('max_brake_force');
+  expect((await getSettingsFields([ppr.id, force.id])))
+    .toEqual([sett.WheelSensor1_pulses_per_rev, sett.max_brake_force]);
+
+  const frm = (await setSettingsFields([{id: ppr.id, vlu: 42}])).onefrm();
+  expect(frm.cmd).toBe(CommsCmdType_e.commsCmd_OK);
+  sett.WheelSensor1_pulses_per_rev = 42;
+  expect(await fetchSettings()).toEqual(sett);
+
+  // out of range, nothing is set
+  const bad = (await setSettingsFields([
+    {id: ppr.id, vlu: 7}, {id: force.id, vlu: force.max + 1}])).onefrm();
+  expect(bad.cmd).toBe(CommsCmdType_e.commsCmd_Error);
+  expect(await fetchSettings()).toEqual(sett);
+});
+
+test("Live tune", async ()=>{
+  const tuneCmd = async (cmd)=>(await sendBuf([], cmd, true)).onefrm().cmd;
+  const fields = await fetchSettingsFields();
+  const force = fields.find(f=>f.hash === nameHash('max_brake_force'));
+  const saved = await fetchSettings();
+  const tuned = saved.max_brake_force > 10 ? 10 : 20;
+
+  // reverted, device goes back to what it had saved
+  expect(await tuneCmd(CommsCmdType_e.commsCmd_SettingsTune))
+    .toBe(CommsCmdType_e.commsCmd_OK);
+  await setSettingsFields([{id: force.id, vlu: tuned}]);
+  expect((await fetchSettings()).max_brake_force).toBe(tuned);
+  expect(await tuneCmd(CommsCmdType_e.commsCmd_SettingsRevert))
+    .toBe(CommsCmdType_e.commsCmd_OK);
+  expect(await fetchSettings()).toEqual(saved);
+
+  // committed, tuned value stays
+  await tuneCmd(CommsCmdType_e.commsCmd_SettingsTune);
+  await setSettingsFields([{id: force.id, vlu: tuned}]);
+  expect(await tuneCmd(CommsCmdType_e.commsCmd_SettingsCommit))
+    .toBe(CommsCmdType_e.commsCmd_OK);
+  expect(await tuneCmd(CommsCmdType_e.commsCmd_SettingsRevert))
+    .toBe(CommsCmdType_e.commsCmd_OK);
+  expect((await fetchSettings()).max_brake_force).toBe(tuned);
+});
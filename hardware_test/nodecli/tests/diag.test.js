@@ -5,7 +5,9 @@
 const {
   sendBuf, CommsCmdType_e,
   fetchDiagValues, setDiag,
-  clearDiag,
+  clearDiag, fetchI2cStats,
+  fetchProfile,
+  subscribeDiag,
   DiagReadVluPkg_t,
   DiagSetVluPkg_t,
   setVluPkgType_e,
@@ -101,3 +103,62 @@ test('Force acceleration', async ()=>{
     expect(diag.accelAxis[axis]).toBe(diagPkg.data[0]);
   }
 });
+
+test('Get I2C bus stats', async ()=>{
+  const stats = await fetchI2cStats();
+  expect(Object.keys(stats)).toEqual(['accel', 'settings', 'logger', 'comms']);
+  // settings are loaded from EEPROM at boot
+  expect(stats.settings.jobs).toBeGreaterThan(0);
+  for (const st of Object.values(stats)) {
+    expect(st.maxWait).toBeGreaterThanOrEqual(st.avgWait);
+    expect(st.errors).toBeLessThanOrEqual(st.jobs);
+  }
+});
+
+test('Clear I2C bus stats', async ()=>{
+  await fetchI2cStats(true);
+  const stats = await fetchI2cStats();
+  expect(stats.settings.jobs).toBe(0);
+  expect(stats.settings.maxWait).toBe(0);
+});
+
+test('Subscribe diag stream', async ()=>{
+  const got = [];
+  expect(await subscribeDiag(20, (pkg)=>got.push(pkg))).toBe(true);
+  await new Promise(res=>setTimeout(res, 500));
+  expect(await subscribeDiag(0)).toBe(true);
+  const cnt = got.length;
+  // brake loop laps at 20ms when idle, some slack for USB
+  expect(cnt).toBeGreaterThan(10);
+  for (let i = 1; i < cnt; ++i) {
+    expect(got[i].seq).toBeGreaterThan(got[i-1].seq);
+    expect(got[i].timeMs).toBeGreaterThan(got[i-1].timeMs);
+  }
+  expect(got[cnt-1].dropped).toBe(0);
+  // nothing after unsubscribe
+  await new Promise(res=>setTimeout(res, 100));
+  expect(got.length).toBe(cnt);
+});
+
+test('Get profile', async ()=>{
+  const prof = await fetchProfile();
+  expect(prof.cpuMHz).toBe(48);
+  expect(prof.cpuLoad).toBeLessThanOrEqual(1000);
+  expect(prof.cpuLoadMax).toBeGreaterThanOrEqual(prof.cpuLoad);
+  for (const name of Object.keys(prof.stacks)) {
+    const st = prof.stacks[name];
+    // every thread has run, none has gone through its fill
+    expect(st.size).toBeGreaterThan(0);
+    expect(st.unused).toBeGreaterThan(0);
+    expect(st.unused).toBeLessThan(st.size);
+  }
+  expect(Object.keys(prof.i2cErrors))
+    .toEqual(['timeouts', 'busErrors', 'arbLost', 'nacks', 'overruns']);
+});
+
+test('Clear profile max', async ()=>{
+  await fetchProfile(true);
+  const prof = await fetchProfile();
+  // at most one window ends between the reads
+  expect([0, prof.cpuLoad]).toContain(prof.cpuLoadMax);
+});
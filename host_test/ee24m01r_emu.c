@@ -0,0 +1,192 @@
+/*
+ * ee24m01r_emu.c
+ *
+ * Host side 24M01R emulator, implements i2cMasterTransmitTimeout
+ */
+
+#include "ee24m01r_emu.h"
+#include "board.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define DEV_ADDR_MASK   0xFEU  /* bit 0 selects the bank */
+#define DEV_ADDR        0x50U
+
+EmuConfig_t emuCfg = {
+  3000,   /* datasheet max is 5ms, typically done well before */
+  1000000
+};
+EmuFaults_t emuFaults;
+EmuStats_t emuStats;
+static uint8_t ramMem[EMU_CAPACITY];
+uint8_t *emuMem = ramMem;
+I2CDriver I2CD1;
+
+// ----------------------------------------------------------------
+// private stuff
+
+static uint64_t busyUntilUs = 0;
+static uint32_t busyPage = 0;
+static bool writeControl = true; /* WC pin high, write protected */
+
+static void busTime(uint32_t bytes) {
+  // 9 clocks for each byte with ACK, +2 for start and stop
+  shimNowUs += ((uint64_t)bytes * 9 + 2) * 1000000 / emuCfg.busHz;
+}
+
+// ----------------------------------------------------------------
+// public stuff
+
+void emuReset(void) {
+  memset(emuMem, 0xFF, EMU_CAPACITY);
+  memset(&emuStats, 0, sizeof(emuStats));
+  busyUntilUs = 0;
+  shimNowUs = 0;
+}
+
+int emuOpen(const char *path) {
+  const int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+  const off_t size = lseek(fd, 0, SEEK_END);
+  if (size != EMU_CAPACITY && ftruncate(fd, EMU_CAPACITY) != 0) {
+    perror(path);
+    close(fd);
+    return -1;
+  }
+  void *mem = mmap(NULL, EMU_CAPACITY, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+  emuMem = mem;
+  if (size != EMU_CAPACITY)
+    memset(emuMem, 0xFF, EMU_CAPACITY);
+  return 0;
+}
+
+void emuPowerCycle(void) {
+  busyUntilUs = 0;
+  writeControl = true;
+}
+
+uint32_t emuMaxPageWrites(void) {
+  uint32_t max = 0;
+  for (uint32_t i = 0; i < EMU_PAGES; ++i)
+    if (emuStats.pageWrites[i] > max)
+      max = emuStats.pageWrites[i];
+  return max;
+}
+
+bool emuWriteCycleBusy(uint32_t *page) {
+  *page = busyPage;
+  return shimNowUs < busyUntilUs;
+}
+
+void i2cStart(I2CDriver *i2cp, const I2CConfig *config) {
+  i2cp->config = config;
+}
+
+void i2cStop(I2CDriver *i2cp) {
+  i2cp->config = NULL;
+}
+
+i2cflags_t i2cGetErrors(I2CDriver *i2cp) {
+  (void)i2cp;
+  // the only way a transfer fails here
+  return I2C_ACK_FAILURE;
+}
+
+void palSetLine(ioline_t line) {
+  if (line == LINE_I2C_WC)
+    writeControl = true;
+}
+
+void palClearLine(ioline_t line) {
+  if (line == LINE_I2C_WC)
+    writeControl = false;
+}
+
+msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp, i2caddr_t addr,
+                               const uint8_t *txbuf, size_t txbytes,
+                               uint8_t *rxbuf, size_t rxbytes,
+                               sysinterval_t timeout)
+{
+  (void)i2cp;
+  (void)timeout;
+  ++emuStats.transfers;
+
+  // device select is NACKed during write cycle or if not our address
+  if (shimNowUs < busyUntilUs || (addr & DEV_ADDR_MASK) != DEV_ADDR) {
+    busTime(1);
+    if (shimNowUs < busyUntilUs)
+      ++emuStats.nacks;
+    return MSG_RESET;
+  }
+
+  if (emuFaults.nackPermille > 0 &&
+      (uint32_t)(rand() % 1000) < emuFaults.nackPermille)
+  {
+    busTime(1);
+    ++emuStats.injectedNacks;
+    return MSG_RESET;
+  }
+
+  shimAssert(txbytes >= 2, "24M01R needs a 2 byte memory address");
+  uint32_t memAddr = ((uint32_t)(addr & 0x01U) << 16) |
+                     (uint32_t)txbuf[0] << 8 | txbuf[1];
+
+  if (rxbytes > 0) {
+    // random read, address counter rolls over within the 64k bank
+    // selected by device address
+    busTime(1 + txbytes + 1 + rxbytes);
+    const uint32_t bank = memAddr & 0x10000U;
+    for (size_t i = 0; i < rxbytes; ++i)
+      rxbuf[i] = emuMem[(bank | ((memAddr + i) & 0xFFFFU)) % EMU_CAPACITY];
+    emuStats.bytesRead += rxbytes;
+    return MSG_OK;
+  }
+
+  busTime(1 + txbytes);
+  const size_t dataBytes = txbytes - 2;
+  if (dataBytes == 0)
+    return MSG_OK; // only sets address, as in ACK polling
+
+  // data bytes are NACKed when write protected
+  if (writeControl)
+    return MSG_RESET;
+
+  // page write, address rolls over within the page
+  const uint32_t page = memAddr / EMU_PAGE_SIZE;
+  size_t stored = dataBytes;
+  const bool powerLoss = emuFaults.powerLossAtCycle != 0 &&
+                         emuStats.writeCycles + 1 == emuFaults.powerLossAtCycle;
+  if (powerLoss && emuFaults.tornBytes < stored)
+    stored = emuFaults.tornBytes;
+
+  for (size_t i = 0; i < stored; ++i) {
+    const uint32_t a = page * EMU_PAGE_SIZE +
+                       (memAddr + i) % EMU_PAGE_SIZE;
+    emuMem[a] = txbuf[2 + i];
+  }
+
+  emuStats.bytesWritten += dataBytes;
+  ++emuStats.writeCycles;
+  ++emuStats.pageWrites[page];
+  busyUntilUs = shimNowUs + emuCfg.writeCycleUs;
+  busyPage = page;
+
+  if (powerLoss) {
+    shimAssert(emuFaults.onPowerLoss != NULL, "no power loss handler");
+    emuFaults.onPowerLoss();
+  }
+  return MSG_OK;
+}
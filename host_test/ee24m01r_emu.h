@@ -0,0 +1,82 @@
+/*
+ * ee24m01r_emu.h
+ *
+ * Emulates a 24M01R EEPROM on the I2C bus for host builds.
+ * Models page roll over, the bank bit in the device address, the WC pin,
+ * bus transfer time and the internal write cycle during which the
+ * device NACKs everything.
+ * Memory can be backed by a file so it survives between runs and is
+ * shared with forked processes, each process then being one boot.
+ */
+
+#ifndef HOST_EE24M01R_EMU_H_
+#define HOST_EE24M01R_EMU_H_
+
+#include <stdint.h>
+#include "hal.h"
+
+#define EMU_CAPACITY    (128U * 1024U)
+#define EMU_PAGE_SIZE   256U
+#define EMU_PAGES       (EMU_CAPACITY / EMU_PAGE_SIZE)
+
+typedef struct {
+  uint32_t writeCycleUs;  /* duration of internal write cycle */
+  uint32_t busHz;         /* I2C clock */
+} EmuConfig_t;
+
+/**
+ * @brief injected faults, zero disables
+ */
+typedef struct {
+  uint32_t powerLossAtCycle; /* lose power during this write cycle,
+                                counted as emuStats.writeCycles */
+  uint32_t tornBytes;        /* bytes of that page write that reaches
+                                the memory array before power is gone */
+  void (*onPowerLoss)(void); /* called when power is lost, must not
+                                return, the device is dead */
+  uint32_t nackPermille;     /* random NACK of device select */
+} EmuFaults_t;
+
+typedef struct {
+  uint32_t transfers,     /* all transfers started on bus */
+           nacks,         /* transfers NACKed due to a write cycle */
+           writeCycles,   /* number of internal write cycles */
+           bytesWritten,  /* data bytes written */
+           bytesRead,
+           injectedNacks;
+  uint32_t pageWrites[EMU_PAGES]; /* write cycles per page, ie. wear */
+} EmuStats_t;
+
+extern EmuConfig_t emuCfg;
+extern EmuFaults_t emuFaults;
+extern EmuStats_t emuStats;
+extern uint8_t *emuMem;
+
+/**
+ * @brief reset memory to erased state (0xFF), stats and virtual time
+ */
+void emuReset(void);
+
+/**
+ * @brief back memory with file at path, created erased if missing
+ * @returns 0 on success
+ */
+int emuOpen(const char *path);
+
+/**
+ * @brief as when device powers up, no write cycle in progress
+ */
+void emuPowerCycle(void);
+
+/**
+ * @brief highest write cycle count of any page
+ */
+uint32_t emuMaxPageWrites(void);
+
+/**
+ * @brief true while an internal write cycle runs, page is set to the
+ *        page being written
+ */
+bool emuWriteCycleBusy(uint32_t *page);
+
+#endif /* HOST_EE24M01R_EMU_H_ */
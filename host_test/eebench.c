@@ -0,0 +1,139 @@
+/*
+ * eebench.c
+ *
+ * Runs drv/ee24m01r.c against the EEPROM emulator and reports how long
+ * typical workloads take in emulated time. Built once for each driver
+ * configuration, see Makefile.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ee24m01r.h"
+#include "ee24m01r_emu.h"
+
+// same layout as eeprom.c, log starts after the 15 byte settings
+#define SETTINGS_SIZE   15U
+#define RECORD_SIZE     11U
+#define RECORD_CNT      2000U
+
+static const ee24partition_t log_ee = {
+  &I2CD1,
+  EE24M01R_I2C_LOW_BANK(0),
+  SETTINGS_SIZE,
+  EE24M01R_TOTAL_CAPACITY - SETTINGS_SIZE
+};
+
+static void report(const char *name, uint32_t bytes) {
+  const double secs = (double)shimNowUs / 1e6;
+  printf("  %-10s %8.3f s %8.1f kB/s  cycles:%6u nacks:%6u max page wear:%u\n",
+         name, secs, bytes / secs / 1024.0,
+         emuStats.writeCycles, emuStats.nacks, emuMaxPageWrites());
+}
+
+static int verify(uint32_t start, uint32_t len, uint8_t (*expect)(uint32_t)) {
+  static uint8_t buf[4096];
+  ee24_arg_t arg = {&log_ee, 0, buf, 0, 0, {0, 0}, i2cClient_Logger};
+  for (uint32_t pos = 0; pos < len; pos += arg.len) {
+    arg.offset = start + pos;
+    arg.len = len - pos < sizeof(buf) ? len - pos : sizeof(buf);
+    if (ee24m01r_read(&arg) != MSG_OK) {
+      printf("read failed at %u\n", arg.offset);
+      return 1;
+    }
+    for (uint32_t i = 0; i < arg.len; ++i) {
+      if (buf[i] != expect(pos + i)) {
+        printf("verify failed at %u\n", arg.offset + i);
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static uint8_t zero(uint32_t pos) { (void)pos; return 0; }
+static uint8_t pattern(uint32_t pos) { return (uint8_t)(pos * 7 + pos / 251); }
+
+// zero fill whole log in page sized writes, driver page write throughput
+static int benchClear(void) {
+  static uint8_t buf[EE24M01R_PAGE_SIZE];
+  memset(buf, 0, sizeof(buf));
+  ee24_arg_t arg = {&log_ee, 0, buf, 0, 0, {0, 0}, i2cClient_Comms};
+
+  emuReset();
+  for (arg.offset = 0; arg.offset < log_ee.size; arg.offset += arg.len) {
+    arg.len = arg.offset + sizeof(buf) < log_ee.size ?
+                sizeof(buf) : log_ee.size - arg.offset;
+    if (ee24m01r_write(&arg) != MSG_OK) {
+      printf("write failed at %u\n", arg.offset);
+      return 1;
+    }
+  }
+  report("clear", log_ee.size);
+  return verify(0, log_ee.size, zero);
+}
+
+// as LoggerThd, many small records written back to back
+static int benchRecords(void) {
+  static uint8_t rec[RECORD_SIZE];
+  ee24_arg_t arg = {&log_ee, 0, rec, 0, RECORD_SIZE, {0, 0}, i2cClient_Logger};
+
+  emuReset();
+  for (uint32_t i = 0; i < RECORD_CNT; ++i) {
+    for (uint32_t j = 0; j < RECORD_SIZE; ++j)
+      rec[j] = pattern(i * RECORD_SIZE + j);
+    arg.offset = i * RECORD_SIZE;
+    arg.len = RECORD_SIZE;
+    if (ee24m01r_write(&arg) != MSG_OK) {
+      printf("write failed at %u\n", arg.offset);
+      return 1;
+    }
+  }
+  report("records", RECORD_CNT * RECORD_SIZE);
+  return verify(0, RECORD_CNT * RECORD_SIZE, pattern);
+}
+
+// as loggerReadAll, whole log read in blocks of blockSize, bus time
+// only, driver and thread switch per transfer is not modelled
+static int benchRead(const char *name, uint16_t blockSize) {
+  static uint8_t buf[EE24M01R_PAGE_SIZE];
+  ee24_arg_t arg = {&log_ee, 0, buf, 0, 0, {0, 0}, i2cClient_Comms};
+
+  emuReset();
+  for (uint32_t i = 0; i < log_ee.size; ++i)
+    emuMem[log_ee.startAddr + i] = pattern(i);
+
+  for (arg.offset = 0; arg.offset < log_ee.size; arg.offset += arg.len) {
+    arg.len = arg.offset + blockSize < log_ee.size ?
+                blockSize : log_ee.size - arg.offset;
+    if (ee24m01r_read(&arg) != MSG_OK) {
+      printf("read failed at %u\n", arg.offset);
+      return 1;
+    }
+    for (uint32_t i = 0; i < arg.len; ++i) {
+      if (buf[i] != pattern(arg.offset + i)) {
+        printf("verify failed at %u\n", arg.offset + i);
+        return 1;
+      }
+    }
+  }
+  report(name, log_ee.size);
+  printf("  %-10s %u transfers\n", "", emuStats.transfers);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1)
+    emuCfg.writeCycleUs = (uint32_t)atoi(argv[1]);
+
+  printf("%s polling, %u byte chunks, write cycle %u us\n",
+         EE24M01R_USE_ACK_POLLING ? "ACK" : "fixed wait",
+         EE24M01R_WRITE_CHUNK_SIZE, emuCfg.writeCycleUs);
+
+  i2cStart(&I2CD1, NULL);
+  int err = benchClear();
+  err |= benchRecords();
+  err |= benchRead("read 59", 59);
+  err |= benchRead("read 256", EE24M01R_PAGE_SIZE);
+  return err;
+}
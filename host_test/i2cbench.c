@@ -0,0 +1,71 @@
+/*
+ * i2cbench.c
+ *
+ * Checks bus arbitration in i2c_bus.c. The shim has one thread, the
+ * suspend hook acts as the other threads while a client waits for the
+ * bus, so the order the bus is granted in can be checked.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "i2c_bus.h"
+
+static I2cBusJob_t logJob, settingsJob, accelJob;
+static uint8_t granted[3], grantCnt;
+static int depth;
+
+static void acquire(I2cBusJob_t *job, uint8_t client) {
+  memset(job, 0, sizeof(*job));
+  job->i2cp = &I2CD1;
+  job->client = client;
+  i2cBusAcquire(job);
+  granted[grantCnt++] = client;
+}
+
+// runs while a client waits, as if other threads ran meanwhile
+static void otherThreads(void) {
+  if (++depth == 1) {
+    // accel queues behind logger but ahead of settings
+    acquire(&accelJob, i2cClient_Accel);
+    i2cBusRelease(&accelJob);
+  } else {
+    // logger is done, bus must go to accel, not run anything here
+    i2cBusRelease(&logJob);
+  }
+}
+
+static int check(bool ok, const char *what) {
+  printf("  %-40s %s\n", what, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
+
+int main(void) {
+  int fails = 0;
+  i2c_busInit();
+  i2cBusClearStats();
+
+  acquire(&logJob, i2cClient_Logger);
+  shimSuspendHook = otherThreads;
+  acquire(&settingsJob, i2cClient_Settings);
+  shimSuspendHook = NULL;
+  i2cBusRelease(&settingsJob);
+
+  printf("i2c bus arbitration\n");
+  fails += check(grantCnt == 3, "every client got the bus");
+  fails += check(granted[0] == i2cClient_Logger &&
+                 granted[1] == i2cClient_Accel &&
+                 granted[2] == i2cClient_Settings,
+                 "high prio passes queued normal prio");
+  fails += check(i2cBusStats[i2cClient_Logger].jobs == 1 &&
+                 i2cBusStats[i2cClient_Accel].jobs == 1 &&
+                 i2cBusStats[i2cClient_Settings].jobs == 1,
+                 "one job counted for each client");
+
+  // bus is free again, next client gets it without waiting
+  shimSuspendHook = NULL;
+  acquire(&logJob, i2cClient_Logger);
+  i2cBusRelease(&logJob);
+  fails += check(grantCnt == 4, "free bus is granted directly");
+
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * logdecode.c
+ *
+ * Host side decoder for the log record formats in logger.h
+ */
+
+#include "logdecode.h"
+#include "eeprom.h"
+#include "crc.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ----------------------------------------------------------------
+// private stuff
+
+static const char *names[LOGITEMS_CNT] = {
+  "speedOnGround", "wheelRPS_0", "wheelRPS_1", "wheelRPS_2",
+  "wantedBrakeForce", "calcBrakeForce",
+  "brakeForce0_out", "brakeForce1_out", "brakeForce2_out",
+  "slip0", "slip1", "slip2",
+  "accelSteering", "wsSteering",
+  "accel", "accelX", "accelY", "accelZ"
+};
+
+// first compressed format, records had no time
+#define LOG_FORMAT_NO_TIME  0x01U
+// last format without crc after each record
+#define LOG_FORMAT_NO_CRC   0x04U
+// old firmware, uncompressed records in a ring
+#define LOG_FORMAT_UNCOMPRESSED  0x5AU
+
+static bool versionHasCrc(uint8_t version) {
+  return version > LOG_FORMAT_NO_CRC && version != LOG_FORMAT_UNCOMPRESSED;
+}
+
+/**
+ * @brief check crc after record ending at pos, pos is moved past it
+ */
+static bool checkCrc(bool hasCrc, const uint8_t *buf, uint32_t len,
+                     uint32_t *pos)
+{
+  if (!hasCrc)
+    return true;
+  if (*pos + LOG_CRC_SIZE > len || buf[*pos] != crc8(buf, *pos))
+    return false;
+  *pos += LOG_CRC_SIZE;
+  return true;
+}
+
+// steering and accelerometer items are int16_t
+static bool isSigned(uint8_t type) {
+  return type >= log_accelSteering && type < LOGITEMS_CNT;
+}
+
+typedef struct {
+  uint32_t seq;
+  uint16_t idx;
+  uint8_t used;
+} Page_t;
+
+static int cmpPage(const void *a, const void *b) {
+  const uint32_t sa = ((const Page_t*)a)->seq,
+                 sb = ((const Page_t*)b)->seq;
+  return sa < sb ? -1 : sa > sb;
+}
+
+static int32_t getVarint(const uint8_t *buf, uint32_t len, uint32_t *pos,
+                         uint32_t *vlu)
+{
+  *vlu = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (*pos >= len)
+      return -1;
+    const uint8_t byte = buf[(*pos)++];
+    *vlu |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return 0;
+  }
+  return -1;
+}
+
+static int32_t unzigzag(uint32_t vlu) {
+  return (int32_t)(vlu >> 1) ^ -(int32_t)(vlu & 1);
+}
+
+static int32_t decodeCompressed(LogDecoder_t *dec, const uint8_t *buf,
+                                uint32_t len, LogRecord_t *rec)
+{
+  const bool keyframe = buf[0] == LOG_KIND_KEYFRAME,
+             hasTime = dec->version != LOG_FORMAT_NO_TIME;
+  uint32_t pos = 1, mask, ms = 0;
+  if (hasTime && getVarint(buf, len, &pos, &ms) != 0)
+    return -1;
+  if (getVarint(buf, len, &pos, &mask) != 0 || mask >> LOGITEMS_CNT)
+    return -1;
+
+  *rec = dec->last;
+  rec->kind = buf[0];
+  rec->coldStart = false;
+  rec->schema = false;
+  rec->rate = false;
+  rec->hasTime = hasTime;
+  rec->timeMs = keyframe ? ms : rec->timeMs + ms;
+  if (keyframe)
+    rec->mask = mask;
+
+  for (uint8_t i = 0; i < LOGITEMS_CNT; ++i) {
+    if ((mask & (1UL << i)) == 0)
+      continue;
+    uint32_t zz;
+    if (getVarint(buf, len, &pos, &zz) != 0)
+      return -1;
+    rec->vlu[i] = keyframe ? unzigzag(zz) : rec->vlu[i] + unzigzag(zz);
+  }
+  if (!checkCrc(dec->crc, buf, len, &pos))
+    return -1;
+
+  if (keyframe)
+    dec->synced = true;
+  rec->valid = dec->synced && (mask & ~rec->mask) == 0;
+  if (rec->valid)
+    dec->last = *rec;
+  return (int32_t)pos;
+}
+
+static int32_t decodeSchema(LogDecoder_t *dec, const uint8_t *buf,
+                            uint32_t len, LogRecord_t *rec)
+{
+  const uint8_t cnt = len > 1 ? buf[1] : 0;
+  uint32_t size = 2 + cnt * sizeof(LogSchemaItem_t);
+  if (cnt == 0 || cnt > LOGITEMS_CNT || size > len ||
+      !checkCrc(dec->crc, buf, len, &size))
+  {
+    return -1;
+  }
+
+  memset(rec, 0, sizeof(*rec));
+  rec->kind = buf[0];
+  rec->schema = true;
+  rec->valid = true;
+  memcpy(dec->schema, &buf[2], cnt * sizeof(LogSchemaItem_t));
+  dec->schemaCnt = cnt;
+  return (int32_t)size;
+}
+
+static int32_t decodeRate(LogDecoder_t *dec, const uint8_t *buf,
+                          uint32_t len, LogRecord_t *rec)
+{
+  uint32_t size = LOG_RATE_SIZE;
+  if (len < size || !checkCrc(dec->crc, buf, len, &size))
+    return -1;
+
+  memset(rec, 0, sizeof(*rec));
+  rec->kind = buf[0];
+  rec->rate = true;
+  rec->periodicity = buf[1];
+  rec->valid = true;
+  return (int32_t)size;
+}
+
+static int32_t decodeSync(LogDecoder_t *dec, const uint8_t *buf,
+                          uint32_t len, LogRecord_t *rec)
+{
+  // only formats with crc have sync records
+  uint32_t size = LOG_SYNC_SIZE;
+  if (len < size || !checkCrc(true, buf, len, &size))
+    return -1;
+
+  memset(rec, 0, sizeof(*rec));
+  rec->kind = buf[0];
+  rec->sync = true;
+  rec->seq = (uint32_t)buf[1] << 24 | (uint32_t)buf[2] << 16 |
+             (uint32_t)buf[3] << 8 | buf[4];
+  rec->valid = true;
+  // page decodes on its own, it starts with a keyframe
+  dec->crc = true;
+  dec->synced = false;
+  return (int32_t)size;
+}
+
+static int32_t decodeUncompressed(LogDecoder_t *dec, const uint8_t *buf,
+                                  uint32_t len, LogRecord_t *rec)
+{
+  const uint8_t size = buf[0], itemCnt = buf[1];
+  if (size < 2 || size > len)
+    return -1;
+
+  memset(rec, 0, sizeof(*rec));
+  rec->valid = true;
+  for (uint32_t pos = 2, i = 0; i < itemCnt; ++i) {
+    if (pos >= size)
+      return -1;
+    const uint8_t type = buf[pos] >> 2,
+                  bytes = (buf[pos] & 0x03) + 1;
+    if (pos + 1 + bytes > size)
+      return -1;
+    uint32_t vlu = 0;
+    for (uint8_t j = 0; j < bytes; ++j)
+      vlu = vlu << 8 | buf[pos + 1 + j];
+
+    if (type == log_coldStart) {
+      rec->coldStart = true;
+      rec->version = (uint8_t)vlu;
+    } else if (type < LOGITEMS_CNT) {
+      if (isSigned(type) && bytes < 4 && (vlu & (1UL << (bytes * 8 - 1))))
+        vlu |= ~0UL << (bytes * 8);
+      rec->vlu[type] = (int32_t)vlu;
+      rec->mask |= 1UL << type;
+    }
+    pos += 1 + bytes;
+  }
+  // format of a coldstart tells if it has a crc
+  const bool hasCrc = rec->coldStart ? versionHasCrc(rec->version) : dec->crc;
+  uint32_t pos = size;
+  if (!checkCrc(hasCrc, buf, len, &pos))
+    return -1;
+  if (rec->coldStart) {
+    dec->version = rec->version;
+    dec->crc = hasCrc;
+    dec->synced = false;
+    dec->schemaCnt = 0;
+  }
+  return (int32_t)pos;
+}
+
+// ----------------------------------------------------------------
+// public stuff
+
+int32_t logDecode(LogDecoder_t *dec, const uint8_t *buf, uint32_t len,
+                  LogRecord_t *rec)
+{
+  if (len == 0 || buf[0] == 0)
+    return 0; // zero filled, end of records
+  if (buf[0] == LOG_KIND_KEYFRAME || buf[0] == LOG_KIND_DELTA)
+    return decodeCompressed(dec, buf, len, rec);
+  if (buf[0] == LOG_KIND_SCHEMA)
+    return decodeSchema(dec, buf, len, rec);
+  if (buf[0] == LOG_KIND_RATE)
+    return decodeRate(dec, buf, len, rec);
+  if (buf[0] == LOG_KIND_SYNC)
+    return decodeSync(dec, buf, len, rec);
+  if (buf[0] >= 0x80 || len < 2)
+    return -1;
+  return decodeUncompressed(dec, buf, len, rec);
+}
+
+uint32_t logResync(const uint8_t *buf, uint32_t len) {
+  for (uint32_t pos = 1; pos + LOG_SYNC_SIZE + LOG_CRC_SIZE <= len; ++pos) {
+    if (buf[pos] == LOG_KIND_SYNC &&
+        buf[pos + LOG_SYNC_SIZE] == crc8(&buf[pos], LOG_SYNC_SIZE))
+    {
+      return pos;
+    }
+  }
+  return len;
+}
+
+uint32_t logLinearize(const uint8_t *part, uint8_t *out) {
+  static Page_t pages[EEPROM_LOG_PAGES];
+  uint32_t cnt = 0, len = 0;
+
+  for (uint16_t i = 0; i < EEPROM_LOG_PAGES; ++i) {
+    const uint8_t *page = &part[i * EEPROM_PAGE_SIZE];
+    const LogPageTrailer_t *tr =
+        (const LogPageTrailer_t*)&page[LOG_PAGE_PAYLOAD];
+    if (tr->used == 0 || tr->used > LOG_PAGE_PAYLOAD ||
+        tr->crc != crc8(page, EEPROM_PAGE_SIZE - 1))
+    {
+      continue;
+    }
+    const uint32_t seq = (uint32_t)tr->seq[0] << 24 |
+                         (uint32_t)tr->seq[1] << 16 |
+                         (uint32_t)tr->seq[2] << 8 | tr->seq[3];
+    // torn rewrite of an old page that kept the old trailer
+    if (page[0] == LOG_KIND_SYNC &&
+        (page[LOG_SYNC_SIZE] != crc8(page, LOG_SYNC_SIZE) ||
+         memcmp(&page[1], tr->seq, sizeof(tr->seq)) != 0))
+    {
+      continue;
+    }
+    pages[cnt].seq = seq;
+    pages[cnt].idx = i;
+    pages[cnt++].used = tr->used;
+  }
+  qsort(pages, cnt, sizeof(pages[0]), cmpPage);
+
+  // a clear leaves pages of the generation before, newest is current,
+  // a page number that carried into the generation bits follows directly
+  uint32_t first = cnt > 0 ? cnt - 1 : 0;
+  while (first > 0 &&
+         (((pages[first - 1].seq ^ pages[first].seq) & LOG_GEN_MASK) == 0 ||
+          pages[first - 1].seq + 1 == pages[first].seq))
+  {
+    --first;
+  }
+
+  for (uint32_t i = first; i < cnt; ++i) {
+    memcpy(&out[len], &part[pages[i].idx * EEPROM_PAGE_SIZE], pages[i].used);
+    len += pages[i].used;
+  }
+  return len;
+}
+
+uint8_t logItemBytes(uint8_t type) {
+  if (type >= log_slip0 && type < LOGITEMS_CNT)
+    return 2;
+  return 1;
+}
+
+const char *logItemName(uint8_t type) {
+  return type < LOGITEMS_CNT ? names[type] : "unknown";
+}
+
+uint16_t logNameHash(const char *name) {
+  uint32_t h = 0x811C9DC5UL;
+  while (*name) {
+    h ^= (uint8_t)*name++;
+    h *= 0x01000193UL;
+  }
+  return (uint16_t)((h >> 16) ^ h);
+}
@@ -0,0 +1,79 @@
+/*
+ * logdecode.h
+ *
+ * Decodes log records as stored by logger.c, both uncompressed LogBuf_t
+ * records, keyframe/delta, schema, rate and sync records. Same rules as LogRoot in
+ * webfrontend/logic/logger.js.
+ */
+
+#ifndef HOST_LOGDECODE_H_
+#define HOST_LOGDECODE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "logger.h"
+
+typedef struct {
+  int32_t vlu[LOGITEMS_CNT]; /* indexed by LogType_e */
+  uint32_t mask;             /* bit set for each item in record */
+  uint32_t timeMs;           /* ms since coldstart, if hasTime */
+  bool hasTime;              /* uncompressed records have no time */
+  uint8_t kind;              /* LOG_KIND_*, 0 for uncompressed */
+  bool coldStart;            /* a coldstart record, no values */
+  bool schema;               /* a schema record, no values */
+  bool rate;                 /* a rate record, no values */
+  uint8_t periodicity;       /* rate data, SETTINGS_LOG_* */
+  bool sync;                 /* a sync record, first in page */
+  uint32_t seq;              /* sync data, seq of page */
+  uint8_t version;           /* coldstart data, LOG_FORMAT_VERSION */
+  bool valid;                /* false for a delta without keyframe */
+} LogRecord_t;
+
+typedef struct {
+  LogRecord_t last;          /* deltas are applied to this */
+  bool synced;               /* a keyframe has been seen */
+  uint8_t version;           /* from last coldstart, 0 if none seen */
+  LogSchemaItem_t schema[LOGITEMS_CNT]; /* from last schema record */
+  uint8_t schemaCnt;         /* items in schema, 0 if none since coldstart */
+  bool crc;                  /* records are followed by a crc */
+} LogDecoder_t;
+
+/**
+ * @brief decode one record from buf
+ * @returns bytes used, 0 at end of records, -1 if broken
+ */
+int32_t logDecode(LogDecoder_t *dec, const uint8_t *buf, uint32_t len,
+                  LogRecord_t *rec);
+
+/**
+ * @brief find next sync record after a broken record
+ * @returns offset of sync record after buf[0], len if there is none
+ */
+uint32_t logResync(const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief join valid pages of log partition in seq order, oldest first,
+ *        as LogRoot.linearizePages in the frontend. Pages whose sync
+ *        record doesn't match the trailer are left out.
+ * @param part the log partition, EEPROM_LOG_PAGES pages
+ * @param out room for EEPROM_LOG_SIZE bytes
+ * @returns bytes of records in out
+ */
+uint32_t logLinearize(const uint8_t *part, uint8_t *out);
+
+/**
+ * @brief bytes the item takes in firmware, as an uncompressed item
+ */
+uint8_t logItemBytes(uint8_t type);
+
+/**
+ * @brief name of item, as in LogType_e without log_
+ */
+const char *logItemName(uint8_t type);
+
+/**
+ * @brief FNV-1a hash of name folded to 16 bits, as nameHash in schema
+ */
+uint16_t logNameHash(const char *name);
+
+#endif /* HOST_LOGDECODE_H_ */
@@ -0,0 +1,105 @@
+/*
+ * logdump.c
+ *
+ * Prints a log as CSV, one row per record, one column per item.
+ * Reads a .rclog file as saved by the frontend, or with -e a raw
+ * EEPROM image such as loggerbench.eeprom.
+ *
+ * usage: logdump [-e] file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logdecode.h"
+#include "eeprom.h"
+
+static uint32_t session = 0, recIdx = 0;
+
+static void printRecord(const LogRecord_t *rec) {
+  if (rec->coldStart) {
+    ++session;
+    recIdx = 0;
+    return;
+  }
+  if (rec->schema || rec->rate || rec->sync)
+    return;
+  printf("%u,%u,", session, ++recIdx);
+  if (rec->hasTime)
+    printf("%u.%03u", rec->timeMs / 1000, rec->timeMs % 1000);
+  for (uint8_t i = 0; i < LOGITEMS_CNT; ++i) {
+    if (rec->mask & (1UL << i))
+      printf(",%d", rec->vlu[i]);
+    else
+      printf(",");
+  }
+  printf("\n");
+}
+
+static int dump(const uint8_t *buf, uint32_t start, uint32_t end) {
+  LogDecoder_t dec = {0};
+  LogRecord_t rec;
+  for (uint32_t pos = start; pos < end;) {
+    const int32_t used = logDecode(&dec, &buf[pos], end - pos, &rec);
+    if (used == 0)
+      break;
+    if (used < 0) {
+      // skip to next page, records before it are lost
+      const uint32_t skip = logResync(&buf[pos], end - pos);
+      fprintf(stderr, "broken record at %u, skipped %u bytes\n", pos, skip);
+      pos += skip;
+      continue;
+    }
+    if (rec.valid)
+      printRecord(&rec);
+    pos += used;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  const bool image = argc > 2 && strcmp(argv[1], "-e") == 0;
+  if (argc < 2 || (argc > 2 && !image)) {
+    fprintf(stderr, "usage: %s [-e] file\n", argv[0]);
+    return 2;
+  }
+
+  FILE *fp = fopen(argv[argc - 1], "rb");
+  if (fp == NULL) {
+    perror(argv[argc - 1]);
+    return 1;
+  }
+  static uint8_t buf[256 * 1024], log[256 * 1024];
+  const uint32_t size = (uint32_t)fread(buf, 1, sizeof(buf), fp);
+  fclose(fp);
+
+  printf("session,index,time");
+  for (uint8_t i = 0; i < LOGITEMS_CNT; ++i)
+    printf(",%s", logItemName(i));
+  printf("\n");
+
+  if (image) {
+    if (size < EEPROM_LOG_START_ADDR + EEPROM_LOG_SIZE) {
+      fprintf(stderr, "image too small\n");
+      return 1;
+    }
+    return dump(log, 0, logLinearize(&buf[EEPROM_LOG_START_ADDR], log));
+  }
+
+  // .rclog, records followed by a big endian start position,
+  // older files wraps around at start position
+  if (size < 4)
+    return 1;
+  const uint32_t len = size - 4;
+  uint32_t start = (uint32_t)buf[len] << 24 | (uint32_t)buf[len + 1] << 16 |
+                   (uint32_t)buf[len + 2] << 8 | buf[len + 3];
+  if (start > len)
+    start = 0;
+  int err = dump(buf, start, len);
+  uint32_t pos = 0;
+  while (pos < start && buf[pos] == 0)
+    ++pos;
+  if (!err && pos < start)
+    err = dump(buf, pos, start);
+  return err;
+}
@@ -0,0 +1,862 @@
+/*
+ * loggerbench.c
+ *
+ * Runs the real logger.c on top of the real EEPROM driver and the
+ * emulated 24M01R. Each boot is a forked process sharing the file
+ * backed EEPROM, it logs for a random time and then loses power,
+ * either with a PVD warning or hard in the middle of a page write.
+ * After each boot the log is read back as the host does and checked,
+ * after a graceful boot the host also fetches new pages with
+ * LogGetSince and its copy must match. The newest entry in the session
+ * directory must be this boot, with statistics that match what was
+ * logged. Logging is adaptive, fast while braking or rolling fast and
+ * slow in between, records must be spaced as the rate records say.
+ * Broken records are skipped to next sync record, as the host does.
+ * Halfway the host clears the log, pages from before must be gone
+ * after the following boots although they are still in EEPROM.
+ * Longer boots pause logging for longer than systime_t wraps, the
+ * record after the pause must be as far from the one before in time.
+ * They also get a PVD warning where VDD comes back, logging must go on
+ * in a new session. After a graceful PVD warning power lasts HOLDUP_MS,
+ * every other graceful boot gets it while a log page is written.
+ * The log starts cleared once and CARRY_AFTER_PAGES before the page
+ * number carries into the generation bits of seq.
+ * At the end throughput and wear is reported.
+ *
+ * USB is modeled as a full speed bulk IN endpoint, build with
+ * -DUSB_SOF_PACED to get one packet per frame as before packets were
+ * double buffered.
+ *
+ * usage: loggerbench [boots] [seed] [nack permille]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <setjmp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "logger.h"
+#include "capture.h"
+#include "session.h"
+#include "crc.h"
+#include "eeprom.h"
+#include "settings.h"
+#include "inputs.h"
+#include "brake_logic.h"
+#include "accelerometer.h"
+#include "usbcfg.h"
+#include "i2c_bus.h"
+#include "ee24m01r_emu.h"
+#include "logdecode.h"
+
+#define EEPROM_FILE       "loggerbench.eeprom"
+#define ENDURANCE_CYCLES  4000000U  /* 24M01R datasheet, at 25 C */
+#define LOG_PERIOD_MS     20U        /* SETTINGS_LOG_20MS, fast rate */
+#define LOG_FAST_SPEED    55U        /* setRecord starts each lap at 60 */
+#define USB_FRAME_US      1000U      /* full speed SOF interval */
+#define USB_PKG_US        60U        /* 64 byte bulk packet on the wire */
+#define PAUSE_MS          8000U      /* longer than systime_t wraps */
+#define PAUSE_MIN_RUN_S   20U        /* boots this long pause and dip */
+#define DIP_MS            30U        /* VDD below PVD threshold, comes back */
+#define HOLDUP_MS         40U       /* VDD below PVD threshold, then gone */
+#define CARRY_AFTER_PAGES 300U      /* page number carries into generation */
+
+// firmware globals logger.c reads, normally owned by other modules
+Settings_t settings;
+volatile const Inputs_t inputs = {0};
+volatile const Values_t values = {0};
+volatile const Accel_t accel = {0};
+const USBConfig usbcfg = {0};
+
+static Inputs_t *INPUTS = (Inputs_t*)&inputs;
+static Values_t *VALUES = (Values_t*)&values;
+static Accel_t *ACCEL = (Accel_t*)&accel;
+
+THD_FUNCTION(LoggerThd, arg);
+void Vector44(void);
+
+// data frames of a LogGetSince reply end up here
+static uint8_t rx[1 + EEPROM_LOG_SIZE];
+static uint32_t rxLen, rxUsbBytes;
+// when the two queued IN packets are off the wire
+static uint64_t wireOlderUs, wireNewerUs;
+
+msg_t usbQueueTransmit(usbpkg_t *pkg) {
+#if defined(USB_SOF_PACED)
+  // parked until next SOF, sender waits until it is sent
+  shimNowUs += USB_FRAME_US - shimNowUs % USB_FRAME_US + USB_PKG_US;
+  wireNewerUs = shimNowUs;
+#else
+  // wait for a free buffer, packet starts as soon as the one before ends
+  if (shimNowUs < wireOlderUs)
+    shimNowUs = wireOlderUs;
+  wireOlderUs = wireNewerUs;
+  wireNewerUs = (shimNowUs > wireOlderUs ? shimNowUs : wireOlderUs) +
+                USB_PKG_US;
+#endif
+
+  rxUsbBytes += pkg->onefrm.len;
+  const bool dataFrm = (pkg->datafrm.cmd & 0x80) &&
+                       (pkg->datafrm.pkgNr[0] | pkg->datafrm.pkgNr[1]);
+  if (dataFrm && pkg->datafrm.len > 5 &&
+      rxLen + pkg->datafrm.len - 5 <= sizeof(rx))
+  {
+    memcpy(&rx[rxLen], pkg->datafrm.data, pkg->datafrm.len - 5);
+    rxLen += pkg->datafrm.len - 5;
+  }
+  return MSG_OK;
+}
+
+msg_t usbWaitTransmit(usbpkg_t *pkg) {
+  const msg_t msg = usbQueueTransmit(pkg);
+  if (shimNowUs < wireNewerUs)
+    shimNowUs = wireNewerUs;
+  return msg;
+}
+
+// host never cancels a download here
+void commsJobProgress(uint32_t done, uint32_t total) {
+  (void)done;
+  (void)total;
+}
+
+bool commsJobCancelled(void) {
+  return false;
+}
+
+// ----------------------------------------------------------------
+// state shared between boots, lives in shared memory
+
+typedef struct {
+  uint32_t counter;   /* last record number handed to logger */
+  uint64_t nowUs;     /* virtual time */
+  EmuStats_t stats;   /* accumulated over all boots */
+  uint32_t hostSeq;   /* newest page host has, for LogGetSince */
+  uint32_t downloads, /* LogGetSince that went well */
+           failedDownloads,
+           wraps;     /* replies with LOG_SINCE_WRAPPED */
+  uint64_t usbBytes,  /* sent to host by LogGetSince */
+           usbUs;     /* time those replies took */
+  bool downloadOk;    /* last boots download went well */
+  bool cleared;       /* log was cleared this boot */
+  uint32_t clearCycles; /* write cycles and time the clear took */
+  uint64_t clearUs;
+  uint32_t pauseAfter; /* last record before pause this boot, 0 none */
+  uint32_t pauses;    /* pauses checked */
+  uint32_t dipAfter;  /* last record before dip this boot, 0 none */
+  uint32_t busNacks;  /* counted by i2c_bus.c, busy polls are not */
+} Shared_t;
+
+static Shared_t *sh;
+// host copy of log, page with seq n at n % EEPROM_LOG_PAGES
+static uint8_t *hostLog;
+
+// per boot, only used in the forked child
+static jmp_buf powerOff;
+static uint64_t bootEndUs, pauseStartUs, pauseEndUs, dipAtUs, pvdAtUs;
+static bool dipping;
+static bool graceful, pvdInWrite, clearLog;
+
+static void setRecord(uint32_t n) {
+  // record number goes in accel X and Y, the rest behaves somewhat
+  // like a landing, slow ramps and a bit of noise
+  const int32_t phase = n % 1000;
+  const uint8_t brake = phase < 500 ? 0 : (uint8_t)((phase - 500) / 5);
+  ACCEL->axis[0] = (int16_t)(n & 0xFFFF);
+  ACCEL->axis[1] = (int16_t)(n >> 16);
+  ACCEL->axis[2] = (int16_t)(512 + rand() % 5 - 2);
+  INPUTS->brakeForce = brake;
+  INPUTS->wheelRPS[0] = (uint8_t)(60 - phase / 20);
+  VALUES->brakeForce = brake;
+  VALUES->brakeForce_out[0] = brake;
+  VALUES->brakeForce_out[1] = brake;
+  VALUES->speedOnGround = (uint8_t)(60 - phase / 20);
+  VALUES->slip[0] = brake > 50 ? rand() % 20 : 0;
+  VALUES->acceleration = (int16_t)(rand() % 9 - 4);
+  VALUES->accelSteering = VALUES->acceleration / 2;
+}
+
+static void pvdWarning(void) {
+  pvdAtUs = shimNowUs;
+  shimPWR.CSR |= PWR_CSR_PVDO;
+  Vector44();
+}
+
+// logger is about to wake up, act as the rest of the firmware
+static void wakeHook(void) {
+  if (shimPWR.CSR & PWR_CSR_PVDO)
+    return; // nothing new while VDD is low
+  if (shimNowUs >= bootEndUs && !pvdInWrite) {
+    if (graceful) {
+      pvdWarning(); // logger flushes, power goes while it polls PVDO
+      return;
+    }
+    // power dies in the next write cycle, whatever is in RAM is lost
+    if (emuFaults.powerLossAtCycle == 0) {
+      emuFaults.powerLossAtCycle = emuStats.writeCycles + 1;
+      emuFaults.tornBytes = rand() % (EMU_PAGE_SIZE + 1);
+    }
+  }
+  if (dipAtUs != 0 && shimNowUs >= dipAtUs) {
+    dipAtUs = 0;
+    dipping = true;
+    sh->dipAfter = sh->counter;
+    pvdWarning();
+    return;
+  }
+  // as if USB was plugged in, logger skips and makes no records
+  blockLog = shimNowUs >= pauseStartUs && shimNowUs < pauseEndUs;
+  if (blockLog) {
+    if (sh->pauseAfter == 0)
+      sh->pauseAfter = sh->counter;
+    return;
+  }
+  setRecord(++sh->counter);
+  // stands in for the brake loop, touchdown triggers a capture each boot
+  captureSample();
+  sessionSample();
+}
+
+static void powerGone(void) {
+  longjmp(powerOff, 1);
+}
+
+// logger has slept, VDD comes back after a dip, else power is gone
+static void sleepHook(void) {
+  uint32_t page;
+  if (!(shimPWR.CSR & PWR_CSR_PVDO)) {
+    // logger is busy writing a log page, not waiting for a wakeup
+    if (pvdInWrite && shimNowUs >= bootEndUs && emuWriteCycleBusy(&page) &&
+        page * EMU_PAGE_SIZE >= log_ee.startAddr &&
+        page * EMU_PAGE_SIZE < log_ee.startAddr + log_ee.size)
+    {
+      pvdWarning();
+    }
+    return;
+  }
+  if (dipping && shimNowUs >= pvdAtUs + DIP_MS * 1000ULL) {
+    shimPWR.CSR &= ~PWR_CSR_PVDO;
+    dipping = false;
+  } else if (!dipping && shimNowUs >= pvdAtUs + HOLDUP_MS * 1000ULL) {
+    powerGone();
+  }
+}
+
+static uint32_t pageSeqOf(const uint8_t *page, bool *valid) {
+  const LogPageTrailer_t *tr = (const LogPageTrailer_t*)&page[LOG_PAGE_PAYLOAD];
+  *valid = tr->used > 0 && tr->used <= LOG_PAGE_PAYLOAD &&
+           tr->crc == crc8(page, EEPROM_PAGE_SIZE - 1);
+  return (uint32_t)tr->seq[0] << 24 | (uint32_t)tr->seq[1] << 16 |
+         (uint32_t)tr->seq[2] << 8 | tr->seq[3];
+}
+
+// host plugs in after landing, fetches new pages and merges them
+static void hostDownload(void) {
+  static usbpkg_t snd, rcv;
+  INIT_PKG(rcv, commsCmd_LogGetSince, 1);
+  PKG_PUSH_32(rcv, sh->hostSeq);
+  INIT_PKG(snd, commsCmd_LogGetSince, 1);
+  rxLen = rxUsbBytes = 0;
+  const uint64_t startUs = shimNowUs;
+  loggerReadSince(&snd, &rcv);
+  sh->usbBytes += rxUsbBytes;
+  sh->usbUs += shimNowUs - startUs;
+
+  sh->downloadOk = snd.onefrm.cmd == commsCmd_OK && rxLen >= 1 &&
+                   (rxLen - 1) % EEPROM_PAGE_SIZE == 0;
+  if (!sh->downloadOk) {
+    ++sh->failedDownloads;
+    return;
+  }
+  ++sh->downloads;
+  if (rx[0] & LOG_SINCE_WRAPPED)
+    ++sh->wraps;
+  if (rx[0] & LOG_SINCE_NEW_GEN)
+    memset(hostLog, 0, EEPROM_LOG_SIZE);
+
+  // pages are in seq order, broken pages get their seq from a valid one
+  const uint32_t cnt = (rxLen - 1) / EEPROM_PAGE_SIZE;
+  uint32_t firstSeq = 0;
+  bool valid = false;
+  for (uint32_t i = 0; i < cnt && !valid; ++i)
+    firstSeq = pageSeqOf(&rx[1 + i * EEPROM_PAGE_SIZE], &valid) - i;
+  for (uint32_t i = 0; i < cnt && valid; ++i) {
+    const uint32_t seq = firstSeq + i;
+    memcpy(&hostLog[(seq % EEPROM_LOG_PAGES) * EEPROM_PAGE_SIZE],
+           &rx[1 + i * EEPROM_PAGE_SIZE], EEPROM_PAGE_SIZE);
+    bool ok;
+    pageSeqOf(&rx[1 + i * EEPROM_PAGE_SIZE], &ok);
+    if (ok)
+      sh->hostSeq = seq;
+  }
+}
+
+// host clears the log after it has downloaded it
+static void hostClear(void) {
+  static usbpkg_t snd;
+  const uint32_t cycles = emuStats.writeCycles;
+  const uint64_t startUs = shimNowUs;
+  INIT_PKG(snd, commsCmd_LogClearAll, 1);
+  loggerClearAll(&snd);
+  sh->cleared = snd.onefrm.cmd == commsCmd_OK;
+  sh->clearCycles = emuStats.writeCycles - cycles;
+  sh->clearUs = shimNowUs - startUs;
+}
+
+static void runBoot(void) {
+  emuStats = sh->stats;
+  shimNowUs = sh->nowUs;
+  shimWakeHook = wakeHook;
+  shimParkHook = powerGone;
+  shimSleepHook = sleepHook;
+  shimPWR.CSR = 0;
+  emuFaults.onPowerLoss = powerGone;
+  emuFaults.powerLossAtCycle = 0;
+  pauseStartUs = pauseEndUs = dipAtUs = 0;
+  if (bootEndUs - shimNowUs >= PAUSE_MIN_RUN_S * 1000000ULL) {
+    pauseStartUs = shimNowUs + 5000000ULL;
+    pauseEndUs = pauseStartUs + PAUSE_MS * 1000ULL;
+    dipAtUs = pauseEndUs + 2000000ULL;
+  }
+
+  if (setjmp(powerOff) == 0) {
+    loggerInit();
+    captureInit();
+    sessionInit();
+    LoggerThd(NULL);
+  }
+  // power is back for the host
+  shimSleepHook = NULL;
+
+  sh->stats = emuStats;
+  sh->nowUs = shimNowUs;
+  if (graceful)
+    hostDownload();
+  if (graceful && clearLog) {
+    hostClear();
+    hostDownload();
+    sh->stats = emuStats;
+    sh->nowUs = shimNowUs;
+  }
+  sh->busNacks += i2cBusErrors.nacks;
+  _exit(0);
+}
+
+// ----------------------------------------------------------------
+// read back and check
+
+// what the log in EEPROM holds, from last verify
+static uint32_t logBytes, logRecords, logUncompressed, logRateChanges,
+                logSkipped;
+
+/**
+ * @brief schema must name all items with their width in firmware
+ */
+static int checkSchema(const LogDecoder_t *dec) {
+  if (dec->schemaCnt != LOGITEMS_CNT)
+    return -1;
+  for (uint8_t i = 0; i < dec->schemaCnt; ++i) {
+    const LogSchemaItem_t *it = &dec->schema[i];
+    const uint16_t hash = (uint16_t)(it->nameHash[0] << 8 | it->nameHash[1]);
+    if (it->type != i || hash != logNameHash(logItemName(i)) ||
+        (it->format & 0x03) + 1 != logItemBytes(i))
+    {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief walk all records, counters must increase and this boots
+ *        records, after first, must be there without gaps
+ * @returns number of records from this boot, -1 on error
+ */
+static int32_t verify(uint32_t first, uint32_t *coldStarts) {
+  static uint8_t log[EEPROM_LOG_SIZE];
+  const uint32_t len = logLinearize(&emuMem[log_ee.startAddr], log);
+  uint32_t prev = 0, found = 0, prevMs = 0,
+           periodMs = LOG_PERIOD_MS, newPeriodMs = LOG_PERIOD_MS;
+  bool havePrev = false, haveMs = false;
+  LogDecoder_t dec = {0};
+  LogRecord_t rec;
+  int32_t used;
+
+  *coldStarts = 0;
+  logBytes = len;
+  logRecords = logUncompressed = logRateChanges = logSkipped = 0;
+
+  for (uint32_t pos = 0; pos < len; pos += used) {
+    used = logDecode(&dec, &log[pos], len - pos, &rec);
+    if (used < 0) {
+      // as the host does, records lost here must show up as missing
+      used = (int32_t)logResync(&log[pos], len - pos);
+      logSkipped += (uint32_t)used;
+      continue;
+    }
+    if (used == 0 || !rec.valid) {
+      printf("broken record at %u\n", pos);
+      return -1;
+    }
+    if (rec.sync)
+      continue;
+    if (rec.coldStart) {
+      ++*coldStarts;
+      haveMs = false;
+      continue;
+    }
+    if (rec.rate) {
+      if (rec.periodicity > SETTINGS_LOG_2560MS) {
+        printf("bad rate at %u\n", pos);
+        return -1;
+      }
+      newPeriodMs = LOG_PERIOD_MS << rec.periodicity;
+      if (newPeriodMs != periodMs)
+        ++logRateChanges;
+      continue;
+    }
+    if (rec.schema) {
+      if (checkSchema(&dec) != 0) {
+        printf("bad schema at %u\n", pos);
+        return -1;
+      }
+      continue;
+    }
+    // every session must describe its items before the first record,
+    // oldest session might have lost its start when log wrapped
+    if (*coldStarts > 0 && dec.schemaCnt == 0) {
+      printf("record at %u without schema\n", pos);
+      return -1;
+    }
+    // records are at least a log period apart in time, the record
+    // right after a rate change may be at either rate
+    const uint32_t minMs = newPeriodMs < periodMs ? newPeriodMs : periodMs;
+    if (!rec.hasTime || (haveMs && rec.timeMs < prevMs + minMs)) {
+      printf("record at %u has bad time %u ms\n", pos, rec.timeMs);
+      return -1;
+    }
+    const uint32_t gapMs = haveMs ? rec.timeMs - prevMs : 0;
+    periodMs = newPeriodMs;
+    prevMs = rec.timeMs;
+    haveMs = true;
+
+    ++logRecords;
+    logUncompressed += 2;
+    for (uint8_t i = 0; i < LOGITEMS_CNT; ++i)
+      if (rec.mask & (1UL << i))
+        logUncompressed += 1 + logItemBytes(i);
+
+    const uint32_t n = (uint32_t)(uint16_t)rec.vlu[log_accelY] << 16 |
+                       (uint16_t)rec.vlu[log_accelX];
+    if (havePrev && n <= prev) {
+      printf("record %u after %u, out of order\n", n, prev);
+      return -1;
+    }
+    // time must count on while logging is paused
+    if (sh->pauseAfter > first && n == sh->pauseAfter + 1 &&
+        prev == sh->pauseAfter)
+    {
+      if (gapMs < PAUSE_MS) {
+        printf("record %u only %u ms after pause\n", n, gapMs);
+        return -1;
+      }
+      ++sh->pauses;
+    }
+    if (n > first) {
+      if (n != first + found + 1) {
+        printf("record %u missing\n", first + found + 1);
+        return -1;
+      }
+      ++found;
+    }
+    prev = n;
+    havePrev = true;
+  }
+  return (int32_t)found;
+}
+
+/**
+ * @brief records with values in log, broken records skipped as in verify
+ */
+static uint32_t countRecords(const uint8_t *log, uint32_t len) {
+  LogDecoder_t dec = {0};
+  LogRecord_t rec;
+  uint32_t cnt = 0;
+  for (uint32_t pos = 0; pos < len;) {
+    const int32_t used = logDecode(&dec, &log[pos], len - pos, &rec);
+    if (used == 0)
+      break;
+    if (used < 0) {
+      pos += logResync(&log[pos], len - pos);
+      continue;
+    }
+    if (rec.valid && rec.mask != 0)
+      ++cnt;
+    pos += (uint32_t)used;
+  }
+  return cnt;
+}
+
+/**
+ * @brief a flipped byte must cost some records, at most one page of them
+ */
+static int verifyResync(void) {
+  static uint8_t log[EEPROM_LOG_SIZE];
+  const uint32_t len = logLinearize(&emuMem[log_ee.startAddr], log),
+                 before = countRecords(log, len);
+  log[len / 2] ^= 0x5A;
+  const uint32_t after = countRecords(log, len);
+  // smallest record is kind, time, mask and crc
+  return after < before && before - after <= LOG_PAGE_PAYLOAD / 4 ? 0 : -1;
+}
+
+/**
+ * @brief host copy of log must hold the same records as EEPROM
+ */
+static int verifyDownload(void) {
+  static uint8_t dev[EEPROM_LOG_SIZE], host[EEPROM_LOG_SIZE];
+  const uint32_t devLen = logLinearize(&emuMem[log_ee.startAddr], dev),
+                 hostLen = logLinearize(hostLog, host);
+  return devLen == hostLen && memcmp(dev, host, devLen) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief newest session must be number, start at a coldstart and,
+ *        when closed at power fail, hold all records from this boot
+ *        and statistics of the values setRecord gave them
+ */
+static int verifySession(uint32_t number, uint32_t first, int32_t found) {
+  const SessionEntry_t *newest = NULL;
+  uint32_t newestNr = 0;
+  for (uint32_t pos = 0; pos + sizeof(SessionEntry_t) <= session_ee.size;
+       pos += sizeof(SessionEntry_t))
+  {
+    // entries never span a page
+    if (pos % EEPROM_PAGE_SIZE + sizeof(SessionEntry_t) > EEPROM_PAGE_SIZE)
+      pos += EEPROM_PAGE_SIZE - pos % EEPROM_PAGE_SIZE;
+    const SessionEntry_t *e =
+        (const SessionEntry_t*)&emuMem[session_ee.startAddr + pos];
+    const uint32_t nr = (uint32_t)e->number[0] << 24 | e->number[1] << 16 |
+                        e->number[2] << 8 | e->number[3];
+    if (nr > newestNr && e->crc == crc8((const uint8_t*)e, sizeof(*e) - 1)) {
+      newestNr = nr;
+      newest = e;
+    }
+  }
+  if (newest == NULL || newestNr != number) {
+    printf("session %u is newest\n", newestNr);
+    return -1;
+  }
+
+  const uint32_t startSeq = (uint32_t)newest->startSeq[0] << 24 |
+                            newest->startSeq[1] << 16 |
+                            newest->startSeq[2] << 8 | newest->startSeq[3];
+  bool atColdStart = false;
+  for (uint32_t i = 0; i < EEPROM_LOG_PAGES; ++i) {
+    const uint8_t *page = &emuMem[log_ee.startAddr + i * EEPROM_PAGE_SIZE];
+    bool valid;
+    if (pageSeqOf(page, &valid) == startSeq && valid) {
+      // coldstart is first after the sync record
+      const uint8_t *cs = &page[LOG_SYNC_SIZE + LOG_CRC_SIZE];
+      atColdStart = page[0] == LOG_KIND_SYNC && cs[0] == 4 &&
+                    cs[2] >> 2 == log_coldStart;
+    }
+  }
+  if (!atColdStart) {
+    printf("session %u doesn't start at a coldstart\n", newestNr);
+    return -1;
+  }
+
+  const uint32_t records = (uint32_t)newest->records[0] << 24 |
+                           newest->records[1] << 16 |
+                           newest->records[2] << 8 | newest->records[3];
+  if (graceful && (!(newest->flags & SESSION_CLOSED) ||
+                   records != (uint32_t)found))
+  {
+    printf("session %u has %u records, %d in log\n",
+           newestNr, records, found);
+    return -1;
+  }
+  if (!graceful)
+    return 0;
+
+  uint8_t maxSpeed = 0, peakBrake = 0;
+  for (uint32_t n = first + 1; n <= sh->counter; ++n) {
+    const uint32_t phase = n % 1000;
+    const uint8_t brake = phase < 500 ? 0 : (uint8_t)((phase - 500) / 5),
+                  speed = (uint8_t)(60 - phase / 20);
+    if (brake > peakBrake)
+      peakBrake = brake;
+    if (speed > maxSpeed)
+      maxSpeed = speed;
+  }
+  const SessionStats_t *st = &newest->stats;
+  const uint32_t brakeMs = (uint32_t)st->brakeMs[0] << 24 |
+                           st->brakeMs[1] << 16 | st->brakeMs[2] << 8 |
+                           st->brakeMs[3],
+                 duration = (uint32_t)newest->duration[0] << 24 |
+                            newest->duration[1] << 16 |
+                            newest->duration[2] << 8 | newest->duration[3];
+  if (st->maxSpeed != maxSpeed || st->peakBrake != peakBrake ||
+      brakeMs > duration || (peakBrake > 0) != (brakeMs > 0))
+  {
+    printf("session %u stats speed %u brake %u %u ms, want %u %u\n",
+           newestNr, st->maxSpeed, st->peakBrake, brakeMs,
+           maxSpeed, peakBrake);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief check capture slots, all must have a valid crc except one
+ *        torn by a hard power loss
+ * @returns seq of newest valid capture, -1 on error
+ */
+static int64_t verifyCaptures(uint32_t *valid) {
+  const uint32_t slotSize = (CAPTURE_SLOT_SIZE + EEPROM_PAGE_SIZE - 1) /
+                              EEPROM_PAGE_SIZE * EEPROM_PAGE_SIZE;
+  uint32_t torn = 0, newest = 0;
+  *valid = 0;
+
+  for (uint32_t pos = 0; pos + slotSize <= capture_ee.size; pos += slotSize) {
+    const uint8_t *slot = &emuMem[capture_ee.startAddr + pos];
+    const CaptureHeader_t *h = (const CaptureHeader_t*)slot;
+    if (h->sampleSize != sizeof(CaptureSample_t) || h->samples == 0 ||
+        h->samples > CAPTURE_SAMPLES)
+    {
+      continue;
+    }
+    uint8_t crc = crc8(slot, sizeof(*h) - 1);
+    crc = crc8Update(crc, slot + sizeof(*h), h->samples * sizeof(CaptureSample_t));
+    if (crc != h->crc) {
+      ++torn;
+      continue;
+    }
+    const uint32_t seq = (uint32_t)h->seq[0] << 24 | h->seq[1] << 16 |
+                         h->seq[2] << 8 | h->seq[3];
+    if (seq > newest)
+      newest = seq;
+    ++*valid;
+  }
+  if (torn > 1) {
+    printf("%u torn captures\n", torn);
+    return -1;
+  }
+  return newest;
+}
+
+// ----------------------------------------------------------------
+
+/**
+ * @brief log as after a clear, full up to just before page number carries
+ * Header and one page with a sync record only, as logger.c writes them.
+ */
+static void logNearCarry(void) {
+  const uint32_t gen = 1UL << LOG_GEN_SHIFT,
+                 seq = 2 * gen - CARRY_AFTER_PAGES;
+  LogHeader_t *hdr = (LogHeader_t*)&emuMem[loghdr_ee.startAddr];
+  hdr->magic = LOG_HEADER_MAGIC;
+  TO_BIG_ENDIAN_32(hdr->genStart, gen);
+  hdr->crc = crc8((uint8_t*)hdr, sizeof(*hdr) - 1);
+
+  uint8_t *page = &emuMem[log_ee.startAddr +
+                          (EEPROM_LOG_PAGES - 1) * EEPROM_PAGE_SIZE];
+  LogPageTrailer_t *tr = (LogPageTrailer_t*)&page[LOG_PAGE_PAYLOAD];
+  memset(page, 0, EEPROM_PAGE_SIZE);
+  page[0] = LOG_KIND_SYNC;
+  TO_BIG_ENDIAN_32(&page[1], seq);
+  page[LOG_SYNC_SIZE] = crc8(page, LOG_SYNC_SIZE);
+  TO_BIG_ENDIAN_32(tr->seq, seq);
+  tr->used = LOG_SYNC_SIZE + 1;
+  tr->crc = crc8(page, EEPROM_PAGE_SIZE - 1);
+}
+
+int main(int argc, char *argv[]) {
+  const uint32_t boots = argc > 1 ? (uint32_t)atoi(argv[1]) : 40;
+  srand(argc > 2 ? (unsigned)atoi(argv[2]) : 1);
+  emuFaults.nackPermille = argc > 3 ? (uint32_t)atoi(argv[3]) : 0;
+
+  sh = mmap(NULL, sizeof(*sh), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  hostLog = mmap(NULL, EEPROM_LOG_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (sh == MAP_FAILED || hostLog == MAP_FAILED || emuOpen(EEPROM_FILE) != 0)
+    return 1;
+  emuReset();
+  logNearCarry();
+  memset(sh, 0, sizeof(*sh));
+  sh->hostSeq = 0xFFFFFFFFu;
+  i2cStart(&I2CD1, NULL);
+
+  // everything that can be logged is logged, fastest rate when busy
+  settings.Brake0_active = 1;
+  settings.Brake1_active = 1;
+  settings.acc_steering_brake_authority = 20;
+  settings.logPeriodicity = SETTINGS_LOG_80MS;
+  settings.logFastPeriodicity = SETTINGS_LOG_20MS;
+  settings.logAdaptive = 1;
+  settings.logFastSpeed = LOG_FAST_SPEED;
+  settings.accelerometer_active = 1;
+  settings.ABS_active = 1;
+  settings.WheelSensor0_pulses_per_rev = 8;
+
+  uint32_t generated = 0, lostMax = 0, lostTot = 0, hardBoots = 0,
+           captures = 0, clearedBoot = 0, dips = 0, session = 1;
+  bool cleared = false;
+  int64_t newestCapture = 0;
+
+  for (uint32_t boot = 0; boot < boots; ++boot) {
+    graceful = rand() % 4 != 0;
+    pvdInWrite = graceful && boot % 2 != 0;
+    const uint64_t runUs = (5 + rand() % 56) * 1000000ULL;
+    const uint32_t first = sh->counter;
+    clearLog = !cleared && boot >= boots / 2;
+    sh->cleared = false;
+    sh->pauseAfter = sh->dipAfter = 0;
+
+    emuPowerCycle();
+    bootEndUs = sh->nowUs + runUs;
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0)
+      runBoot();
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      printf("boot %u crashed\n", boot);
+      return 1;
+    }
+
+    uint32_t coldStarts;
+    const int32_t found = verify(first, &coldStarts);
+    if (found < 0 || coldStarts == 0) {
+      printf("boot %u failed verify\n", boot);
+      return 1;
+    }
+    // touchdown at boot gives one capture, a hard loss may tear it
+    const int64_t newest = verifyCaptures(&captures);
+    if (newest < 0 || newest > newestCapture + 1 ||
+        (graceful && newest != newestCapture + 1))
+    {
+      printf("boot %u capture %" PRId64 " after %" PRId64 "\n",
+             boot, newest, newestCapture);
+      return 1;
+    }
+    newestCapture = newest;
+
+    if (sh->cleared) {
+      // only the coldstart written by the clear is left
+      if (found != 0 || logRecords != 0 || coldStarts != 1 ||
+          verifyDownload() != 0)
+      {
+        printf("boot %u log not empty after clear\n", boot);
+        return 1;
+      }
+      cleared = true;
+      clearedBoot = boot;
+      session = 2;
+      generated += sh->counter - first;
+      continue;
+    }
+    // sessions are numbered from 1 again, the clear opened the first
+    if (cleared && boot == clearedBoot + 1 && logRecords != (uint32_t)found) {
+      printf("boot %u records from before clear in log\n", boot);
+      return 1;
+    }
+    // a dip closes the session of this boot and opens the next
+    const uint32_t from = sh->dipAfter != 0 ? sh->dipAfter : first;
+    if (sh->dipAfter != 0) {
+      if (graceful && sh->counter == sh->dipAfter) {
+        printf("boot %u logging did not go on after dip\n", boot);
+        return 1;
+      }
+      ++session;
+      ++dips;
+    }
+    if (verifySession(session, from, found - (int32_t)(from - first)) != 0) {
+      printf("boot %u failed session check\n", boot);
+      return 1;
+    }
+    ++session;
+    if (graceful && sh->downloadOk && verifyDownload() != 0) {
+      printf("boot %u host copy of log differs\n", boot);
+      return 1;
+    }
+
+    const uint32_t made = sh->counter - first,
+                   lost = made - (uint32_t)found;
+    if (graceful && lost > 0) {
+      printf("boot %u lost %u records despite PVD warning\n", boot, lost);
+      return 1;
+    }
+    if (!graceful) {
+      ++hardBoots;
+      lostTot += lost;
+      if (lost > lostMax)
+        lostMax = lost;
+    }
+    generated += made;
+  }
+
+  if (verifyResync() != 0) {
+    printf("broken record cost more than its page\n");
+    return 1;
+  }
+  // only a NACK that outlasts the write time is an error
+  if (sh->stats.injectedNacks == 0 && sh->busNacks != 0) {
+    printf("%u busy polls counted as bus errors\n", sh->busNacks);
+    return 1;
+  }
+
+  const EmuStats_t *st = &sh->stats;
+  const double secs = sh->nowUs / 1e6,
+               hours = secs / 3600.0;
+  uint32_t maxWear = 0;
+  for (uint32_t i = 0; i < EMU_PAGES; ++i)
+    if (st->pageWrites[i] > maxWear)
+      maxWear = st->pageWrites[i];
+
+  printf("logger, %u boots (%u hard power loss), %.0f s logging\n",
+         boots, hardBoots, secs);
+  printf("  records      %8u  %6.1f /s\n", generated, generated / secs);
+  printf("  log size     %8.1f  bytes per record, %.1f uncompressed\n",
+         (double)logBytes / logRecords, (double)logUncompressed / logRecords);
+  printf("  resync       %8u  bytes of broken records skipped\n",
+         logSkipped);
+  printf("  rate changes %8u  in log, fast %u ms, slow %u ms\n",
+         logRateChanges, LOG_PERIOD_MS << settings.logFastPeriodicity,
+         LOG_PERIOD_MS << settings.logPeriodicity);
+  printf("  pauses       %8u  of %u ms, time in log counted on\n",
+         sh->pauses, PAUSE_MS);
+  printf("  dips         %8u  PVD warnings VDD came back from, logged on\n",
+         dips);
+  printf("  clear        %8u  write cycles, %.1f ms\n",
+         sh->clearCycles, sh->clearUs / 1000.0);
+  printf("  write cycles %8u  %6.3f per record, %u bytes written\n",
+         st->writeCycles, (double)st->writeCycles / generated,
+         st->bytesWritten);
+  printf("  EEPROM busy  %7.1f %%  of the time in write cycles\n",
+         100.0 * st->writeCycles * emuCfg.writeCycleUs / sh->nowUs);
+  printf("  wear         %8u  max cycles on one page, %.0f h to %u\n",
+         maxWear, maxWear ? ENDURANCE_CYCLES / (maxWear / hours) : 0.0,
+         ENDURANCE_CYCLES);
+  printf("  nacks        %8u  injected, %u counted as bus errors\n",
+         st->injectedNacks, sh->busNacks);
+  printf("  captures     %8" PRId64 "  written, %u valid in EEPROM\n",
+         newestCapture, captures);
+  printf("  hard loss    %8u  records max lost, %.1f in average\n",
+         lostMax, hardBoots ? (double)lostTot / hardBoots : 0.0);
+  printf("  download     %8.1f  kB per download since last, %u kB full log\n",
+         sh->downloads ? sh->usbBytes / 1024.0 / sh->downloads : 0.0,
+         EEPROM_LOG_SIZE / 1024);
+  printf("               %8u  downloads, %u failed, %u wrapped\n",
+         sh->downloads, sh->failedDownloads, sh->wraps);
+  printf("               %8.1f  kB/s over USB, EEPROM reads included\n",
+         sh->usbUs ? sh->usbBytes / 1.024 / sh->usbUs * 1000.0 : 0.0);
+  return 0;
+}
@@ -0,0 +1,12 @@
+/*
+ * board.h
+ *
+ * The parts of board/board.h the host build needs
+ */
+
+#ifndef HOST_SHIM_BOARD_H_
+#define HOST_SHIM_BOARD_H_
+
+#define LINE_I2C_WC        1U
+
+#endif /* HOST_SHIM_BOARD_H_ */
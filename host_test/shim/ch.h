@@ -0,0 +1,103 @@
+/*
+ * ch.h
+ *
+ * Minimal stand in for the ChibiOS/NIL kernel API, used to build firmware
+ * modules on a host. There is only one thread, time is virtual and only
+ * moves when the code sleeps or the emulated I2C bus transfers data.
+ */
+
+#ifndef HOST_SHIM_CH_H_
+#define HOST_SHIM_CH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef TRUE
+#define TRUE  1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+typedef int32_t  msg_t;
+typedef uint16_t systime_t;     /* 16bit as CH_CFG_ST_RESOLUTION */
+typedef uint16_t sysinterval_t;
+typedef uint32_t stkalign_t;
+typedef struct thread thread_t;
+typedef thread_t *thread_reference_t;
+typedef void (*tfunc_t)(void *p);
+
+typedef struct {
+  int32_t cnt;
+} semaphore_t;
+
+typedef struct {
+  const char *name;
+  stkalign_t *wbase, *wend;
+  uint32_t prio;
+  tfunc_t funcp;
+  void *arg;
+} thread_descriptor_t;
+
+#define MSG_OK        (msg_t)0
+#define MSG_TIMEOUT   (msg_t)-1
+#define MSG_RESET     (msg_t)-2
+
+#define CH_CFG_ST_FREQUENCY  10000
+#define TIME_INFINITE        ((sysinterval_t)-1)
+#define TIME_IMMEDIATE       ((sysinterval_t)0)
+
+#define TIME_S2I(s)   ((sysinterval_t)((uint32_t)(s) * CH_CFG_ST_FREQUENCY))
+#define TIME_MS2I(ms) ((sysinterval_t)(((uint32_t)(ms) * CH_CFG_ST_FREQUENCY + 999) / 1000))
+#define TIME_US2I(us) ((sysinterval_t)(((uint32_t)(us) * CH_CFG_ST_FREQUENCY + 999999) / 1000000))
+#define TIME_I2MS(i)  ((uint32_t)(i) * 1000 / CH_CFG_ST_FREQUENCY)
+#define TIME_I2US(i)  ((uint32_t)(i) * 1000000 / CH_CFG_ST_FREQUENCY)
+
+#define THD_WORKING_AREA(s, n)    stkalign_t s[((n) + 3) / 4]
+#define THD_WORKING_AREA_BASE(s)  ((stkalign_t *)(s))
+#define THD_WORKING_AREA_END(s)   (THD_WORKING_AREA_BASE(s) + \
+                                   sizeof(s) / sizeof(stkalign_t))
+#define THD_FUNCTION(tname, arg)  void tname(void *arg)
+
+#define chSysLock()
+#define chSysUnlock()
+#define chSysLockFromISR()
+#define chSysUnlockFromISR()
+#define chSchRescheduleS()
+
+#define chTimeDiffX(start, end)  ((sysinterval_t)((systime_t)((end) - (start))))
+#define chTimeAddX(t, i)         ((systime_t)((t) + (i)))
+
+/* virtual time in microseconds, see shim.c */
+extern uint64_t shimNowUs;
+
+systime_t chVTGetSystemTimeX(void);
+#define chVTGetSystemTime() chVTGetSystemTimeX()
+
+void chThdSleep(sysinterval_t time);
+void chThdSleepUntil(systime_t time);
+msg_t chThdSuspendS(thread_reference_t *trp);
+msg_t chThdSuspendTimeoutS(thread_reference_t *trp, sysinterval_t timeout);
+void chThdResumeI(thread_reference_t *trp, msg_t msg);
+void chThdResume(thread_reference_t *trp, msg_t msg);
+thread_t *chThdCreate(const thread_descriptor_t *tdp);
+
+void chSemObjectInit(semaphore_t *sp, int32_t n);
+msg_t chSemWait(semaphore_t *sp);
+msg_t chSemWaitTimeout(semaphore_t *sp, sysinterval_t timeout);
+void chSemSignal(semaphore_t *sp);
+
+/* called when a thread wakes up from chThdSuspendTimeoutS,
+ * lets a test act as the other threads and interrupts */
+extern void (*shimWakeHook)(void);
+/* called when a thread suspends until resumed, acts as the other
+ * threads, the thread must have been resumed when it returns */
+extern void (*shimSuspendHook)(void);
+/* called when a thread has slept, lets a test change what it polls */
+extern void (*shimSleepHook)(void);
+/* called when a thread parks forever, must not return,
+ * exits the process if not set */
+extern void (*shimParkHook)(void);
+
+#endif /* HOST_SHIM_CH_H_ */
@@ -0,0 +1,12 @@
+/*
+ * chtypes.h
+ *
+ * Kernel types are all in the ch.h stand in
+ */
+
+#ifndef HOST_SHIM_CHTYPES_H_
+#define HOST_SHIM_CHTYPES_H_
+
+#include "ch.h"
+
+#endif /* HOST_SHIM_CHTYPES_H_ */
@@ -0,0 +1,102 @@
+/*
+ * hal.h
+ *
+ * Minimal stand in for the ChibiOS HAL, I2C transfers are routed to
+ * the EEPROM emulator in ee24m01r_emu.c
+ */
+
+#ifndef HOST_SHIM_HAL_H_
+#define HOST_SHIM_HAL_H_
+
+#include "ch.h"
+
+#define I2C_USE_MUTUAL_EXCLUSION  TRUE
+
+typedef uint16_t i2caddr_t;
+typedef uint32_t ioline_t;
+
+typedef struct {
+  uint32_t timingr, cr1, cr2;
+} I2CConfig;
+
+typedef struct {
+  const I2CConfig *config;
+} I2CDriver;
+
+extern I2CDriver I2CD1;
+
+typedef uint8_t i2cflags_t;
+#define I2C_NO_ERROR           0x00
+#define I2C_BUS_ERROR          0x01
+#define I2C_ARBITRATION_LOST   0x02
+#define I2C_ACK_FAILURE        0x04
+#define I2C_OVERRUN            0x08
+
+#define STM32_TIMINGR_PRESC(n)   ((uint32_t)(n) << 28)
+#define STM32_TIMINGR_SCLDEL(n)  ((uint32_t)(n) << 20)
+#define STM32_TIMINGR_SDADEL(n)  ((uint32_t)(n) << 16)
+#define STM32_TIMINGR_SCLH(n)    ((uint32_t)(n) << 8)
+#define STM32_TIMINGR_SCLL(n)    ((uint32_t)(n) << 0)
+
+void i2cStart(I2CDriver *i2cp, const I2CConfig *config);
+void i2cStop(I2CDriver *i2cp);
+msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp, i2caddr_t addr,
+                               const uint8_t *txbuf, size_t txbytes,
+                               uint8_t *rxbuf, size_t rxbytes,
+                               sysinterval_t timeout);
+i2cflags_t i2cGetErrors(I2CDriver *i2cp);
+
+void palSetLine(ioline_t line);
+void palClearLine(ioline_t line);
+
+// power voltage detector and EXTI, only the bits logger.c touches
+typedef struct {
+  uint32_t CR, CSR;
+} PWR_TypeDef;
+
+typedef struct {
+  uint32_t IMR, EMR, RTSR, FTSR, SWIER, PR;
+} EXTI_TypeDef;
+
+extern PWR_TypeDef shimPWR;
+extern EXTI_TypeDef shimEXTI;
+#define PWR                 (&shimPWR)
+#define EXTI                (&shimEXTI)
+#define PWR_CR_PVDE         (1U << 4)
+#define PWR_CR_PLS_LEV7     (7U << 5)
+#define PWR_CSR_PVDO        (1U << 2)
+#define EXTI_IMR_MR16       (1U << 16)
+#define EXTI_RTSR_TR16      (1U << 16)
+#define EXTI_PR_PR16        (1U << 16)
+
+#define PVD_VDDIO2_IRQn                 1
+#define STM32_IRQ_EXTI16_IRQ_PRIORITY   3
+#define nvicEnableVector(n, prio)       ((void)(n), (void)(prio))
+
+#define OSAL_IRQ_HANDLER(id)  void id(void)
+#define OSAL_IRQ_PROLOGUE()
+#define OSAL_IRQ_EPILOGUE()
+#define osalSysLockFromISR()
+#define osalSysUnlockFromISR()
+
+// USB is never connected in host builds
+typedef enum {
+  USB_UNINIT = 0, USB_STOP = 1, USB_READY = 2, USB_SELECTED = 3,
+  USB_ACTIVE = 4, USB_SUSPENDED = 5
+} usbstate_t;
+
+typedef struct {
+  usbstate_t state;
+} USBDriver;
+
+typedef struct {
+  uint32_t dummy;
+} USBConfig;
+
+extern USBDriver USBD1;
+#define usbGetDriverStateI(usbp)  ((usbp)->state)
+
+#define osalDbgAssert(c, remark) shimAssert((c), (remark))
+void shimAssert(bool cond, const char *remark);
+
+#endif /* HOST_SHIM_HAL_H_ */
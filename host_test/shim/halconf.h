@@ -0,0 +1,12 @@
+/*
+ * halconf.h
+ *
+ * The parts of cfg/halconf.h the host build needs
+ */
+
+#ifndef HOST_SHIM_HALCONF_H_
+#define HOST_SHIM_HALCONF_H_
+
+#define MIN_I2C_FREQUENCY 200000 // Frequency of I2C bus
+
+#endif /* HOST_SHIM_HALCONF_H_ */
@@ -0,0 +1,109 @@
+/*
+ * shim.c
+ *
+ * Host implementation of the kernel calls in ch.h.
+ * Sleeping just moves the virtual clock forward.
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+uint64_t shimNowUs = 0;
+PWR_TypeDef shimPWR;
+EXTI_TypeDef shimEXTI;
+USBDriver USBD1 = {USB_STOP};
+void (*shimWakeHook)(void) = NULL;
+void (*shimParkHook)(void) = NULL;
+void (*shimSuspendHook)(void) = NULL;
+void (*shimSleepHook)(void) = NULL;
+
+systime_t chVTGetSystemTimeX(void) {
+  return (systime_t)(shimNowUs * CH_CFG_ST_FREQUENCY / 1000000);
+}
+
+void chThdSleep(sysinterval_t time) {
+  if (time == TIME_INFINITE) {
+    if (shimParkHook != NULL)
+      shimParkHook();
+    fprintf(stderr, "chThdSleep(TIME_INFINITE), thread would hang\n");
+    exit(1);
+  }
+  shimNowUs += (uint64_t)time * 1000000 / CH_CFG_ST_FREQUENCY;
+  if (shimSleepHook != NULL)
+    shimSleepHook();
+}
+
+void chThdSleepUntil(systime_t time) {
+  chThdSleep(chTimeDiffX(chVTGetSystemTimeX(), time));
+}
+
+msg_t chThdSuspendS(thread_reference_t *trp) {
+  // mark as waiting, chThdResumeI clears it
+  *trp = (thread_reference_t)trp;
+  if (shimSuspendHook != NULL)
+    shimSuspendHook();
+  if (*trp == NULL)
+    return MSG_OK;
+  // with one thread nobody else can wake us
+  fprintf(stderr, "chThdSuspendS, deadlock in single thread host build\n");
+  exit(1);
+}
+
+msg_t chThdSuspendTimeoutS(thread_reference_t *trp, sysinterval_t timeout) {
+  if (timeout == TIME_INFINITE)
+    return chThdSuspendS(trp);
+  chThdSleep(timeout);
+  if (shimWakeHook != NULL)
+    shimWakeHook();
+  return MSG_TIMEOUT;
+}
+
+void chThdResumeI(thread_reference_t *trp, msg_t msg) {
+  (void)msg;
+  *trp = NULL;
+}
+
+void chThdResume(thread_reference_t *trp, msg_t msg) {
+  chThdResumeI(trp, msg);
+}
+
+thread_t *chThdCreate(const thread_descriptor_t *tdp) {
+  (void)tdp;
+  return NULL;
+}
+
+void chSemObjectInit(semaphore_t *sp, int32_t n) {
+  sp->cnt = n;
+}
+
+msg_t chSemWait(semaphore_t *sp) {
+  if (--sp->cnt < 0) {
+    fprintf(stderr, "chSemWait, deadlock in single thread host build\n");
+    exit(1);
+  }
+  return MSG_OK;
+}
+
+msg_t chSemWaitTimeout(semaphore_t *sp, sysinterval_t timeout) {
+  // nobody else can signal, waiting longer doesn't help
+  if (sp->cnt <= 0) {
+    if (timeout != TIME_IMMEDIATE)
+      chThdSleep(timeout);
+    return MSG_TIMEOUT;
+  }
+  --sp->cnt;
+  return MSG_OK;
+}
+
+void chSemSignal(semaphore_t *sp) {
+  ++sp->cnt;
+}
+
+void shimAssert(bool cond, const char *remark) {
+  if (!cond) {
+    fprintf(stderr, "assert failed: %s\n", remark);
+    abort();
+  }
+}
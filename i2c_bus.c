@@ -9,11 +9,119 @@
 #include "i2c_bus.h"
 
 #include <hal.h>
+#include <ch.h>
+#include <string.h>
+
+volatile const I2cBusStats_t i2cBusStats[i2cClient_Cnt] = {0};
+volatile const I2cBusErrors_t i2cBusErrors = {0};
 
 // ----------------------------------------------------------------
 // Private stuff for this module
 
+#define STATS ((I2cBusStats_t*)i2cBusStats)
+#define ERRORS ((I2cBusErrors_t*)&i2cBusErrors)
+
+// fixed priority for each client, indexed by I2cBusClient_e
+static const uint8_t clientPrio[i2cClient_Cnt] = {
+  i2cPrio_High,   // accel, must not be delayed by EEPROM
+  i2cPrio_Normal, // settings
+  i2cPrio_Low,    // logger
+  i2cPrio_Normal  // comms, a host is waiting for the answer
+};
+
+// jobs waiting for the bus, sorted by prio, FIFO within same prio
+static I2cBusJob_t *queue = NULL;
+// job currently holding the bus, NULL when bus is free
+static I2cBusJob_t *owner = NULL;
+static systime_t ownedAt = 0;
+
+static void enqueueS(I2cBusJob_t *job) {
+  I2cBusJob_t **pp = &queue;
+  while (*pp != NULL && (*pp)->prio <= job->prio)
+    pp = &(*pp)->next;
+  job->next = *pp;
+  *pp = job;
+}
+
+static void grantS(I2cBusJob_t *job) {
+  owner = job;
+  ownedAt = chVTGetSystemTimeX();
+
+  I2cBusStats_t *st = &STATS[job->client];
+  const sysinterval_t wait = chTimeDiffX(job->queuedAt, ownedAt);
+  if (st->jobs < 0xFFFFu) {
+    ++st->jobs;
+    st->totWait += wait;
+  }
+  if (wait > st->maxWait)
+    st->maxWait = wait;
+}
+
+static void doneS(I2cBusJob_t *job) {
+  I2cBusStats_t *st = &STATS[job->client];
+  const sysinterval_t hold = chTimeDiffX(ownedAt, chVTGetSystemTimeX());
+  if (hold > st->maxHold)
+    st->maxHold = hold;
+  if (job->result != MSG_OK && st->errors < 0xFFFFu)
+    ++st->errors;
+}
+
+/**
+ * @brief count a failed transfer by cause, only the bus owner gets here
+ */
+static void countError(I2cBusJob_t *job) {
+  const i2cflags_t flags = i2cGetErrors(job->i2cp);
+  if (job->poll && job->result == MSG_RESET && (flags & I2C_ACK_FAILURE))
+    return;
+  uint16_t *cnt = job->result == MSG_TIMEOUT ? &ERRORS->timeouts :
+                  (flags & I2C_ACK_FAILURE) ? &ERRORS->nacks :
+                  (flags & I2C_ARBITRATION_LOST) ? &ERRORS->arbLost :
+                  (flags & I2C_OVERRUN) ? &ERRORS->overruns :
+                                          &ERRORS->busErrors;
+  if (*cnt < 0xFFFFu)
+    ++*cnt;
+}
 
+static void initJob(I2cBusJob_t *job) {
+  job->next = NULL;
+  job->result = MSG_OK;
+  job->prio = clientPrio[job->client];
+  job->queuedAt = chVTGetSystemTimeX();
+}
+
+static msg_t runJob(I2cBusJob_t *job) {
+  job->result = i2cMasterTransmitTimeout(job->i2cp, job->sad,
+                                         job->txbuf, job->txbytes,
+                                         job->rxbuf, job->rxbytes,
+                                         job->timeout);
+  if (job->result != MSG_OK)
+    countError(job);
+  // a timeout leaves the driver in locked state, must be restarted
+  if (job->result == MSG_TIMEOUT) {
+    i2cStop(job->i2cp);
+    i2cStart(job->i2cp, &i2ccfg);
+  }
+  return job->result;
+}
+
+/**
+ * @brief hand bus over to next job in queue, its thread is woken
+ * Each job runs in its own thread, never in the one releasing the bus.
+ */
+static void releaseAndDispatch(I2cBusJob_t *done) {
+  chSysLock();
+  doneS(done);
+  I2cBusJob_t *job = queue;
+  if (job == NULL) {
+    owner = NULL;
+  } else {
+    queue = job->next;
+    grantS(job);
+    chThdResumeI(&job->waitThd, MSG_OK);
+    chSchRescheduleS();
+  }
+  chSysUnlock();
+}
 
 // ----------------------------------------------------------------
 // Public stuff for this module
@@ -29,3 +137,42 @@ const I2CConfig i2ccfg = {
 void i2c_busInit(void) {
   i2cStart(&I2CD1, &i2ccfg);
 }
+
+msg_t i2cBusTransfer(I2cBusJob_t *job) {
+  i2cBusAcquire(job);
+  runJob(job);
+  i2cBusRelease(job);
+  return job->result;
+}
+
+void i2cBusAcquire(I2cBusJob_t *lock) {
+  initJob(lock);
+  lock->waitThd = NULL;
+
+  chSysLock();
+  if (owner == NULL)
+    grantS(lock);
+  else {
+    enqueueS(lock);
+    // releasing thread grants us the bus before waking us
+    chThdSuspendS(&lock->waitThd);
+  }
+  chSysUnlock();
+}
+
+msg_t i2cBusRunLocked(I2cBusJob_t *lock) {
+  osalDbgAssert(owner == lock, "bus not acquired");
+  return runJob(lock);
+}
+
+void i2cBusRelease(I2cBusJob_t *lock) {
+  osalDbgAssert(owner == lock, "releasing a bus we don't own");
+  releaseAndDispatch(lock);
+}
+
+void i2cBusClearStats(void) {
+  chSysLock();
+  memset(STATS, 0, sizeof(i2cBusStats));
+  memset(ERRORS, 0, sizeof(i2cBusErrors));
+  chSysUnlock();
+}
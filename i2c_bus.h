@@ -15,6 +15,105 @@ extern const I2CConfig i2ccfg;
 
 #define I2C_CLOCK  1000000
 
+/**
+ * @brief the clients that share I2CD1, each one gets its own statistics
+ */
+typedef enum {
+  i2cClient_Accel    = 0,
+  i2cClient_Settings = 1,
+  i2cClient_Logger   = 2,
+  i2cClient_Comms    = 3,
+  i2cClient_Cnt
+} I2cBusClient_e;
+
+/**
+ * @brief priority of a job, lower value is served first
+ * each client has a fixed priority, accelerometer reads use high
+ * so they pass queued EEPROM chunks
+ */
+typedef enum {
+  i2cPrio_High   = 0,
+  i2cPrio_Normal = 1,
+  i2cPrio_Low    = 2,
+} I2cBusPrio_e;
+
+typedef struct I2cBusJob I2cBusJob_t;
+
+/**
+ * @brief a bus transaction, queued while the owning thread waits
+ * The job must stay valid until the bus is released
+ */
+struct I2cBusJob {
+  I2cBusJob_t *next;        /* internal, queue link */
+  I2CDriver *i2cp;
+  const uint8_t *txbuf;
+  uint8_t *rxbuf;
+  size_t txbytes,
+         rxbytes;
+  sysinterval_t timeout;
+  thread_reference_t waitThd; /* internal, thread blocked on this job */
+  systime_t queuedAt;       /* internal, when job entered queue */
+  msg_t result;             /* result from i2c transfer */
+  i2caddr_t sad;
+  uint8_t client;           /* I2cBusClient_e */
+  bool poll;                /* a NACK is expected, device busy, not
+                               counted as error */
+  uint8_t prio;             /* internal, I2cBusPrio_e given by client */
+};
+
+/**
+ * @brief latency statistics per client, times in systicks
+ */
+typedef struct {
+  uint16_t jobs,      /* number of jobs, saturates at 0xFFFF */
+           errors;    /* number of failed transfers */
+  uint16_t maxWait,   /* longest time spent in queue */
+           maxHold;   /* longest time holding the bus */
+  uint32_t totWait;   /* sum of all queue times, for average */
+} I2cBusStats_t;
+
+/**
+ * @brief failed transfers by cause, all clients, saturates at 0xFFFF
+ */
+typedef struct {
+  uint16_t timeouts,  /* bus hung, driver was restarted */
+           busErrors, /* misplaced start or stop condition */
+           arbLost,   /* arbitration lost */
+           nacks,     /* device did not acknowledge */
+           overruns;
+} I2cBusErrors_t;
+
+extern volatile const I2cBusStats_t i2cBusStats[i2cClient_Cnt];
+extern volatile const I2cBusErrors_t i2cBusErrors;
+
 void i2c_busInit(void);
 
+/**
+ * @brief queue job and block until it is done
+ * @returns result from the transfer
+ */
+msg_t i2cBusTransfer(I2cBusJob_t *job);
+
+/**
+ * @brief lock bus for client, used by drivers that do their own transfers
+ * Blocks until all jobs with higher priority are done
+ */
+void i2cBusAcquire(I2cBusJob_t *lock);
+
+/**
+ * @brief run the transfer in lock, bus must be held through i2cBusAcquire
+ * @returns result from the transfer
+ */
+msg_t i2cBusRunLocked(I2cBusJob_t *lock);
+
+/**
+ * @brief release bus locked by i2cBusAcquire
+ */
+void i2cBusRelease(I2cBusJob_t *lock);
+
+/**
+ * @brief reset all statistics and error counters
+ */
+void i2cBusClearStats(void);
+
 #endif /* I2C_BUS_H_ */
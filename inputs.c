@@ -9,6 +9,7 @@
 #include "inputs.h"
 #include "settings.h"
 #include "diag.h"
+#include "profile.h"
 #include <hal.h>
 #include <ch.h>
 #include <stm32f042x6.h>
@@ -19,6 +20,7 @@
 #define DMA_PRIORITY 1U
 
 #define TIM2_SPEED  100000U
+#define TIM2_US     (1000000U / TIM2_SPEED)
 
 volatile const Inputs_t inputs = {0};
 
@@ -38,20 +40,68 @@ static uint32_t _receiverPulseStart = 0;
 static uint32_t _ch2data[DMA_SAMPLES_CNT],
                 _ch3data[DMA_SAMPLES_CNT],
                 _ch4data[DMA_SAMPLES_CNT];
+static bool tmr2Running,
+            wheelOn[3]; // capture on wheel channel is on
+
+/**
+ * @brief TIM2 bits for wheel sensor channels CH2-4
+ */
+typedef struct {
+  uint32_t dier, ccer,
+           ccs, ccsMask; // CCxS in CCMR1 or CCMR2
+  bool ccmr2;
+} WheelCh_t;
+
+static const WheelCh_t wheelChs[3] = {
+  {STM32_TIM_DIER_CC2DE, STM32_TIM_CCER_CC2E,
+   STM32_TIM_CCMR1_CC2S(1), STM32_TIM_CCMR1_CC2S(3), false},
+  {STM32_TIM_DIER_CC3DE, STM32_TIM_CCER_CC3E,
+   STM32_TIM_CCMR2_CC3S(1), STM32_TIM_CCMR2_CC3S(3), true},
+  {STM32_TIM_DIER_CC4DE, STM32_TIM_CCER_CC4E,
+   STM32_TIM_CCMR2_CC4S(1), STM32_TIM_CCMR2_CC4S(3), true},
+};
+
+static uint8_t pulsesPerRev(uint8_t wheel) {
+  // WheelSensor0-2_pulses_per_rev are next to each other
+  return (&settings.WheelSensor0_pulses_per_rev)[wheel];
+}
+
+/**
+ * @brief turn capture on one wheel channel on or off, timer keeps running
+ * CCxS can only be written while the channel is off in CCER.
+ */
+static void setWheelCh(uint8_t wheel, bool on) {
+  const WheelCh_t *ch = &wheelChs[wheel];
+  volatile uint32_t *ccmr = ch->ccmr2 ? &STM32_TIM2->CCMR2 :
+                                        &STM32_TIM2->CCMR1;
+  STM32_TIM2->DIER &= ~ch->dier;
+  STM32_TIM2->CCER &= ~ch->ccer;
+  *ccmr &= ~ch->ccsMask;
+  if (on) {
+    *ccmr |= ch->ccs;
+    STM32_TIM2->CCER |= ch->ccer;
+    STM32_TIM2->DIER |= ch->dier;
+  }
+  wheelOn[wheel] = on;
+}
 
 // interupts
 OSAL_IRQ_HANDLER(STM32_TIM2_HANDLER) {
   // we should only get here from CH1 (reciever) interrupt
 
   OSAL_IRQ_PROLOGUE();
+  const uint32_t start = PROFILE_CYCLES(),
+                 capturedAt = STM32_TIM2->CCR[0],
+                 latency = STM32_TIM2->CNT - capturedAt;
+
   if (STM32_TIM2->CCER & STM32_TIM_CCER_CC1P) {
     // positive flank
-    _receiverPulseStart = STM32_TIM2->CCR[0];
+    _receiverPulseStart = capturedAt;
     // trigger on negative flank next time
     STM32_TIM2->CCER |= STM32_TIM_CCER_CC1P;
   } else {
     // negative flank
-    uint32_t diff = STM32_TIM2->CCR[0] - _receiverPulseStart;
+    uint32_t diff = capturedAt - _receiverPulseStart;
     if (diff < 100)
       INPUTS->brakeForce = 0;
     else if (diff > 200)
@@ -66,11 +116,16 @@ OSAL_IRQ_HANDLER(STM32_TIM2_HANDLER) {
     STM32_TIM2->CCER &= ~STM32_TIM_CCER_CC1P;
   }
 
+  profileIsr(profileIsr_Tim2, start, latency * TIM2_US);
   OSAL_IRQ_EPILOGUE();
 }
 
 // DMA interrupt callback
 static void dma_complete_callback(uint32_t *arr, uint32_t flags) {
+  // last sample is the capture that completed the transfer
+  const uint32_t start = PROFILE_CYCLES(),
+                 latency = STM32_TIM2->CNT - arr[DMA_SAMPLES_CNT - 1];
+
   // error handling
   if ((flags & (STM32_DMA_ISR_TEIF | STM32_DMA_ISR_DMEIF)) != 0) {
     // not sure what to do? error occured
@@ -95,6 +150,8 @@ static void dma_complete_callback(uint32_t *arr, uint32_t flags) {
     else if (arr == _ch4data && (diagSetValues & diag_Set_InputWhl2) == 0)
       INPUTS->wheelRPS[2] =
           (uint8_t)(vlu / settings.WheelSensor2_pulses_per_rev);
+
+    profileIsr(profileIsr_WheelDma, start, latency * TIM2_US);
   }
 }
 
@@ -144,6 +201,7 @@ static void stopTmr2(void) {
     dmaStreamFree(dma_tim2_ch4);
 
   dma_tim2_ch2 = dma_tim2_ch3 = dma_tim2_ch4 = NULL;
+  tmr2Running = false;
 }
 
 static void startTmr2(void) {
@@ -173,23 +231,17 @@ static void startTmr2(void) {
            // enable ch1, positive flank CC1P=0
            ccer = STM32_TIM_CCER_CC1E;
 
-  // enable DMA interrupt on CH2-4
-  if (settings.WheelSensor0_pulses_per_rev > 0) {
-    dier  |= STM32_TIM_DIER_CC2DE; // DMA interrupt on CH2
-    ccmr1 |= STM32_TIM_CCMR1_CC2S(1);// enable ch2
-    ccer  |= STM32_TIM_CCER_CC2E; // enable ch2 with positive flank
-  }
-  if (settings.WheelSensor1_pulses_per_rev > 0) {
-    // DMA interrupt on CH3
-    dier  |= STM32_TIM_DIER_CC3DE; // DMA interrupt on CH3
-    ccmr2 |= STM32_TIM_CCMR2_CC3S(1);// enable ch3
-    ccer  |= STM32_TIM_CCER_CC3E; // enable ch3 with positive flank
-  }
-  if (settings.WheelSensor2_pulses_per_rev > 0) {
-    // DMA interrupt on CH4
-    dier  |= STM32_TIM_DIER_CC4DE; // DMA interrupt on CH4
-    ccmr2 |= STM32_TIM_CCMR2_CC4S(1);// enable ch4
-    ccer  |= STM32_TIM_CCER_CC4E; // enable ch4 with positive flank
+  // enable DMA interrupt on CH2-4, positive flank
+  for (uint8_t w = 0; w < 3; ++w) {
+    wheelOn[w] = pulsesPerRev(w) > 0;
+    if (!wheelOn[w])
+      continue;
+    dier |= wheelChs[w].dier;
+    ccer |= wheelChs[w].ccer;
+    if (wheelChs[w].ccmr2)
+      ccmr2 |= wheelChs[w].ccs;
+    else
+      ccmr1 |= wheelChs[w].ccs;
   }
 
   // interrupts and dma
@@ -233,6 +285,7 @@ static void startTmr2(void) {
   STM32_TIM2->SR = 0;
 
   STM32_TIM2->CR1 = STM32_TIM_CR1_URS | STM32_TIM_CR1_CEN;
+  tmr2Running = true;
 }
 
 /*
@@ -273,8 +326,17 @@ void inputsStart(void) {
 }
 
 void inputsSettingsChanged(void) {
-  stopTmr2();
-  startTmr2();
+  if (!tmr2Running) {
+    startTmr2();
+    return;
+  }
+  // a changed pulse count is picked up by DMA callback, only channels
+  // turned on or off need the timer, the others keep capturing
+  for (uint8_t w = 0; w < 3; ++w) {
+    const bool on = pulsesPerRev(w) > 0;
+    if (on != wheelOn[w])
+      setWheelCh(w, on);
+  }
 }
 
 void inputsStop(void) {
@@ -9,41 +9,32 @@
 #include "inputs.h"
 #include "accelerometer.h"
 #include "eeprom.h"
+#include "i2c_bus.h"
 #include "threads.h"
 #include "brake_logic.h"
 #include "usbcfg.h"
 #include "comms.h"
+#include "crc.h"
+#include "capture.h"
+#include "session.h"
 #include <ch.h>
-
-//#define LOG_ALIGNMENT_CHECK TRUE
-
-#ifndef LOG_ALIGNMENT_CHECK
-# define LOG_ALIGNMENT_CHECK FALSE
-#endif
-
-#define OFFSET_IN_LOG(offset) \
-   ((offset) < EEPROM_LOG_SIZE - 4)
-
-#define OFFSET_NEXT(offset) \
-  OFFSET_IN_LOG(offset) ? (offset) : 0
+#include <string.h>
 
 /*
  * Memory structure for Logger:
- * log .. many Log_Items
- * log .. many Log_Items
+ * page .. sync, keyframe, deltas.., zero filled, LogPageTrailer_t
+ * page .. sync, keyframe, deltas.., zero filled, LogPageTrailer_t
  * ....
- * last 4 bytes: offset to next LogItem
+ * a coldstart record (LogBuf_t) starts each session, see logger.h for
+ * record formats. A record never spans two pages, pages are used round
+ * robin and the page with highest seq is the newest one. Pages with seq
+ * before the generation start in LogHeader_t are left from before the
+ * log was cleared and are treated as unused.
  */
-// arm is little endian, we want big endian
-#define LOG_ITEM(thing, typ) {                          \
-  itm.size = (sizeof(thing) -1) & 0x03;                 \
-  itm.type = typ;                                       \
-  *pos++ = (uint8_t)((uint8_t*)(&itm))[0];              \
-  if (sizeof(thing) > 3) *pos++ = ((thing) & 0xff000000) >> 24; \
-  if (sizeof(thing) > 2) *pos++ = ((thing) & 0xff0000) >> 16; \
-  if (sizeof(thing) > 1) *pos++ = ((thing) & 0xff00) >> 8; \
-  *pos++ = ((thing) & 0xff);                        \
-  ++log.itemCnt;                                         \
+
+#define LOG_SAMPLE(thing, typ) {                        \
+  cur[typ] = (thing);                                   \
+  curMask |= 1UL << (typ);                              \
 }
 
 bool blockLog = false;
@@ -51,158 +42,704 @@ bool blockLog = false;
 // ---------------------------------------------------------------
 // private stuff for this file
 static sysinterval_t logTimeout = TIME_MS2I(640);
+// adaptive logging, only touched by logger thread except at settings change
+static uint8_t logRate;       // SETTINGS_LOG_* logTimeout is from
+static bool fastRate,         // logging at logFastPeriodicity
+            ratePending;      // logRate not yet stored in log
+static systime_t busyAt;      // when braking or fast was seen last
 
 static LogBuf_t log;
 static LogItem_t itm;
-static uint32_t offsetNext;
+
+// values for this record and the one before, indexed by LogType_e
+static int32_t cur[LOGITEMS_CNT], prev[LOGITEMS_CNT];
+static uint32_t curMask, prevMask; // bit set for each logged item
+static uint8_t rec[LOG_RECORD_MAX];
+
+// name hashes are FNV-1a of the LogType_e name without log_, must match
+// ItemBase.Types in frontend
+#define SCHEMA(typ, bytes, flags, scale, hash) \
+  {typ, ((bytes) - 1) | (flags), scale, {(hash) >> 8, (hash) & 0xFF}}
+static const LogSchemaItem_t schema[LOGITEMS_CNT] = {
+  SCHEMA(log_speedOnGround,    1, 0, LOG_SCALE(0, 0), 0xD061),
+  SCHEMA(log_wheelRPS_0,       1, 0, LOG_SCALE(0, 0), 0xC363),
+  SCHEMA(log_wheelRPS_1,       1, 0, LOG_SCALE(0, 0), 0xC5F0),
+  SCHEMA(log_wheelRPS_2,       1, 0, LOG_SCALE(0, 0), 0xC645),
+  SCHEMA(log_wantedBrakeForce, 1, 0, LOG_SCALE(0, 0), 0x222C),
+  SCHEMA(log_calcBrakeForce,   1, 0, LOG_SCALE(0, 0), 0xED71),
+  SCHEMA(log_brakeForce0_out,  1, 0, LOG_SCALE(0, 0), 0xD906),
+  SCHEMA(log_brakeForce1_out,  1, 0, LOG_SCALE(0, 0), 0x5065),
+  SCHEMA(log_brakeForce2_out,  1, 0, LOG_SCALE(0, 0), 0xE0C6),
+  // slip is in permille
+  SCHEMA(log_slip0,            2, 0, LOG_SCALE(0, 1), 0x2661),
+  SCHEMA(log_slip1,            2, 0, LOG_SCALE(0, 1), 0x230E),
+  SCHEMA(log_slip2,            2, 0, LOG_SCALE(0, 1), 0x3CBB),
+  SCHEMA(log_accelSteering,    2, LOG_SCHEMA_SIGNED, LOG_SCALE(0, 0), 0x005F),
+  SCHEMA(log_wsSteering,       2, LOG_SCHEMA_SIGNED, LOG_SCALE(0, 0), 0x9F50),
+  // accelerometer is 512 per G
+  SCHEMA(log_accel,            2, LOG_SCHEMA_SIGNED, LOG_SCALE(9, 0), 0xFB04),
+  SCHEMA(log_accelX,           2, LOG_SCHEMA_SIGNED, LOG_SCALE(9, 0), 0xC64E),
+  SCHEMA(log_accelY,           2, LOG_SCHEMA_SIGNED, LOG_SCALE(9, 0), 0xC121),
+  SCHEMA(log_accelZ,           2, LOG_SCHEMA_SIGNED, LOG_SCALE(9, 0), 0xC3B4),
+};
+_Static_assert(sizeof(schema) + 2 == LOG_SCHEMA_SIZE, "schema size");
+
+// session time, counted on each loop lap also when not logging, so a
+// pause longer than systime_t wraps still shows in the log
+static uint32_t curMs, prevMs;  // ms since coldstart for cur and prev
+static uint32_t coldStartMs;    // uptime at coldstart
+
+// records are collected in buf and written to EEPROM a page at a time,
+// everything after pageFill in buf is always 0
 static uint8_t buf[EEPROM_PAGE_SIZE];
+static uint32_t pageSeq;      // seq for page in buf
+static uint16_t pageIdx,      // index of page in buf in log partition
+                pageFill,     // bytes of records in buf
+                pageFlushed;  // bytes of buf already stored in EEPROM
+static systime_t dirtySince;  // when first unflushed record was added
+static uint32_t genStart;     // seq of first page in this generation
+static bool genKnown;         // from log header, false until first clear
+static semaphore_t pageSem;   // guards buf, used by comms jobs too
+static thread_reference_t waitRef = NULL;
+static volatile bool powerFail = false;
+
+static ee24_arg_t pageArg = {
+  &log_ee, 0, buf, 0, 0, {0, 0}, i2cClient_Logger
+};
+
+_Static_assert(sizeof(LogPageTrailer_t) == LOG_PAGE_TRAILER_SIZE,
+               "Trailer size mismatch");
+_Static_assert(sizeof(LogHeader_t) == LOG_HEADER_SIZE,
+               "Header size mismatch");
+
+static uint32_t fromBE32(const uint8_t *buf) {
+  return (uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 |
+         (uint32_t)buf[2] << 8 | buf[3];
+}
 
-static sysinterval_t logPeriodicityMS(void) {
+static sysinterval_t logPeriodicityMS(uint8_t periodicity) {
   sysinterval_t time = 2;
-  for(uint8_t i = 0; i < settings.logPeriodicity; ++i)
+  for(uint8_t i = 0; i < periodicity; ++i)
     time *= 2;
   time = TIME_MS2I(10 * time);
   return time;
 }
 
-static msg_t logColdStart(ee24_arg_t *eeArg) {
+static void setRate(uint8_t rate) {
+  logRate = rate;
+  logTimeout = logPeriodicityMS(rate);
+  ratePending = true;
+}
+
+/**
+ * @brief log fast while braking or rolling fast, slow otherwise
+ * Speed must drop a quarter below logFastSpeed and braking must have
+ * ended LOGGER_FAST_HOLD_MS ago before going back to the slow rate.
+ */
+static void updateRate(void) {
+  if (!settings.logAdaptive)
+    return;
+
+  const systime_t now = chVTGetSystemTimeX();
+  const uint8_t limit = settings.logFastSpeed;
+  // slip is only calculated while braking, so ABS is covered by this
+  const bool braking = values.brakeForce > 0 &&
+                       values.brakeForce >= settings.lower_threshold,
+             rolling = limit > 0 && values.speedOnGround >=
+                         (fastRate ? limit - limit / 4 : limit);
+  if (braking || rolling)
+    busyAt = now;
+
+  const bool fast = braking || rolling ||
+      (fastRate && chTimeDiffX(busyAt, now) < TIME_MS2I(LOGGER_FAST_HOLD_MS));
+  if (fast == fastRate)
+    return;
+  fastRate = fast;
+  setRate(fast ? settings.logFastPeriodicity : settings.logPeriodicity);
+}
+
+/**
+ * @brief write unflushed part of page and the trailer to EEPROM
+ * Writes to the end of page so stale data after pageFill gets zeroed,
+ * a partial page costs one write cycle, same as a full page.
+ * The trailer is rewritten with each flush, if power is lost during
+ * the write the crc fails and the page is ignored at next boot.
+ */
+static msg_t pageFlush(void) {
+  if (pageFlushed >= pageFill)
+    return MSG_OK;
+
+  LogPageTrailer_t *trailer = (LogPageTrailer_t*)&buf[LOG_PAGE_PAYLOAD];
+  trailer->seq[0] = (pageSeq & 0xFF000000) >> 24;
+  trailer->seq[1] = (pageSeq & 0x00FF0000) >> 16;
+  trailer->seq[2] = (pageSeq & 0x0000FF00) >> 8;
+  trailer->seq[3] = (pageSeq & 0x000000FF);
+  trailer->used = (uint8_t)pageFill;
+  trailer->crc = crc8(buf, EEPROM_PAGE_SIZE - 1);
+
+  pageArg.offset = (uint32_t)pageIdx * EEPROM_PAGE_SIZE + pageFlushed;
+  pageArg.buf = &buf[pageFlushed];
+  pageArg.len = EEPROM_PAGE_SIZE - pageFlushed;
+  msg_t res = ee24m01r_write(&pageArg);
+  if (res == MSG_OK)
+    pageFlushed = pageFill;
+  return res;
+}
+
+static void pageClear(void) {
+  pageFill = pageFlushed = 0;
+  for (uint16_t i = 0; i < EEPROM_PAGE_SIZE; ++i)
+    buf[i] = 0;
+}
+
+static void pageNext(void) {
+  if (++pageIdx >= EEPROM_LOG_PAGES)
+    pageIdx = 0;
+  ++pageSeq;
+  pageClear();
+}
+
+/**
+ * @brief copy record and its crc to page buffer, caller knows it fits
+ */
+static void pagePut(const uint8_t *data, uint8_t len) {
+  for (uint8_t i = 0; i < len; ++i)
+    buf[pageFill + i] = data[i];
+  buf[pageFill + len] = crc8(data, len);
+  pageFill += len + LOG_CRC_SIZE;
+}
+
+/**
+ * @brief add record to page buffer, writes page when it is full
+ */
+static msg_t pageAppend(const uint8_t *data, uint8_t len) {
+  msg_t res = MSG_OK;
+
+  // a record never spans pages, rest of page stays zero filled
+  if (pageFill + len + LOG_CRC_SIZE > LOG_PAGE_PAYLOAD) {
+    res = pageFlush();
+    pageNext();
+  }
+
+  if (pageFill == pageFlushed)
+    dirtySince = chVTGetSystemTimeX();
+
+  if (pageFill == 0) {
+    // readers find their way back here after a broken record
+    const uint8_t sync[LOG_SYNC_SIZE] = {
+      LOG_KIND_SYNC,
+      (pageSeq & 0xFF000000) >> 24, (pageSeq & 0x00FF0000) >> 16,
+      (pageSeq & 0x0000FF00) >> 8, (pageSeq & 0x000000FF)
+    };
+    pagePut(sync, sizeof(sync));
+  }
+  pagePut(data, len);
+
+  if (res == MSG_OK && pageFill == LOG_PAGE_PAYLOAD) {
+    res = pageFlush();
+    pageNext();
+  }
+
+  return res;
+}
+
+/**
+ * @brief read page at idx into buf
+ * @returns true if page holds records of this generation, seq is set
+ *          from page trailer
+ */
+static bool pageRead(uint16_t idx, uint32_t *seq, msg_t *res) {
+  pageArg.offset = (uint32_t)idx * EEPROM_PAGE_SIZE;
+  pageArg.buf = buf;
+  pageArg.len = EEPROM_PAGE_SIZE;
+  *res = ee24m01r_read(&pageArg);
+  if (*res != MSG_OK)
+    return false;
+
+  const LogPageTrailer_t *trailer =
+      (const LogPageTrailer_t*)&buf[LOG_PAGE_PAYLOAD];
+  *seq = (uint32_t)trailer->seq[0] << 24 | (uint32_t)trailer->seq[1] << 16 |
+         (uint32_t)trailer->seq[2] << 8  | trailer->seq[3];
+  return trailer->used > 0 && trailer->used <= LOG_PAGE_PAYLOAD &&
+         trailer->crc == crc8(buf, EEPROM_PAGE_SIZE - 1) &&
+         (!genKnown || *seq >= genStart);
+}
+
+/**
+ * @brief read generation from log header, a log never cleared has none
+ */
+static msg_t headerRead(void) {
+  static ee24_arg_t arg = {&loghdr_ee, 0, NULL, 0, 0, {0, 0}, i2cClient_Logger};
+  LogHeader_t hdr;
+  arg.buf = (uint8_t*)&hdr;
+  arg.len = sizeof(hdr);
+  const msg_t res = ee24m01r_read(&arg);
+  genKnown = res == MSG_OK && hdr.magic == LOG_HEADER_MAGIC &&
+             hdr.crc == crc8((uint8_t*)&hdr, sizeof(hdr) - 1);
+  genStart = genKnown ? fromBE32(hdr.genStart) : 0;
+  return res;
+}
+
+/**
+ * @brief store a new generation, pages from before are unused from now
+ * One small write, the log itself is never touched.
+ */
+static msg_t headerWrite(uint32_t gen) {
+  static ee24_arg_t arg = {&loghdr_ee, 0, NULL, 0, 0, {0, 0}, i2cClient_Comms};
+  LogHeader_t hdr;
+  hdr.magic = LOG_HEADER_MAGIC;
+  TO_BIG_ENDIAN_32(hdr.genStart, gen);
+  hdr.crc = crc8((uint8_t*)&hdr, sizeof(hdr) - 1);
+  arg.buf = (uint8_t*)&hdr;
+  arg.len = sizeof(hdr);
+  const msg_t res = ee24m01r_write(&arg);
+  if (res == MSG_OK) {
+    genStart = gen;
+    genKnown = true;
+  }
+  return res;
+}
+
+/**
+ * @brief find newest page and continue with a new page after that
+ * Pages 0..head hold seq0, seq0+1 .. seq0+head, pages after head are
+ * older, erased or broken. That makes it possible to binary search
+ * for head, reading about 9 pages instead of all of them.
+ */
+static msg_t pageFindHead(void) {
+  msg_t res = headerRead();
+  uint32_t seq0, seq;
+
+  if (res != MSG_OK) {
+    return res;
+  } else if (pageRead(0, &seq0, &res)) {
+    uint16_t lo = 0, hi = EEPROM_LOG_PAGES;
+    while (hi - lo > 1) {
+      const uint16_t mid = lo + (hi - lo) / 2;
+      if (pageRead(mid, &seq, &res) && seq - seq0 == mid)
+        lo = mid;
+      else if (res != MSG_OK)
+        return res;
+      else
+        hi = mid;
+    }
+    pageIdx = lo;
+    pageSeq = seq0 + lo;
+  } else if (res != MSG_OK) {
+    return res;
+  } else if (pageRead(EEPROM_LOG_PAGES - 1, &seq, &res)) {
+    // lost power while rewriting first page after a wrap around
+    pageIdx = EEPROM_LOG_PAGES - 1;
+    pageSeq = seq;
+  } else if (res != MSG_OK) {
+    return res;
+  } else {
+    // empty log, or cleared
+    pageIdx = EEPROM_LOG_PAGES - 1;
+    pageSeq = genStart - 1;
+  }
+
+  // never write to a page with records again, a failed write
+  // would destroy them
+  pageNext();
+  return MSG_OK;
+}
+
+// data frames streamed to host, only used from the thread running
+// long comms commands
+static usbpkg_t *txPkg;
+static uint16_t txPkgId, txLen;
+static uint32_t txDone, txTotal; // bytes, for JobStatus
+#define TX_DATA_SIZE  (sizeof(txPkg->datafrm.data))
+
+static msg_t txStart(usbpkg_t *sndpkg, uint32_t totalSize, uint32_t writePos) {
+  txPkg = sndpkg;
+  txPkgId = 1;
+  txLen = 0;
+  txDone = 0;
+  txTotal = totalSize;
+  commsJobProgress(txDone, txTotal);
+  INIT_PKG_HEADER_FRM(*sndpkg, totalSize, writePos);
+  return usbQueueTransmit(sndpkg);
+}
+
+/**
+ * @brief send frame filled so far, if any
+ */
+static msg_t txFlush(void) {
+  if (txLen == 0)
+    return MSG_OK;
+  txPkg->datafrm.len += txLen;
+  txDone += txLen;
+  txLen = 0;
+  commsJobProgress(txDone, txTotal);
+  // EEPROM is read for next frame while this one is sent
+  return usbQueueTransmit(txPkg);
+}
+
+/**
+ * @brief add bytes to frames, frames are sent as they get full
+ */
+static msg_t txPut(const uint8_t *data, uint32_t len) {
+  msg_t msg = MSG_OK;
+  while (len > 0 && msg == MSG_OK) {
+    if (txLen == 0) {
+      // macro uses pkgnr twice, no side effects in argument
+      INIT_PKG_DATA_FRM(*txPkg, txPkgId);
+      ++txPkgId;
+    }
+    uint32_t n = TX_DATA_SIZE - txLen;
+    if (n > len)
+      n = len;
+    memcpy(&txPkg->datafrm.data[txLen], data, n);
+    txLen += n;
+    data += n;
+    len -= n;
+    if (txLen == TX_DATA_SIZE)
+      msg = txFlush();
+  }
+  return msg;
+}
+
+/**
+ * @brief read from partition in blocks and add them to frames
+ */
+static msg_t txEeprom(const ee24partition_t *eep, uint32_t offset,
+                      uint32_t len)
+{
+  static uint8_t block[LOGGER_READ_BLOCK_SIZE];
+  static ee24_arg_t arg = {NULL, 0, block, 0, 0, {0, 0}, i2cClient_Comms};
+  msg_t msg = MSG_OK;
+  arg.eep = eep;
+  arg.offset = offset;
+  while (len > 0 && msg == MSG_OK) {
+    arg.len = len < sizeof(block) ? len : sizeof(block);
+    // host might give up on a long transfer
+    msg = commsJobCancelled() ? MSG_RESET : ee24m01r_read(&arg);
+    if (msg == MSG_OK)
+      msg = txPut(block, arg.len);
+    arg.offset += arg.len;
+    len -= arg.len;
+  }
+  return msg;
+}
+
+// pages a host can fetch, seq oldest .. end - 1
+typedef struct {
+  uint32_t seq,      // page in buf
+           genStart, // first page in this generation
+           oldest,   // oldest page in this generation still in EEPROM
+           end;      // after newest page with records
+  uint16_t idx;      // index of page in buf
+} LogHead_t;
+
+/**
+ * @brief flush records in RAM and tell where log head is
+ */
+static msg_t logHead(LogHead_t *head) {
+  chSemWait(&pageSem);
+  const msg_t msg = pageFlush();
+  head->seq = pageSeq;
+  head->idx = pageIdx;
+  head->end = pageSeq + (pageFill > 0 ? 1 : 0);
+  chSemSignal(&pageSem);
+
+  head->genStart = genStart;
+  head->oldest = head->end - head->genStart > EEPROM_LOG_PAGES ?
+                   head->end - EEPROM_LOG_PAGES : head->genStart;
+  return msg;
+}
+
+/**
+ * @brief send flags and cnt pages from seq from, oldest first
+ * Reply ends with OK or Error, as all multi frame replies.
+ */
+static void sendPages(usbpkg_t *sndpkg, msg_t msg, const LogHead_t *head,
+                      uint32_t from, uint32_t cnt, uint8_t flags)
+{
+  const uint32_t first = (head->idx + EEPROM_LOG_PAGES - (head->seq - from)) %
+                            EEPROM_LOG_PAGES,
+                 cnt1 = first + cnt > EEPROM_LOG_PAGES ?
+                          EEPROM_LOG_PAGES - first : cnt;
+
+  if (msg == MSG_OK)
+    msg = txStart(sndpkg, 1 + cnt * EEPROM_PAGE_SIZE,
+                  (uint32_t)head->idx * EEPROM_PAGE_SIZE);
+  if (msg == MSG_OK)
+    msg = txPut(&flags, 1);
+  // pages wrap around at most once
+  if (msg == MSG_OK && cnt1 > 0)
+    msg = txEeprom(&log_ee, first * EEPROM_PAGE_SIZE,
+                   cnt1 * EEPROM_PAGE_SIZE);
+  if (msg == MSG_OK && cnt > cnt1)
+    msg = txEeprom(&log_ee, 0, (cnt - cnt1) * EEPROM_PAGE_SIZE);
+  if (msg == MSG_OK)
+    msg = txFlush();
+
+  INIT_PKG(*sndpkg,
+           msg == MSG_OK ? commsCmd_OK : commsCmd_Error,
+           sndpkg->onefrm.reqId);
+  usbWaitTransmit(sndpkg);
+}
+
+static msg_t logColdStart(void) {
   log.itemCnt = 1u;
   log.size = 4u;
   itm.size = 0; itm.type = log_coldStart;
   log.buf[0] = ((uint8_t*)&itm)[0];
-  log.buf[1] = 0x5A; // bit twiddle to easily find during debug
+  log.buf[1] = LOG_FORMAT_VERSION;
+
+  // first record after a coldstart is always a keyframe
+  prevMask = 0;
+  curMs = prevMs = 0;
+  coldStartMs = threadsUptimeMs();
+  msg_t res = pageAppend((uint8_t*)&log, log.size);
+  // a failed directory write should not stop logging
+  sessionOpen(pageSeq);
+
+  // schema tells host how to decode this session
+  rec[0] = LOG_KIND_SCHEMA;
+  rec[1] = LOGITEMS_CNT;
+  memcpy(&rec[2], schema, sizeof(schema));
+  if (res == MSG_OK)
+    res = pageAppend(rec, LOG_SCHEMA_SIZE);
+  ratePending = true;
+  return res;
+}
+
+/**
+ * @brief store log rate, host knows the period records are taken at
+ */
+static msg_t logAppendRate(void) {
+  const uint32_t seq = pageSeq;
+  const bool empty = pageFill == 0;
+  rec[0] = LOG_KIND_RATE;
+  rec[1] = logRate;
+  const msg_t res = pageAppend(rec, LOG_RATE_SIZE);
+  // rate is first in page, record after it must be a keyframe
+  if (empty || pageSeq != seq)
+    prevMask = 0;
+  ratePending = false;
+  return res;
+}
+
+static uint8_t *putVarint(uint8_t *pos, uint32_t vlu) {
+  while (vlu >= 0x80) {
+    *pos++ = (uint8_t)vlu | 0x80;
+    vlu >>= 7;
+  }
+  *pos++ = (uint8_t)vlu;
+  return pos;
+}
+
+// small negative numbers becomes small positive numbers
+static uint32_t zigzag(int32_t vlu) {
+  return ((uint32_t)vlu << 1) ^ (uint32_t)(vlu >> 31);
+}
+
+/**
+ * @brief encode sampled values into rec
+ * @returns size of record
+ */
+static uint8_t encodeLog(bool keyframe) {
+  uint32_t mask = curMask;
+  if (!keyframe) {
+    for (uint8_t i = 0; i < LOGITEMS_CNT; ++i)
+      if (cur[i] == prev[i])
+        mask &= ~(1UL << i);
+  }
+
+  uint8_t *pos = rec;
+  *pos++ = keyframe ? LOG_KIND_KEYFRAME : LOG_KIND_DELTA;
+  pos = putVarint(pos, keyframe ? curMs : curMs - prevMs);
+  pos = putVarint(pos, mask);
+  for (uint8_t i = 0; mask != 0; ++i, mask >>= 1) {
+    if (mask & 1)
+      pos = putVarint(pos, zigzag(keyframe ? cur[i] : cur[i] - prev[i]));
+  }
+  return (uint8_t)(pos - rec);
+}
+
+/**
+ * @brief store sampled values, as delta to record before when possible
+ */
+static msg_t logAppendRecord(void) {
+  msg_t res = MSG_OK;
+  uint8_t len = encodeLog(pageFill == 0 || curMask != prevMask);
+
+  if (pageFill + len + LOG_CRC_SIZE > LOG_PAGE_PAYLOAD) {
+    // next page must be decodable even if this one gets lost
+    res = pageFlush();
+    pageNext();
+    len = encodeLog(true);
+  }
+
+  if (res == MSG_OK)
+    res = pageAppend(rec, len);
 
-  // update in eeprom
-  eeArg->offset = offsetNext = OFFSET_NEXT(offsetNext);
-  eeArg->buf = (uint8_t*)&log;
-  eeArg->len = log.size;
-  return ee24m01r_write(eeArg);
+  for (uint8_t i = 0; i < LOGITEMS_CNT; ++i)
+    prev[i] = cur[i];
+  prevMask = curMask;
+  prevMs = curMs;
+  return res;
 }
 
-static void buildLog(void) {
-  uint8_t *pos = ((uint8_t*)&log)+2;
-  log.itemCnt = 0;
+static void sampleLog(void) {
+  curMask = 0;
 
-  LOG_ITEM(inputs.brakeForce, log_wantedBrakeForce);
-  LOG_ITEM(values.brakeForce, log_calcBrakeForce);
+  LOG_SAMPLE(inputs.brakeForce, log_wantedBrakeForce);
+  LOG_SAMPLE(values.brakeForce, log_calcBrakeForce);
 
   if (settings.Brake0_active)
-    LOG_ITEM(values.brakeForce_out[0], log_brakeForce0_out);
+    LOG_SAMPLE(values.brakeForce_out[0], log_brakeForce0_out);
   if (settings.Brake1_active)
-    LOG_ITEM(values.brakeForce_out[1], log_brakeForce1_out);
+    LOG_SAMPLE(values.brakeForce_out[1], log_brakeForce1_out);
   if (settings.Brake2_active)
-    LOG_ITEM(values.brakeForce_out[2], log_brakeForce2_out);
+    LOG_SAMPLE(values.brakeForce_out[2], log_brakeForce2_out);
 
   if (settings.WheelSensor0_pulses_per_rev>0 ||
       settings.WheelSensor1_pulses_per_rev>0 ||
       settings.WheelSensor2_pulses_per_rev>0)
   {
-    LOG_ITEM(values.speedOnGround, log_speedOnGround);
+    LOG_SAMPLE(values.speedOnGround, log_speedOnGround);
     if (settings.WheelSensor0_pulses_per_rev>0) {
-      LOG_ITEM(inputs.wheelRPS[0], log_wheelRPS_0);
+      LOG_SAMPLE(inputs.wheelRPS[0], log_wheelRPS_0);
       if (settings.ABS_active)
-        LOG_ITEM(values.slip[0], log_slip0);
+        LOG_SAMPLE(values.slip[0], log_slip0);
     }
     if (settings.WheelSensor1_pulses_per_rev>0) {
-      LOG_ITEM(inputs.wheelRPS[1], log_wheelRPS_1);
+      LOG_SAMPLE(inputs.wheelRPS[1], log_wheelRPS_1);
       if (settings.ABS_active)
-        LOG_ITEM(values.slip[1], log_slip1);
+        LOG_SAMPLE(values.slip[1], log_slip1);
     }
     if (settings.WheelSensor2_pulses_per_rev>0) {
-      LOG_ITEM(inputs.wheelRPS[2], log_wheelRPS_2);
+      LOG_SAMPLE(inputs.wheelRPS[2], log_wheelRPS_2);
       if (settings.ABS_active)
-        LOG_ITEM(values.slip[2], log_slip2);
+        LOG_SAMPLE(values.slip[2], log_slip2);
     }
 
     if (settings.ws_steering_brake_authority>0)
-      LOG_ITEM(values.wsSteering, log_wsSteering);
+      LOG_SAMPLE(values.wsSteering, log_wsSteering);
   }
 
   if (settings.accelerometer_active) {
-    LOG_ITEM(accel.axis[0], log_accelX);
-    LOG_ITEM(accel.axis[1], log_accelY);
-    LOG_ITEM(accel.axis[2], log_accelZ);
-    LOG_ITEM(values.acceleration, log_accel);
+    LOG_SAMPLE(accel.axis[0], log_accelX);
+    LOG_SAMPLE(accel.axis[1], log_accelY);
+    LOG_SAMPLE(accel.axis[2], log_accelZ);
+    LOG_SAMPLE(values.acceleration, log_accel);
     if (settings.acc_steering_brake_authority>0)
-      LOG_ITEM(values.accelSteering, log_accelSteering);
+      LOG_SAMPLE(values.accelSteering, log_accelSteering);
   }
-
-  // last set the size off this log
-  log.size = pos - (uint8_t*)&log;
 }
 
-THD_WORKING_AREA(waLoggerThd, 128);
+// capture flush and session directory scan add to the EEPROM calls
+THD_WORKING_AREA(waLoggerThd, 240 + EE24M01R_STACK_USE);
 THD_FUNCTION(LoggerThd, arg) {
   (void)arg;
 
-  static ee24_arg_t eeArg = {
-    &log_ee, EEPROM_LOG_NEXT_ADDR_OFFSET, (uint8_t*)&offsetNext,
-    0, sizeof(offsetNext), {0, 0}
-  };
-
-  // read start pos of low address
-  msg_t res = ee24m01r_read(&eeArg);
-  if (res != MSG_OK) {
-    chThdSleep(TIME_INFINITE);
-    return;
-  }
-
-  // log a cold start
-  res = logColdStart(&eeArg);
+  chSemWait(&pageSem);
+  // find where we were and log a cold start
+  msg_t res = pageFindHead();
+  if (res == MSG_OK)
+    res = logColdStart();
+  chSemSignal(&pageSem);
   if (res != MSG_OK) {
     chThdSleep(TIME_INFINITE);
     return;
   }
 
   // start thread loop
+  sysinterval_t sleep = logTimeout;
+  systime_t loggedAt = chVTGetSystemTimeX();
   while (true) {
-    chThdSleep(logTimeout);
+    // sleep, power fail interrupt, a capture or brakes wakes us up early
+    // a power fail while we were busy found nobody to wake up
+    chSysLock();
+    const msg_t wake = powerFail ? MSG_RESET :
+                         chThdSuspendTimeoutS(&waitRef, sleep);
+    chSysUnlock();
+
+    // on power fail the log goes first, a capture only if time allows,
+    // a failed capture write should not stop logging
+    if (!powerFail)
+      captureFlush();
+    updateRate();
+    if (wake == MSG_OK) {
+      // woken early, sleep the rest of the log period, which might
+      // just have become shorter
+      const sysinterval_t slept =
+          chTimeDiffX(loggedAt, chVTGetSystemTimeX());
+      sleep = slept < logTimeout ? logTimeout - slept : TIME_IMMEDIATE;
+      if (sleep != TIME_IMMEDIATE)
+        continue;
+    }
+    sleep = logTimeout;
+    loggedAt = chVTGetSystemTimeX();
+
+    chSemWait(&pageSem);
+    curMs = threadsUptimeMs() - coldStartMs;
+
+    if (powerFail) {
+      // store what we have before power goes
+      pageFlush();
+      sessionClose(pageFill > 0 ? pageSeq : pageSeq - 1, curMs);
+      chSemSignal(&pageSem);
+      captureFlush();
+
+      // VDD might come back without a reset, log on as after a boot
+      powerFail = false;
+      while (PWR->CSR & PWR_CSR_PVDO)
+        chThdSleep(TIME_MS2I(LOGGER_PVD_POLL_MS));
+
+      chSemWait(&pageSem);
+      if (pageFill > 0)
+        pageNext();
+      res = logColdStart();
+      chSemSignal(&pageSem);
+      if (res != MSG_OK) {
+        chThdSleep(TIME_INFINITE);
+        return;
+      }
+      loggedAt = chVTGetSystemTimeX();
+      continue;
+    }
+
     if (blockLog == true ||
         (usbGetDriverStateI(&USBD1) == USB_ACTIVE) ||
         (settings.dontLogWhenStill && values.speedOnGround == 0))
     {
-      continue; // don't log when USB is plugged in
+      // don't log when USB is plugged in, make log readable from USB
+      res = pageFlush();
+    } else {
+      // sample log values and store them
+      if (ratePending)
+        res = logAppendRate();
+      sampleLog();
+      if (res == MSG_OK)
+        res = logAppendRecord();
+      if (res == MSG_OK)
+        sessionRecord();
+
+      // don't keep records in RAM forever
+      if (res == MSG_OK && pageFill > pageFlushed &&
+          chTimeDiffX(dirtySince, chVTGetSystemTimeX()) >=
+            TIME_MS2I(LOGGER_FLUSH_TIMEOUT_MS))
+      {
+        res = pageFlush();
+      }
     }
 
-    // first align to previous log
-    offsetNext = OFFSET_NEXT(offsetNext + log.size);
-
-    // build up log values
-    buildLog();
+    chSemSignal(&pageSem);
 
-    // store it
-    eeArg.len = log.size;
-    eeArg.buf = (uint8_t*)&log;
-    eeArg.offset = OFFSET_IN_LOG(offsetNext + log.size) ?
-                     offsetNext : 0;
-    res = ee24m01r_write(&eeArg);
     if (res != MSG_OK) {
       chThdSleep(TIME_INFINITE);
       return;
     }
-
-    // don't wear ot EEPROM, only save the nextadresspointer each 5s.
-    static systime_t nextWrite = 0, curTime;
-    chSysLock();
-    curTime = chVTGetSystemTimeX();
-    chSysUnlock();
-    if (nextWrite < curTime) {
-      nextWrite = curTime + TIME_MS2I(5000);
-      // update nextOffset in memory
-      eeArg.offset = EEPROM_LOG_NEXT_ADDR_OFFSET;
-      eeArg.len = sizeof(offsetNext);
-      eeArg.buf = (uint8_t*)&offsetNext;
-      res = ee24m01r_write(&eeArg);
-      if (res != MSG_OK) {
-        chThdSleep(TIME_INFINITE);
-        return;
-      }
-    }
   }
 }
 
 static thread_descriptor_t loggerThdDesc = {
-   "accel",
+   "logger",
    THD_WORKING_AREA_BASE(waLoggerThd),
    THD_WORKING_AREA_END(waLoggerThd),
    PRIO_LOGGER_THD,
@@ -210,52 +747,77 @@ static thread_descriptor_t loggerThdDesc = {
    NULL
 };
 
+/**
+ * @brief power voltage detector, VDD fell below PVD threshold
+ * PVD_VDDIO2_IRQn, EXTI line 16, logger thread polls PVDO until VDD
+ * is back
+ */
+OSAL_IRQ_HANDLER(Vector44) {
+  OSAL_IRQ_PROLOGUE();
+
+  EXTI->PR = EXTI_PR_PR16;
+
+  osalSysLockFromISR();
+  powerFail = true;
+  chThdResumeI(&waitRef, MSG_RESET);
+  osalSysUnlockFromISR();
+
+  OSAL_IRQ_EPILOGUE();
+}
+
 // ---------------------------------------------------------------
 // public stuff for this file
 
 thread_t *logthdp = 0;
 
 void loggerInit(void) {
-  logTimeout = logPeriodicityMS();
+  setRate(settings.logPeriodicity);
+  chSemObjectInit(&pageSem, 1);
+
+  // detect power loss so we can flush page buffer,
+  // PVDO goes high when VDD falls below threshold
+  PWR->CR |= PWR_CR_PLS_LEV7 | PWR_CR_PVDE;
+  EXTI->IMR |= EXTI_IMR_MR16;
+  EXTI->RTSR |= EXTI_RTSR_TR16;
+  nvicEnableVector(PVD_VDDIO2_IRQn, STM32_IRQ_EXTI16_IRQ_PRIORITY);
 }
 
 void loggerStart(void) {
-  logthdp = chThdCreate(&loggerThdDesc);
+  logthdp = addThdAndCreate(&loggerThdDesc);
 }
 
 void loggerSettingsChanged(void) {
-  logTimeout = logPeriodicityMS();
+  // stay at fast or slow rate, a new rate is only logged if it differs
+  if (!settings.logAdaptive)
+    fastRate = false;
+  const uint8_t rate = fastRate ? settings.logFastPeriodicity :
+                                  settings.logPeriodicity;
+  if (rate != logRate)
+    setRate(rate);
 }
 
 void loggerClearAll(usbpkg_t *sndpkg) {
   blockLog = true;// when USB is attached we stop logging
-
-  for(uint32_t i = 0; i < EEPROM_PAGE_SIZE; ++i)
-#if LOG_ALIGNMENT_CHECK
-    buf[i] = i & 0xFF;
-#else
-    buf[i] = 0;
-#endif
-
-  ee24_arg_t arg = {&log_ee, 0, buf, 0, 0, {0, 0}};
-  msg_t msg = MSG_OK;
-
-  const uint32_t lastByte = EEPROM_LOG_SIZE;
-
-  // we also clear offset next in EEPROM
-  for (arg.offset = 0;
-      arg.offset < lastByte && msg == MSG_OK;
-      arg.offset += arg.len)
-  {
-    arg.len = arg.offset + EEPROM_PAGE_SIZE < lastByte ?
-                  EEPROM_PAGE_SIZE : lastByte - arg.offset;
-
-    msg = ee24m01r_write(&arg);
+  chSemWait(&pageSem);
+
+  // start over from the beginning in a new generation, so a host
+  // can tell this log from the one before, pending records are dropped
+  uint32_t gen = (pageSeq & LOG_GEN_MASK) + (1UL << LOG_GEN_SHIFT);
+  if (gen == pageSeq + 1)
+    gen += 1UL << LOG_GEN_SHIFT; // host would take it for a carry
+  msg_t msg = headerWrite(gen);
+  if (msg == MSG_OK) {
+    pageIdx = EEPROM_LOG_PAGES - 1;
+    pageSeq = gen - 1;
+    pageNext();
+    msg = sessionClearAll();
   }
+  if (msg == MSG_OK)
+    msg = logColdStart();
+  if (msg == MSG_OK)
+    msg = pageFlush();
 
-  offsetNext = 0;
-  logColdStart(&arg);
-
+  chSemSignal(&pageSem);
   blockLog = false;
 
   commsSendNowWithCmd(sndpkg, msg == MSG_OK ? commsCmd_OK : commsCmd_Error);
@@ -265,35 +827,14 @@ void loggerReadAll(usbpkg_t *sndpkg)
 {
   blockLog = true; // when USB is attached we stop logging
 
-  // send header with total size about to be transmitted
-  INIT_PKG_HEADER_FRM(*sndpkg, EEPROM_LOG_SIZE - sizeof(offsetNext), offsetNext);
-  usbWaitTransmit(sndpkg);
+  // records still in RAM must be readable too
+  chSemWait(&pageSem);
+  msg_t msg = pageFlush();
+  const uint32_t writePos = (uint32_t)pageIdx * EEPROM_PAGE_SIZE;
+  chSemSignal(&pageSem);
 
-  ee24_arg_t arg = {&log_ee, 0, sndpkg->datafrm.data, 0, 0, {0, 0}};
-  msg_t msg = MSG_OK;
-  static uint32_t pkgId;
-  static const uint32_t logSz = EEPROM_LOG_SIZE - sizeof(offsetNext);
-  static const uint32_t dataSz = sizeof(sndpkg->datafrm.data) /
-                                sizeof(sndpkg->datafrm.data[0]);
-  pkgId = 1;
-
-  for (arg.offset = 0;
-       arg.offset < logSz && msg == MSG_OK;
-       ++pkgId, arg.offset += arg.len)
-  {
-    // -5 is for the header bytes in a data package
-    arg.len = (arg.offset + dataSz < logSz ?
-                  dataSz : logSz - arg.offset);
-
-    // read page into buffer
-    msg = ee24m01r_read(&arg);
-    if (msg != MSG_OK) break;
-
-    // send buffer to host
-    INIT_PKG_DATA_FRM(*sndpkg, pkgId);
-    sndpkg->datafrm.len += arg.len;
-    msg = usbWaitTransmit(sndpkg);
-  }
+  if (msg == MSG_OK)
+    msg = loggerSendPartition(sndpkg, &log_ee, writePos);
 
   INIT_PKG(*sndpkg,
            msg == MSG_OK ? commsCmd_OK : commsCmd_Error,
@@ -302,3 +843,81 @@ void loggerReadAll(usbpkg_t *sndpkg)
 
   blockLog = false;
 }
+
+void loggerReadSince(usbpkg_t *sndpkg, usbpkg_t *rcvpkg)
+{
+  if (rcvpkg->onefrm.len < 7) {
+    commsSendNowWithCmd(sndpkg, commsCmd_Error);
+    return;
+  }
+  const uint32_t hostSeq = fromBE32(rcvpkg->onefrm.data);
+
+  blockLog = true; // when USB is attached we stop logging
+  LogHead_t head;
+  const msg_t msg = logHead(&head);
+
+  uint32_t from = hostSeq;
+  uint8_t flags = 0;
+  if (hostSeq < head.genStart || hostSeq >= head.end) {
+    flags |= LOG_SINCE_NEW_GEN;
+    from = head.genStart;
+  }
+  if (from < head.oldest) {
+    flags |= LOG_SINCE_WRAPPED;
+    from = head.oldest;
+  }
+  sendPages(sndpkg, msg, &head, from, head.end - from, flags);
+
+  blockLog = false;
+}
+
+void loggerReadRange(usbpkg_t *sndpkg, usbpkg_t *rcvpkg)
+{
+  if (rcvpkg->onefrm.len < 11) {
+    commsSendNowWithCmd(sndpkg, commsCmd_Error);
+    return;
+  }
+  uint32_t from = fromBE32(&rcvpkg->onefrm.data[0]),
+           to = fromBE32(&rcvpkg->onefrm.data[4]);
+
+  blockLog = true; // when USB is attached we stop logging
+  LogHead_t head;
+  const msg_t msg = logHead(&head);
+
+  uint8_t flags = 0;
+  if (from < head.oldest) {
+    flags |= LOG_SINCE_WRAPPED;
+    from = head.oldest;
+  }
+  if (to >= head.end)
+    to = head.end - 1;
+  sendPages(sndpkg, msg, &head, from, to >= from ? to - from + 1 : 0, flags);
+
+  blockLog = false;
+}
+
+void loggerReadSessions(usbpkg_t *sndpkg)
+{
+  LogHead_t head;
+  if (logHead(&head) != MSG_OK) {
+    commsSendNowWithCmd(sndpkg, commsCmd_Error);
+    return;
+  }
+  sessionReadAll(sndpkg, head.end);
+}
+
+void loggerWakeup(void) {
+  chThdResume(&waitRef, MSG_OK);
+}
+
+msg_t loggerSendPartition(usbpkg_t *sndpkg, const ee24partition_t *eep,
+                          uint32_t writePos)
+{
+  // send header with total size about to be transmitted
+  msg_t msg = txStart(sndpkg, eep->size, writePos);
+  if (msg == MSG_OK)
+    msg = txEeprom(eep, 0, eep->size);
+  if (msg == MSG_OK)
+    msg = txFlush();
+  return msg;
+}
@@ -15,6 +15,30 @@
 
 //#define LOG_OFFSET_SIZE     sizeof(uint32_t)
 
+// longest time a record may stay in RAM before written to EEPROM
+#ifndef LOGGER_FLUSH_TIMEOUT_MS
+# define LOGGER_FLUSH_TIMEOUT_MS   2000U
+#endif
+
+// after a power fail, VDD is checked this often to see if it came back
+#ifndef LOGGER_PVD_POLL_MS
+# define LOGGER_PVD_POLL_MS        10U
+#endif
+
+// adaptive logging stays at the fast rate this long after braking
+// ended or speed dropped, so a short release doesn't toggle the rate
+#ifndef LOGGER_FAST_HOLD_MS
+# define LOGGER_FAST_HOLD_MS       1000U
+#endif
+
+// log download reads EEPROM in blocks this size, bigger blocks means
+// fewer I2C transfers but costs RAM. Bus time is mostly the data, a page
+// block is only about 5% faster on the bus than a 59 byte one, the rest
+// it saves is driver overhead per transfer, not measured
+#ifndef LOGGER_READ_BLOCK_SIZE
+# define LOGGER_READ_BLOCK_SIZE    EEPROM_PAGE_SIZE
+#endif
+
 typedef enum {
   // use number here to prevent possible mismatch between
   // javascript front end and this firmware
@@ -35,7 +59,7 @@ typedef enum {
   log_slip1 = 10,
   log_slip2 = 11,
   // steering brakes
-  log_accelSteering = 11,
+  log_accelSteering = 12,
   log_wsSteering = 13,
   // accelerometer
   log_accel = 14,
@@ -62,7 +86,100 @@ typedef struct {
   uint8_t buf[log_end * sizeof(LogItem_t)];
 } LogBuf_t;
 
-#if LOGITEMS_CNT * 5 + 1 >= EEPROM_PAGE_SIZE
+/*
+ * Compressed records, first byte tells the kind. Uncompressed LogBuf_t
+ * records start with size which is always below 0x80.
+ * kind, time as varint, mask as varint, one zigzag varint per bit set
+ * in mask, lowest LogType_e first.
+ * keyframe: time is ms since coldstart, mask is all logged items,
+ *           values are absolute
+ * delta:    time is ms since record before, mask is items changed
+ *           since record before, values are the difference
+ * Each page starts with a keyframe so it can be decoded on its own.
+ *
+ * Every record, the coldstart included, is followed by a crc8 of the
+ * record. Each page starts with a sync record holding the page seq, a
+ * reader that hits a broken record skips to the next sync record. A page
+ * whose sync seq differs from the trailer seq is a torn rewrite of an
+ * old page and is skipped as a whole.
+ */
+#define LOG_KIND_KEYFRAME   0x80U
+#define LOG_KIND_DELTA      0x81U
+#define LOG_KIND_SCHEMA     0x82U
+// rate record: kind, log period as SETTINGS_LOG_*. Follows the schema
+// and is written each time adaptive logging changes rate.
+#define LOG_KIND_RATE       0x83U
+#define LOG_RATE_SIZE       2U
+// sync record: kind, seq of page big endian, first in each page
+#define LOG_KIND_SYNC       0x84U
+#define LOG_SYNC_SIZE       5U
+// sizes above are without the crc that follows each record
+#define LOG_CRC_SIZE        1U
+// largest compressed record, 5 bytes is the longest 32bit varint
+#define LOG_RECORD_MAX      (1U + 5U + 3U + LOGITEMS_CNT * 5U)
+
+// stored as data in the coldstart record, tells format of records
+// that follow, 0x5A is uncompressed records only, 0x01 has no time,
+// 0x02 has no schema, 0x03 has no rate records, 0x04 has no record
+// crc and no sync records
+#define LOG_FORMAT_VERSION  0x05U
+
+/*
+ * Schema record follows each coldstart, kind, count, one LogSchemaItem_t
+ * per channel. A host decodes from it and finds a channel by name hash,
+ * so channels can be added or renumbered without breaking old logs.
+ */
+typedef struct {
+  uint8_t type;        // LogType_e as used in records
+  uint8_t format;      // bit 0-1 bytes-1 of value in firmware, LOG_SCHEMA_*
+  uint8_t scale;       // real value is value / (2^(bit 0-3) * 10^(bit 4-7))
+  uint8_t nameHash[2]; // big endian, FNV-1a of name folded to 16 bits
+} LogSchemaItem_t;
+
+#define LOG_SCHEMA_SIGNED    0x04U
+#define LOG_SCALE(pow2, pow10)  ((pow2) | ((pow10) << 4))
+#define LOG_SCHEMA_SIZE      (2U + LOGITEMS_CNT * 5U)
+
+/**
+ * @brief stored last in each log page
+ * Pages are written in order with seq incremented for each new page,
+ * newest page is found at boot from seq. crc covers the page up to crc.
+ */
+typedef struct {
+  uint8_t seq[4]; // big endian page sequence number
+  uint8_t used;   // bytes of records in page, 0 is never a valid page
+  uint8_t crc;    // crc8 of payload and the bytes above
+} LogPageTrailer_t;
+
+#define LOG_PAGE_TRAILER_SIZE  6U
+
+// page seq is generation << LOG_GEN_SHIFT | page number in generation,
+// clearing the log starts a new generation. The page number carries into
+// the generation bits after 2^20 pages, LogHeader_t tells where the
+// generation starts. A clear always leaves a gap in seq before it.
+#define LOG_GEN_SHIFT     20U
+#define LOG_GEN_MASK      (~((1UL << LOG_GEN_SHIFT) - 1))
+
+/**
+ * @brief first in EEPROM, rewritten each time log is cleared
+ * Pages from other generations are left from before the clear. A log
+ * that never was cleared has no header, all its pages are valid.
+ */
+typedef struct {
+  uint8_t magic;       // LOG_HEADER_MAGIC
+  uint8_t genStart[4]; // big endian, seq of first page in generation
+  uint8_t crc;         // crc8 of the bytes above
+} LogHeader_t;
+
+#define LOG_HEADER_SIZE   6U
+#define LOG_HEADER_MAGIC  0x4CU
+
+// first byte of a LogGetSince reply, pages follow
+#define LOG_SINCE_WRAPPED   0x01U // pages host didn't have are overwritten
+#define LOG_SINCE_NEW_GEN   0x02U // host seq is from another generation
+#define LOG_PAGE_PAYLOAD  (EEPROM_PAGE_SIZE - LOG_PAGE_TRAILER_SIZE)
+
+#if LOG_RECORD_MAX > LOG_PAGE_PAYLOAD || LOG_SCHEMA_SIZE > LOG_RECORD_MAX
 # error "Log item size bigger than a page size"
 #endif
 
@@ -74,8 +191,42 @@ void loggerSettingsChanged(void);
 
 void loggerClearAll(usbpkg_t *sndpkg);
 
+/**
+ * @brief wake logger thread early, to write a frozen capture
+ */
+void loggerWakeup(void);
+
+/**
+ * @brief stream a whole EEPROM partition to host, header frame first
+ * Only from comms thread, shares the read buffer with loggerReadAll.
+ * @param writePos sent in header, where next write goes
+ * @returns MSG_OK if all was sent, caller sends the final OK or Error
+ */
+msg_t loggerSendPartition(usbpkg_t *sndpkg, const ee24partition_t *eep,
+                          uint32_t writePos);
+
 void loggerReadAll(usbpkg_t *sndpkg);
 
+/**
+ * @brief send pages written since host seq, newest page the host has
+ * Request data is the seq big endian, 0xFFFFFFFF when host has none.
+ * Reply is LOG_SINCE_* flags and then whole pages oldest first,
+ * host seq page is sent again as it might have got more records.
+ */
+void loggerReadSince(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+/**
+ * @brief send pages from seq to seq, both included, as loggerReadSince
+ * Request data is first and last seq big endian, a session from the
+ * directory is fetched this way. Pages no longer in log are left out.
+ */
+void loggerReadRange(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+/**
+ * @brief send session directory, header holds seq of next log page
+ */
+void loggerReadSessions(usbpkg_t *sndpkg);
+
 
 extern thread_t *logthdp;
 // used to block logging
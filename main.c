@@ -25,8 +25,11 @@
 #include "i2c_bus.h"
 #include "brake_logic.h"
 #include "logger.h"
+#include "capture.h"
+#include "session.h"
 #include "comms.h"
 #include "diag.h"
+#include "profile.h"
 
 
 /*
@@ -47,12 +50,16 @@ int main(void) {
   settingsInit();
   inputsInit();
   loggerInit();
+  captureInit();
+  sessionInit();
   brakeLogicInit();
   accelInit();
   commsInit();
   diagInit();
   // done last of the initializations as main(void) now becomes idle thread
   chSysInit();
+  // only interrupts run now, idle loop laps are as fast as they get
+  profileCalibrate();
 
   // chSysInit must be invoked before any threads are created
   settingsStart();
@@ -67,10 +74,7 @@ int main(void) {
      task but you must never try to sleep or wait in this loop. Note that
      this tasks runs at the lowest priority level so any instruction added
      here will be executed after all other tasks have been started.*/
-  volatile uint32_t idleCnt = 0;
-  while (1) {
-    ++idleCnt;
-  }
+  profileIdle();
 
   return 0;
 }
@@ -0,0 +1,158 @@
+/*
+ * profile.c
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#include "profile.h"
+#include "threads.h"
+#include "i2c_bus.h"
+#include "usbcfg.h"
+#include <hal.h>
+#include <ch.h>
+
+_Static_assert(sizeof(DiagProfilePkg_t) <= wMaxPacketSize - 3,
+               "DiagProfilePkg_t does not fit in a frame");
+
+// from linker script, crt0 fills them with THD_STACK_FILL
+extern uint32_t __main_stack_base__, __main_stack_end__,
+                __process_stack_base__, __process_stack_end__;
+
+#define SYSTICK_MAX  0x00FFFFFFU
+#define IDLE_BURST   250U
+
+// ---------------------------------------------------------------
+// private stuff for this module
+
+static volatile uint32_t idleCnt;
+static uint32_t idlePerTick;  // laps when nothing else runs
+// only touched by brake loop
+static systime_t lastAt;
+static uint32_t lastIdle, windowIdle, windowTicks;
+// set by brake loop, read and cleared by comms
+static volatile uint16_t load, loadMax;
+// each set by its own ISR
+static volatile uint16_t isrCycles[profileIsr_Cnt],
+                         isrLatency[profileIsr_Cnt];
+
+/**
+ * @brief same loop when calibrating as when idle, so the laps compare
+ */
+static inline void idleLaps(void) {
+  for (uint8_t i = 0; i < IDLE_BURST; ++i)
+    ++idleCnt;
+}
+
+static uint16_t sat16(uint32_t vlu) {
+  return vlu > 0xFFFFu ? 0xFFFFu : (uint16_t)vlu;
+}
+
+static void putStack(DiagProfilePkg_t *pkg, uint8_t idx,
+                     const void *wbase, const void *wend)
+{
+  const uint16_t size = (const uint8_t*)wend - (const uint8_t*)wbase,
+                 unused = threadsStackUnused(wbase, wend);
+  TO_BIG_ENDIAN_16(pkg->stacks[idx].size, size);
+  TO_BIG_ENDIAN_16(pkg->stacks[idx].unused, unused);
+}
+
+// ---------------------------------------------------------------
+// public stuff for this module
+
+void profileCalibrate(void) {
+  // OS tick is on TIM14, SysTick is free to run as a cycle counter
+  SysTick->LOAD = SYSTICK_MAX;
+  SysTick->VAL = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+
+  // reading time each burst costs a few laps, load reads a bit low
+  const systime_t start = chVTGetSystemTimeX();
+  sysinterval_t ticks;
+  do {
+    idleLaps();
+    ticks = chTimeDiffX(start, chVTGetSystemTimeX());
+  } while (ticks < TIME_MS2I(PROFILE_CALIB_MS));
+
+  idlePerTick = idleCnt / ticks;
+  lastIdle = idleCnt;
+  lastAt = chVTGetSystemTimeX();
+}
+
+void profileIdle(void) {
+  while (true)
+    idleLaps();
+}
+
+void profileSample(void) {
+  const systime_t now = chVTGetSystemTimeX();
+  const uint32_t idle = idleCnt;
+  windowTicks += chTimeDiffX(lastAt, now);
+  windowIdle += idle - lastIdle;
+  lastAt = now;
+  lastIdle = idle;
+  if (windowTicks < TIME_MS2I(PROFILE_WINDOW_MS))
+    return;
+
+  // laps per permille of the window if it had been all idle
+  const uint32_t perPermille = idlePerTick * windowTicks / 1000;
+  uint32_t idlePermille = perPermille ? windowIdle / perPermille : 1000;
+  if (idlePermille > 1000)
+    idlePermille = 1000;
+  load = 1000 - idlePermille;
+  if (load > loadMax)
+    loadMax = load;
+  windowTicks = windowIdle = 0;
+}
+
+void profileIsr(uint8_t isr, uint32_t start, uint32_t latencyUs) {
+  const uint32_t cycles = (start - SysTick->VAL) & SYSTICK_MAX;
+  if (cycles > isrCycles[isr])
+    isrCycles[isr] = sat16(cycles);
+  if (latencyUs > isrLatency[isr])
+    isrLatency[isr] = sat16(latencyUs);
+}
+
+void profileRead(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
+  DiagProfilePkg_t *pkg = (DiagProfilePkg_t*)sndpkg->onefrm.data;
+
+  TO_BIG_ENDIAN_16(pkg->cpuLoad, load);
+  TO_BIG_ENDIAN_16(pkg->cpuLoadMax, loadMax);
+  pkg->cpuMHz = STM32_HCLK / 1000000U;
+
+  for (uint8_t prio = 0; prio < CH_CFG_MAX_THREADS; ++prio) {
+    const thread_descriptor_t *desc = threadsDesc(prio);
+    if (desc != NULL) {
+      putStack(pkg, prio, desc->wbase, desc->wend);
+    } else {
+      TO_BIG_ENDIAN_16(pkg->stacks[prio].size, 0);
+      TO_BIG_ENDIAN_16(pkg->stacks[prio].unused, 0);
+    }
+  }
+  putStack(pkg, PROFILE_STACK_IDLE,
+           &__process_stack_base__, &__process_stack_end__);
+  putStack(pkg, PROFILE_STACK_ISR,
+           &__main_stack_base__, &__main_stack_end__);
+
+  for (uint8_t i = 0; i < profileIsr_Cnt; ++i) {
+    TO_BIG_ENDIAN_16(pkg->isrs[i].maxCycles, isrCycles[i]);
+    TO_BIG_ENDIAN_16(pkg->isrs[i].maxLatency, isrLatency[i]);
+  }
+
+  TO_BIG_ENDIAN_16(pkg->i2cErrors[0], i2cBusErrors.timeouts);
+  TO_BIG_ENDIAN_16(pkg->i2cErrors[1], i2cBusErrors.busErrors);
+  TO_BIG_ENDIAN_16(pkg->i2cErrors[2], i2cBusErrors.arbLost);
+  TO_BIG_ENDIAN_16(pkg->i2cErrors[3], i2cBusErrors.nacks);
+  TO_BIG_ENDIAN_16(pkg->i2cErrors[4], i2cBusErrors.overruns);
+  sndpkg->onefrm.len += sizeof(DiagProfilePkg_t);
+
+  if (rcvpkg->onefrm.len > 3 && rcvpkg->onefrm.data[0]) {
+    chSysLock();
+    loadMax = 0;
+    for (uint8_t i = 0; i < profileIsr_Cnt; ++i)
+      isrCycles[i] = isrLatency[i] = 0;
+    chSysUnlock();
+  }
+
+  usbWaitTransmit(sndpkg);
+}
@@ -0,0 +1,96 @@
+/*
+ * profile.h
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+#include <hal.h>
+#include "comms.h"
+#include "threads.h"
+
+/*
+ * Runtime profiling, tells how much headroom is left. CPU load is taken
+ * from how many laps the idle loop manages compared to when nothing else
+ * ran at boot. Stack use is read from how much of the fill pattern is
+ * left. ISRs are timed with SysTick, which runs free at core clock.
+ */
+
+// CPU load is the mean over this long
+#ifndef PROFILE_WINDOW_MS
+# define PROFILE_WINDOW_MS   1000U
+#endif
+
+// idle loop is calibrated this long at boot, before threads start
+#ifndef PROFILE_CALIB_MS
+# define PROFILE_CALIB_MS    20U
+#endif
+
+typedef enum {
+  profileIsr_Tim2     = 0, // receiver pulse capture
+  profileIsr_WheelDma = 1, // wheel sensor samples done, any wheel
+  profileIsr_Cnt
+} ProfileIsr_e;
+
+// stacks are sent for each thread by prio, then these
+#define PROFILE_STACK_IDLE  CH_CFG_MAX_THREADS
+#define PROFILE_STACK_ISR   (CH_CFG_MAX_THREADS + 1)
+#define PROFILE_STACK_CNT   (CH_CFG_MAX_THREADS + 2)
+
+/**
+ * @brief response to commsCmd_DiagProfile, all multibyte fields big endian
+ */
+typedef struct __attribute__((__packed__)) {
+  uint8_t cpuLoad[2];       // permille, last window
+  uint8_t cpuLoadMax[2];    // permille, worst window since clear
+  uint8_t cpuMHz;           // clock for cycles below
+  struct {
+    uint8_t size[2];        // bytes, 0 if thread is not created
+    uint8_t unused[2];      // bytes never used
+  } stacks[PROFILE_STACK_CNT];
+  struct {
+    uint8_t maxCycles[2];   // longest run since clear
+    uint8_t maxLatency[2];  // us from event to ISR, in TIM2 steps
+  } isrs[profileIsr_Cnt];
+  uint8_t i2cErrors[5][2];  // as in I2cBusErrors_t
+} DiagProfilePkg_t;
+
+/**
+ * @brief cycle counter to pass to profileIsr, counts down
+ */
+#define PROFILE_CYCLES()  (SysTick->VAL)
+
+/**
+ * @brief start cycle counter and count idle laps with only interrupts
+ *        running, called from main after chSysInit before any thread
+ */
+void profileCalibrate(void);
+
+/**
+ * @brief the idle loop, never returns
+ */
+void profileIdle(void) __attribute__((noreturn));
+
+/**
+ * @brief update CPU load, called from brake loop each lap
+ */
+void profileSample(void);
+
+/**
+ * @brief store run time and latency of an ISR, called last in it
+ * @param start PROFILE_CYCLES() first in ISR
+ * @param latencyUs from the event that caused the ISR
+ */
+void profileIsr(uint8_t isr, uint32_t start, uint32_t latencyUs);
+
+/**
+ * @brief responds with DiagProfilePkg_t
+ * clears max values afterwards if first data byte is set
+ */
+void profileRead(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+#endif /* PROFILE_H_ */
@@ -31,7 +31,30 @@ static PWMConfig pwmcfg = {
 };
 
 
+// frequency running now, duty in percent as last set on each channel
+static uint8_t appliedFreq = 0xFF,
+               appliedActive,   // bit per channel, BrakeN_active applied
+               duties[brakeChEnd + 1];
+
+static uint8_t activeChannels(void) {
+  return (settings.Brake0_active ? 1u << brake0 : 0u) |
+         (settings.Brake1_active ? 1u << brake1 : 0u) |
+         (settings.Brake2_active ? 1u << brake2 : 0u);
+}
+
 static void setPeriod(uint32_t hz, pwmcnt_t initial_period) {
+  // same clock, change period while running and scale widths to it,
+  // a restart would drop brake output until next lap in brake loop
+  if (hz != 0 && PWMD3.state == PWM_READY && pwmcfg.frequency == hz) {
+    pwmcfg.period = initial_period;
+    pwmChangePeriod(&PWMD3, initial_period);
+    for (OutputCh_e ch = breakChStart; ch <= brakeChEnd; ++ch)
+      if (pwmIsChannelEnabledI(&PWMD3, ch))
+        pwmEnableChannel(&PWMD3, ch,
+                         PWM_PERCENTAGE_TO_WIDTH(&PWMD3, duties[ch] * 100));
+    return;
+  }
+
   pwmStop(&PWMD3);
 
   if (hz == 0) return;
@@ -91,6 +114,7 @@ const PwmFrequencies_t pwmoutFrequencies = {
  * @duty in percents
  */
 void pwmoutSetDuty(OutputCh_e ch, uint8_t duty) {
+  duties[ch] = duty;
   if (PWMD3.state != PWM_READY)
     pwmStart(&PWMD3, &pwmcfg);
 
@@ -102,11 +126,21 @@ void pwmoutSetDuty(OutputCh_e ch, uint8_t duty) {
  * @brief called each time settings has changed
  */
 void pwmoutSettingsChanged(void) {
-  if (PWMD3.state == PWM_READY) {
-    for(OutputCh_e ch = breakChStart; ch < brakeChEnd; ++ch)
-      pwmDisableChannel(&PWMD3, ch);
+  // brake loop stops setting a brake turned off, it would keep its duty
+  const uint8_t active = activeChannels(),
+                stopped = appliedActive & ~active;
+  appliedActive = active;
+  if (stopped && PWMD3.state == PWM_READY) {
+    for (OutputCh_e ch = breakChStart; ch <= brakeChEnd; ++ch)
+      if (stopped & (1u << ch))
+        pwmDisableChannel(&PWMD3, ch);
   }
 
+  // nothing else in settings is used here
+  if (settings.PwmFreq == appliedFreq)
+    return;
+  appliedFreq = settings.PwmFreq;
+
   pwmoutSetFrequency(settings.PwmFreq);
 }
 
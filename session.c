@@ -0,0 +1,300 @@
+/*
+ * session.c
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#include "session.h"
+#include "eeprom.h"
+#include "brake_logic.h"
+#include "logger.h"
+#include "settings.h"
+#include "i2c_bus.h"
+#include "crc.h"
+#include "usbcfg.h"
+#include <ch.h>
+#include <string.h>
+
+/*
+ * Memory structure for the directory:
+ * page .. SessionEntry_t, SessionEntry_t, ..., unused
+ * page .. SessionEntry_t, SessionEntry_t, ..., unused
+ * entries never span a page so each write is one write cycle. Entries
+ * are used round robin, the one with highest number is the newest.
+ * Number 0 is never used, a zero filled entry passes the crc.
+ */
+
+_Static_assert(sizeof(SessionEntry_t) == SESSION_ENTRY_SIZE,
+               "SESSION_ENTRY_SIZE is wrong");
+_Static_assert(sizeof(SessionStats_t) == SESSION_STATS_SIZE,
+               "SESSION_STATS_SIZE is wrong");
+
+#define PER_PAGE  (EEPROM_PAGE_SIZE / SESSION_ENTRY_SIZE)
+#define SLOT_CNT  (EEPROM_SESSION_PAGES * PER_PAGE)
+#define TICKS_PER_MS  (CH_CFG_ST_FREQUENCY / 1000)
+
+_Static_assert(SLOT_CNT > 1, "Session region too small");
+
+// ---------------------------------------------------------------
+// private stuff for this module
+
+// guards directory, used from logger and comms thread
+static semaphore_t dirSem;
+static bool scanned, isOpen;
+static uint8_t nextSlot, openSlot,
+               closedSlot = SLOT_CNT; // newest closed, SLOT_CNT if none
+static uint32_t nextNumber = 1,
+                timeBase;       // startTime for next session
+static SessionEntry_t entry;    // the open session
+// only touched by logger thread
+static uint32_t records;
+static uint8_t flags;
+// only touched by brake loop, logger reads them locked at close
+static struct {
+  uint32_t brakeTicks, absTicks;
+  uint16_t maxDecel, maxSlip[3], absCount;
+  uint8_t peakBrake, maxSpeed;
+} stats;
+static systime_t lastAt;
+static uint32_t windowTicks;  // since speed was taken for decel
+static uint8_t windowSpeed;
+static bool wasAbs;
+static ee24_arg_t arg = {&session_ee, 0, NULL, 0, 0, {0, 0}, i2cClient_Logger};
+
+static uint32_t fromBE(const uint8_t *buf) {
+  return (uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 |
+         (uint32_t)buf[2] << 8 | buf[3];
+}
+
+static uint32_t slotOffset(uint8_t slot) {
+  return (uint32_t)(slot / PER_PAGE) * EEPROM_PAGE_SIZE +
+         (slot % PER_PAGE) * SESSION_ENTRY_SIZE;
+}
+
+/**
+ * @brief copy statistics to entry, brake loop must not change them meanwhile
+ */
+static void storeStats(SessionStats_t *st) {
+  chSysLock();
+  TO_BIG_ENDIAN_16(st->maxDecel, stats.maxDecel);
+  for (uint8_t ch = 0; ch < 3; ++ch) {
+    TO_BIG_ENDIAN_16(st->maxSlip[ch], stats.maxSlip[ch]);
+  }
+  TO_BIG_ENDIAN_16(st->absCount, stats.absCount);
+  TO_BIG_ENDIAN_32(st->absMs, stats.absTicks / TICKS_PER_MS);
+  TO_BIG_ENDIAN_32(st->brakeMs, stats.brakeTicks / TICKS_PER_MS);
+  st->peakBrake = stats.peakBrake;
+  st->maxSpeed = stats.maxSpeed;
+  chSysUnlock();
+}
+
+static msg_t writeEntry(uint8_t slot) {
+  entry.crc = crc8((uint8_t*)&entry, sizeof(entry) - 1);
+  arg.offset = slotOffset(slot);
+  arg.buf = (uint8_t*)&entry;
+  arg.len = sizeof(entry);
+  return ee24m01r_write(&arg);
+}
+
+/**
+ * @brief find slot after newest entry, time logged continues from it
+ */
+static msg_t scanDir(void) {
+  SessionEntry_t e;
+  uint32_t newest = 0, newestClosed = 0;
+
+  arg.buf = (uint8_t*)&e;
+  arg.len = sizeof(e);
+  for (uint8_t i = 0; i < SLOT_CNT; ++i) {
+    arg.offset = slotOffset(i);
+    const msg_t msg = ee24m01r_read(&arg);
+    if (msg != MSG_OK)
+      return msg;
+
+    const uint32_t number = fromBE(e.number);
+    if (number == 0 || e.crc != crc8((uint8_t*)&e, sizeof(e) - 1))
+      continue;
+    if ((e.flags & SESSION_CLOSED) && number > newestClosed) {
+      newestClosed = number;
+      closedSlot = i;
+    }
+    if (number < newest)
+      continue;
+    newest = number;
+    nextSlot = (i + 1) % SLOT_CNT;
+    // time of a session that lost power hard is unknown
+    timeBase = fromBE(e.startTime);
+    if (e.flags & SESSION_CLOSED)
+      timeBase += fromBE(e.duration) / 1000;
+  }
+  nextNumber = newest + 1;
+  scanned = true;
+  return MSG_OK;
+}
+
+// ---------------------------------------------------------------
+// public stuff for this module
+
+void sessionInit(void) {
+  chSemObjectInit(&dirSem, 1);
+  lastAt = chVTGetSystemTimeX();
+}
+
+msg_t sessionOpen(uint32_t startSeq) {
+  chSemWait(&dirSem);
+  msg_t msg = scanned ? MSG_OK : scanDir();
+  if (msg == MSG_OK) {
+    memset(&entry, 0, sizeof(entry));
+    TO_BIG_ENDIAN_32(entry.number, nextNumber);
+    TO_BIG_ENDIAN_32(entry.startSeq, startSeq);
+    TO_BIG_ENDIAN_32(entry.startTime, timeBase);
+    openSlot = nextSlot;
+    msg = writeEntry(openSlot);
+    // move on even if write failed, slot might be bad
+    nextSlot = (nextSlot + 1) % SLOT_CNT;
+    ++nextNumber;
+    isOpen = true;
+  }
+  chSemSignal(&dirSem);
+
+  records = 0;
+  flags = 0;
+  // brake loop runs at higher priority, it is never in the middle of a lap
+  chSysLock();
+  memset(&stats, 0, sizeof(stats));
+  lastAt = chVTGetSystemTimeX();
+  chSysUnlock();
+  return msg;
+}
+
+void sessionRecord(void) {
+  ++records;
+  if (values.speedOnGround > 0)
+    flags |= SESSION_MOVED;
+  if (values.brakeForce > 0)
+    flags |= SESSION_BRAKED;
+  for (uint8_t ch = 0; ch < 3; ++ch)
+    if (values.slip[ch] > BRAKE_ABS_SLIP_THRESHOLD)
+      flags |= SESSION_ABS;
+}
+
+void sessionSample(void) {
+  const systime_t now = chVTGetSystemTimeX();
+  const uint32_t dt = chTimeDiffX(lastAt, now);
+  lastAt = now;
+
+  const uint8_t speed = values.speedOnGround;
+  if (speed > stats.maxSpeed)
+    stats.maxSpeed = speed;
+
+  // decel from how much speed dropped over a window
+  windowTicks += dt;
+  if (windowTicks >= TIME_MS2I(SESSION_DECEL_WINDOW_MS)) {
+    if (windowSpeed > speed) {
+      const uint32_t decel = (uint32_t)(windowSpeed - speed) * 1000 *
+                               TICKS_PER_MS / windowTicks;
+      if (decel > stats.maxDecel)
+        stats.maxDecel = decel < 0xFFFF ? decel : 0xFFFF;
+    }
+    windowSpeed = speed;
+    windowTicks = 0;
+  }
+
+  // slip is only calculated while braking
+  const bool braking = values.brakeForce > 0 &&
+                       values.brakeForce >= settings.lower_threshold;
+  bool abs = false;
+  if (braking) {
+    stats.brakeTicks += dt;
+    for (uint8_t ch = 0; ch < 3; ++ch) {
+      if (values.brakeForce_out[ch] > stats.peakBrake)
+        stats.peakBrake = values.brakeForce_out[ch];
+      if (values.slip[ch] > stats.maxSlip[ch])
+        stats.maxSlip[ch] = values.slip[ch];
+      if (values.slip[ch] > BRAKE_ABS_SLIP_THRESHOLD)
+        abs = true;
+    }
+  }
+  if (abs) {
+    stats.absTicks += dt;
+    if (!wasAbs && stats.absCount < 0xFFFF)
+      ++stats.absCount;
+  }
+  wasAbs = abs;
+}
+
+msg_t sessionClose(uint32_t headSeq, uint32_t ms) {
+  msg_t msg = MSG_OK;
+  chSemWait(&dirSem);
+  if (isOpen) {
+    const uint32_t pages = headSeq - fromBE(entry.startSeq) + 1;
+    TO_BIG_ENDIAN_32(entry.duration, ms);
+    TO_BIG_ENDIAN_32(entry.records, records);
+    TO_BIG_ENDIAN_16(entry.pages, pages < 0xFFFF ? pages : 0xFFFF);
+    entry.flags = flags | SESSION_CLOSED;
+    storeStats(&entry.stats);
+    msg = writeEntry(openSlot);
+    if (msg == MSG_OK)
+      closedSlot = openSlot;
+    timeBase += ms / 1000;
+    isOpen = false;
+  }
+  chSemSignal(&dirSem);
+  return msg;
+}
+
+msg_t sessionClearAll(void) {
+  chSemWait(&dirSem);
+  memset(&entry, 0, sizeof(entry));
+  msg_t msg = MSG_OK;
+  for (uint8_t i = 0; i < SLOT_CNT && msg == MSG_OK; ++i) {
+    arg.offset = slotOffset(i);
+    arg.buf = (uint8_t*)&entry;
+    arg.len = sizeof(entry);
+    msg = ee24m01r_write(&arg);
+  }
+  // time and numbers count from the clear, as after a reboot
+  nextSlot = 0;
+  closedSlot = SLOT_CNT;
+  nextNumber = 1;
+  timeBase = 0;
+  scanned = true;
+  isOpen = false;
+  chSemSignal(&dirSem);
+  return msg;
+}
+
+void sessionReadAll(usbpkg_t *sndpkg, uint32_t headSeq) {
+  chSemWait(&dirSem);
+  const msg_t msg = loggerSendPartition(sndpkg, &session_ee, headSeq);
+  chSemSignal(&dirSem);
+
+  INIT_PKG(*sndpkg,
+           msg == MSG_OK ? commsCmd_OK : commsCmd_Error,
+           sndpkg->onefrm.reqId);
+  usbWaitTransmit(sndpkg);
+}
+
+void sessionReadStats(usbpkg_t *sndpkg) {
+  SessionEntry_t e;
+  chSemWait(&dirSem);
+  msg_t msg = scanned ? MSG_OK : scanDir();
+  if (msg == MSG_OK && closedSlot < SLOT_CNT) {
+    arg.offset = slotOffset(closedSlot);
+    arg.buf = (uint8_t*)&e;
+    arg.len = sizeof(e);
+    msg = ee24m01r_read(&arg);
+  } else if (msg == MSG_OK) {
+    msg = MSG_RESET; // no session closed yet
+  }
+  chSemSignal(&dirSem);
+
+  if (msg != MSG_OK || e.crc != crc8((uint8_t*)&e, sizeof(e) - 1)) {
+    commsSendNowWithCmd(sndpkg, commsCmd_Error);
+    return;
+  }
+  for (uint8_t i = 0; i < sizeof(e); ++i)
+    PKG_PUSH(*sndpkg, ((uint8_t*)&e)[i]);
+  commsSendNowWithCmd(sndpkg, commsCmd_OK);
+}
@@ -0,0 +1,113 @@
+/*
+ * session.h
+ *
+ *  Created on: 19 okt. 2026
+ *      Author: agent
+ */
+
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <stdint.h>
+#include "comms.h"
+#include <chtypes.h>
+
+/*
+ * Session directory. Each coldstart opens a session, an entry telling
+ * where in the log it starts is written to the session region in EEPROM.
+ * At power fail the entry is rewritten with length, records and summary
+ * flags. A host lists the directory and fetches a single session with
+ * LogGetRange instead of the whole log.
+ */
+
+// pages in EEPROM for the directory, taken from the log
+#ifndef EEPROM_SESSION_PAGES
+# define EEPROM_SESSION_PAGES  4U
+#endif
+
+// summary flags
+#define SESSION_CLOSED   0x01U // closed at power fail, all fields valid
+#define SESSION_MOVED    0x02U // speed on ground was above 0
+#define SESSION_BRAKED   0x04U // brake force was requested
+#define SESSION_ABS      0x08U // slip went above ABS threshold
+
+// speed drop is measured over this long when looking for max decel
+#ifndef SESSION_DECEL_WINDOW_MS
+# define SESSION_DECEL_WINDOW_MS  100U
+#endif
+
+/**
+ * @brief summary of a session, taken each lap in brake loop
+ * all multibyte fields big endian, 0 while session is open
+ */
+typedef struct {
+  uint8_t maxDecel[2];    // revs/sec per sec, speed on ground
+  uint8_t maxSlip[3][2];  // permille, each wheel
+  uint8_t absCount[2];    // times ABS started to release a brake
+  uint8_t absMs[4];       // ms ABS released some brake
+  uint8_t brakeMs[4];     // ms brake force was above lower threshold
+  uint8_t peakBrake;      // max brake force out, any wheel
+  uint8_t maxSpeed;       // max speed on ground, revs/sec
+} SessionStats_t;
+
+#define SESSION_STATS_SIZE  20U
+
+/**
+ * @brief one session in directory, all multibyte fields big endian
+ * crc covers the entry up to crc
+ */
+typedef struct {
+  uint8_t number[4];    // increments for each session
+  uint8_t startSeq[4];  // seq of log page with the coldstart
+  uint8_t startTime[4]; // s logged before this session, all sessions
+  uint8_t duration[4];  // ms logged, 0 while open
+  uint8_t records[4];   // records logged, 0 while open
+  uint8_t pages[2];     // log pages used, 0 while open
+  uint8_t flags;        // SESSION_*
+  SessionStats_t stats;
+  uint8_t crc;
+} SessionEntry_t;
+
+#define SESSION_ENTRY_SIZE  44U
+
+void sessionInit(void);
+
+/**
+ * @brief write entry for a new session, called by logger after coldstart
+ */
+msg_t sessionOpen(uint32_t startSeq);
+
+/**
+ * @brief count a logged record, summary flags are taken from values
+ */
+void sessionRecord(void);
+
+/**
+ * @brief update statistics, called from brake loop each lap
+ */
+void sessionSample(void);
+
+/**
+ * @brief rewrite entry with length and summary, called at power fail
+ * @param headSeq seq of the last page with records in this session
+ * @param ms time logged in this session
+ */
+msg_t sessionClose(uint32_t headSeq, uint32_t ms);
+
+/**
+ * @brief forget all sessions, log is cleared
+ */
+msg_t sessionClearAll(void);
+
+/**
+ * @brief send whole directory to host, writePos in header is head seq
+ */
+void sessionReadAll(usbpkg_t *sndpkg, uint32_t headSeq);
+
+/**
+ * @brief send entry of the newest closed session in one frame,
+ *        Error if there is none
+ */
+void sessionReadStats(usbpkg_t *sndpkg);
+
+#endif /* SESSION_H_ */
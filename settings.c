@@ -10,15 +10,17 @@
 #include "settings.h"
 #include "pwmout.h"
 #include "eeprom.h"
+#include "i2c_bus.h"
 #include "accelerometer.h"
 #include "inputs.h"
 #include "brake_logic.h"
 #include "logger.h"
 #include "usbcfg.h"
 #include "threads.h"
+#include "crc.h"
 
 // this version should be bumped on each breaking ABI change to EEPROM storage
-#define STORAGE_VERSION 0x01
+#define STORAGE_VERSION 0x02
 
 #define SETTINGS_SIZE   (sizeof(Settings_t) - sizeof(settings.header))
 
@@ -30,75 +32,184 @@
 
 // private stuff to this module
 static thread_t *settingsp = 0;
-thread_reference_t saveThdRef;
+// thread also runs long comms commands, it wakes for either
+static semaphore_t wakeSem;
+static volatile bool saveWanted, saving;
+// changes from host are not saved while tuning
+static bool tuning;
 
 static ee24_arg_t eeArg = {
-  &settings_ee, 0, NULL, 0, 0, {0, 0}
+  &settings_ee, 0, NULL, 0, 0, {0, 0}, i2cClient_Settings
 };
 
+// both slots as read at boot, the next save goes to slots[nextSlot]
+static Settings_slot_t slots[2];
+static uint8_t nextSlot = 0;
+
 /**
- * @brief notify other modules about the changes
+ * @brief where a field is in Settings_t, field id is index in fields
  */
-static void notify(void) {
-  pwmoutSettingsChanged();
-  accelSettingsChanged();
-  inputsSettingsChanged();
-  brakeLogicSettingsChanged();
-  loggerSettingsChanged();
-}
+typedef struct {
+  uint8_t nameHash[2]; // big endian, FNV-1a of name folded to 16 bits
+  uint8_t offset;      // byte in Settings_t
+  uint8_t shift: 4,    // first bit in byte
+          bits: 4;
+  uint8_t max;
+  uint8_t notify;      // SETTINGS_NOTIFY_*
+} SettingsField_t;
+
+// name hashes must match keys in ConfigBase in frontend,
+// append new fields last, ids are in the USB protocol
+// PWM outputs and brake logic both depend on which brakes are active
+#define BRAKE_ACTIVE_NOTIFY  (SETTINGS_NOTIFY_PWM | SETTINGS_NOTIFY_BRAKE)
+#define FIELD(hash, offset, shift, bits, max, notify) \
+  {{(hash) >> 8, (hash) & 0xFF}, offset, shift, bits, max, notify}
+static const SettingsField_t fields[] = {
+  FIELD(0xF4B1,  4, 0, 8, 100, 0), // lower_threshold
+  FIELD(0xF6BA,  5, 0, 8, 100, 0), // upper_threshold
+  FIELD(0xC49A,  6, 0, 8, 100, 0), // max_brake_force
+  FIELD(0x7855,  7, 0, 8, 100, 0), // ws_steering_brake_authority
+  FIELD(0x694B,  8, 0, 8, 100, 0), // acc_steering_brake_authority
+  FIELD(0x59AB,  9, 0, 1, 1,   0), // reverse_input
+  FIELD(0x9DF4,  9, 1, 1, 1,   0), // ABS_active
+  FIELD(0x33C9,  9, 2, 3, freqHighest, SETTINGS_NOTIFY_PWM), // PwmFreq
+  FIELD(0x2B83,  9, 5, 1, 1,   BRAKE_ACTIVE_NOTIFY), // Brake0_active
+  FIELD(0x36DF,  9, 6, 1, 1,   BRAKE_ACTIVE_NOTIFY), // Brake1_active
+  FIELD(0x4F2B,  9, 7, 1, 1,   BRAKE_ACTIVE_NOTIFY), // Brake2_active
+  FIELD(0x5E8B, 10, 0, 2, 2,   SETTINGS_NOTIFY_BRAKE), // Brake0_dir
+  FIELD(0x901B, 10, 2, 2, 2,   SETTINGS_NOTIFY_BRAKE), // Brake1_dir
+  FIELD(0x7CAC, 10, 4, 2, 2,   SETTINGS_NOTIFY_BRAKE), // Brake2_dir
+  FIELD(0xA972, 10, 6, 2, 2,   0), // accelerometer_axis
+  FIELD(0xFD43, 11, 0, 1, 1,   SETTINGS_NOTIFY_ACCEL), // accelerometer_active
+  FIELD(0x912F, 11, 1, 1, 1,   0), // accelerometer_axis_invert
+  FIELD(0x5BEA, 11, 2, 1, 1,   0), // dontLogWhenStill
+  FIELD(0x4CDD, 11, 3, 3, 7,   SETTINGS_NOTIFY_LOGGER), // logPeriodicity
+  FIELD(0x1AF5, 12, 0, 8, 255, SETTINGS_NOTIFY_INPUTS), // WheelSensor0_pulses_per_rev
+  FIELD(0x62B8, 13, 0, 8, 255, SETTINGS_NOTIFY_INPUTS), // WheelSensor1_pulses_per_rev
+  FIELD(0x1508, 14, 0, 8, 255, SETTINGS_NOTIFY_INPUTS), // WheelSensor2_pulses_per_rev
+  FIELD(0xFD17, 15, 0, 3, 7,   SETTINGS_NOTIFY_LOGGER), // logFastPeriodicity
+  FIELD(0x02F2, 15, 3, 1, 1,   SETTINGS_NOTIFY_LOGGER), // logAdaptive
+  FIELD(0x93E5, 16, 0, 8, 255, 0), // logFastSpeed
+};
+#define FIELD_CNT  (sizeof(fields) / sizeof(fields[0]))
 
+_Static_assert(sizeof(Settings_t) == 17, "Update fields to Settings_t");
 
 /**
- * @brief load settings from EEPROM memory
+ * @brief notify other modules about the changes
+ * @param mask SETTINGS_NOTIFY_* of modules that use a changed value
  */
-static msg_t settingsLoad(void) {
-  Settings_header_t header;
-  msg_t res;
-
-  do {
-    eeArg.offset = 0;
-    eeArg.buf = (uint8_t*)&header;
-    eeArg.len = sizeof(Settings_header_t);
-    res = ee24m01r_read(&eeArg);
+static void notify(uint8_t mask) {
+  if (mask & SETTINGS_NOTIFY_PWM)
+    pwmoutSettingsChanged();
+  if (mask & SETTINGS_NOTIFY_ACCEL)
+    accelSettingsChanged();
+  if (mask & SETTINGS_NOTIFY_INPUTS)
+    inputsSettingsChanged();
+  if (mask & SETTINGS_NOTIFY_BRAKE)
+    brakeLogicSettingsChanged();
+  if (mask & SETTINGS_NOTIFY_LOGGER)
+    loggerSettingsChanged();
+}
 
-    if (res != MSG_OK) break;
+/**
+ * @brief host has changed settings, save them unless tuning
+ */
+static void hostChanged(uint8_t mask) {
+  notify(mask);
+  if (!tuning)
+    settingsSave();
+}
 
-     // ensure header version match with STORAGE_VERSION
-    // if not bail out
-    if (!VALIDATE_HEADER(header)) {
-      res = MSG_RESET;
-      break;
-    }
+static uint8_t fieldGet(const SettingsField_t *f) {
+  const uint8_t byte = ((const uint8_t*)&settings)[f->offset];
+  return (byte >> f->shift) & ((1U << f->bits) - 1);
+}
 
-    eeArg.buf = (uint8_t*)&settings;
-    eeArg.len = sizeof(settings);
-    res = ee24m01r_read(&eeArg);
+/**
+ * @brief set field, byte is written at once as brake loop might read it
+ */
+static void fieldSet(const SettingsField_t *f, uint8_t vlu) {
+  uint8_t *byte = &((uint8_t*)&settings)[f->offset];
+  const uint8_t mask = ((1U << f->bits) - 1) << f->shift;
+  *byte = (*byte & ~mask) | ((vlu << f->shift) & mask);
+}
 
-  } while(false);
+static bool slotValid(const Settings_slot_t *slot) {
+  return VALIDATE_HEADER(slot->settings.header) &&
+         slot->crc == crc8((const uint8_t*)slot, sizeof(*slot) - 1);
+}
 
+/**
+ * @brief load newest valid settings slot from EEPROM memory
+ */
+static msg_t settingsLoad(void) {
+  // slots are next to each other, read both at once
+  eeArg.offset = 0;
+  eeArg.buf = (uint8_t*)slots;
+  eeArg.len = sizeof(slots);
+  msg_t res = ee24m01r_read(&eeArg);
+  if (res != MSG_OK)
+    return res;
+
+  const bool validA = slotValid(&slots[0]),
+             validB = slotValid(&slots[1]);
+  if (!validA && !validB)
+    return MSG_RESET;
+
+  // generation wraps, newest is the one ahead of the other
+  uint8_t newest = validB;
+  if (validA && validB)
+    newest = (int8_t)(slots[1].generation - slots[0].generation) > 0;
+
+  settings = slots[newest].settings;
+  nextSlot = newest ^ 1;
+  return MSG_OK;
+}
 
+/**
+ * @brief save settings to the slot not holding the newest settings
+ * The newest slot is left untouched, if we loose power during write
+ * the crc fails and we load the previous settings at next boot.
+ */
+static msg_t settingsCommit(void) {
+  Settings_slot_t *slot = &slots[nextSlot];
+  slot->generation = slots[nextSlot ^ 1].generation + 1;
+  slot->settings = settings;
+  slot->crc = crc8((const uint8_t*)slot, sizeof(*slot) - 1);
+
+  eeArg.offset = nextSlot * sizeof(Settings_slot_t);
+  eeArg.buf = (uint8_t*)slot;
+  eeArg.len = sizeof(*slot);
+  msg_t res = ee24m01r_write(&eeArg);
+  if (res == MSG_OK)
+    nextSlot ^= 1;
   return res;
 }
 
-static THD_WORKING_AREA(waSettingsThd, 128);
+// sized for the log transfers it runs for comms
+static THD_WORKING_AREA(waSettingsThd, 196 + EE24M01R_STACK_USE);
 static THD_FUNCTION(SettingsThd, arg) {
   (void)arg;
 
   // load values from EEPROM
   settingsLoad();
   // notify subscribers that settings has loaded
-  notify();
+  notify(SETTINGS_NOTIFY_ALL);
 
   while(true) {
-    chThdSuspendTimeoutS(&saveThdRef, TIME_INFINITE);
-
-    // save values to EEPROM when we wakeup
-    settingsValidateValues();
-    eeArg.offset = 0;
-    eeArg.len = sizeof(settings);
-    eeArg.buf = (uint8_t*)&settings;
-    ee24m01r_write(&eeArg);
-    notify();
+    chSemWait(&wakeSem);
+
+    // save values to EEPROM when asked to, modules are already
+    // notified by the one who changed them
+    if (saveWanted) {
+      saveWanted = false;
+      saving = true;
+      settingsValidateValues();
+      settingsCommit();
+      saving = false;
+    }
+    commsRunJob();
   }
 }
 
@@ -143,14 +254,18 @@ Settings_t settings = {
   0,
   0,
   0, // WheelSensor2_pulses_per_rev
+  SETTINGS_LOG_40MS,
+  1,
+  20, // logFastSpeed
 };
 
 void settingsInit(void) {
+  chSemObjectInit(&wakeSem, 0);
   settingsDefault();
 }
 
 void settingsStart(void) {
-  settingsp = chThdCreate(&settingsThdDesc);
+  settingsp = addThdAndCreate(&settingsThdDesc);
 }
 
 void settingsDefault(void) {
@@ -175,11 +290,18 @@ void settingsDefault(void) {
   settings.accelerometer_axis = 0;
   settings.accelerometer_axis_invert = 0;
   settings.logPeriodicity = SETTINGS_LOG_2560MS;
+  settings.logFastPeriodicity = SETTINGS_LOG_40MS;
+  settings.logAdaptive = 1;
+  settings.logFastSpeed = 20;
 }
 
 void settingsSave(void) {
-  if (saveThdRef)
-    chThdResume(&saveThdRef, MSG_OK);
+  saveWanted = true;
+  chSemSignal(&wakeSem);
+}
+
+void settingsWakeWorker(void) {
+  chSemSignal(&wakeSem);
 }
 
 void settingsGetAll(usbpkg_t *sndpkg)
@@ -211,10 +333,7 @@ void settingsSetAll(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
 
     settingsValidateValues();
 
-    // save settings
-    settingsSave();
-
-    notify();
+    hostChanged(SETTINGS_NOTIFY_ALL);
 
     // all ok
     res = commsCmd_OK;
@@ -224,6 +343,102 @@ void settingsSetAll(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
   commsSendNowWithCmd(sndpkg, res);
 }
 
+void settingsFieldInfo(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
+  uint8_t id = rcvpkg->onefrm.len > 3 ? rcvpkg->onefrm.data[0] : 0;
+  for (; id < FIELD_CNT && sndpkg->onefrm.len + 5 <= wMaxPacketSize; ++id) {
+    PKG_PUSH(*sndpkg, id);
+    PKG_PUSH(*sndpkg, fields[id].nameHash[0]);
+    PKG_PUSH(*sndpkg, fields[id].nameHash[1]);
+    PKG_PUSH(*sndpkg, fields[id].max);
+    PKG_PUSH(*sndpkg, fields[id].notify);
+  }
+  usbWaitTransmit(sndpkg);
+}
+
+void settingsGetFields(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
+  const uint8_t cnt = rcvpkg->onefrm.len - 3;
+  // reply must fit in one frame
+  if (cnt * 3 > sizeof(sndpkg->onefrm.data)) {
+    commsSendNowWithCmd(sndpkg, commsCmd_Error);
+    return;
+  }
+  for (uint8_t i = 0; i < cnt; ++i) {
+    const uint8_t id = rcvpkg->onefrm.data[i];
+    if (id >= FIELD_CNT) {
+      commsSendNowWithCmd(sndpkg, commsCmd_Error);
+      return;
+    }
+    PKG_PUSH(*sndpkg, id);
+    PKG_PUSH(*sndpkg, 1);
+    PKG_PUSH(*sndpkg, fieldGet(&fields[id]));
+  }
+  usbWaitTransmit(sndpkg);
+}
+
+void settingsSetFields(usbpkg_t *sndpkg, usbpkg_t *rcvpkg) {
+  const uint8_t *data = rcvpkg->onefrm.data,
+                len = rcvpkg->onefrm.len - 3;
+  uint8_t pos;
+
+  // check all before any is set, all fields are 1 byte so far
+  for (pos = 0; pos + 3 <= len; pos += 3) {
+    if (data[pos] >= FIELD_CNT || data[pos + 1] != 1 ||
+        data[pos + 2] > fields[data[pos]].max)
+    {
+      break;
+    }
+  }
+  if (pos != len || len == 0) {
+    commsSendNowWithCmd(sndpkg, commsCmd_Error);
+    return;
+  }
+
+  uint8_t mask = 0;
+  bool changed = false;
+  for (pos = 0; pos < len; pos += 3) {
+    const SettingsField_t *f = &fields[data[pos]];
+    if (fieldGet(f) == data[pos + 2])
+      continue;
+    fieldSet(f, data[pos + 2]);
+    mask |= f->notify;
+    changed = true;
+  }
+  if (changed) {
+    // a change might put another field out of its window
+    settingsValidateValues();
+    hostChanged(mask);
+  }
+
+  commsSendNowWithCmd(sndpkg, commsCmd_OK);
+}
+
+void settingsTune(usbpkg_t *sndpkg) {
+  tuning = true;
+  commsSendNowWithCmd(sndpkg, commsCmd_OK);
+}
+
+void settingsTuneCommit(usbpkg_t *sndpkg) {
+  tuning = false;
+  settingsSave();
+  commsSendNowWithCmd(sndpkg, commsCmd_OK);
+}
+
+void settingsTuneRevert(usbpkg_t *sndpkg) {
+  // a save in progress holds what EEPROM will have, keep those
+  if (!saveWanted && !saving) {
+    // newest slot, defaults if none was valid
+    const Settings_slot_t *stored = &slots[nextSlot ^ 1];
+    if (slotValid(stored))
+      settings = stored->settings;
+    else
+      settingsDefault();
+  }
+  tuning = false;
+  // modules only restart what differs from the tuned values
+  notify(SETTINGS_NOTIFY_ALL);
+  commsSendNowWithCmd(sndpkg, commsCmd_OK);
+}
+
 /**
  * @brief ensures values are within allowed window (before save)
  */
@@ -246,6 +461,8 @@ void settingsValidateValues(void) {
     settings.Brake2_dir = 0;
   if (settings.Brake2_dir > 2)
     settings.Brake2_dir = 0;
+  if (settings.logFastPeriodicity > settings.logPeriodicity)
+    settings.logFastPeriodicity = settings.logPeriodicity;
   if (settings.accelerometer_axis > 2) {
     // error, turn off
     settings.accelerometer_axis = 0;
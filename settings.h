@@ -30,6 +30,14 @@
 #define SETTINGS_LOG_1280MS         6U
 #define SETTINGS_LOG_2560MS         7U
 
+/* Modules told when a field changes, as in field info to host */
+#define SETTINGS_NOTIFY_PWM         0x01U
+#define SETTINGS_NOTIFY_INPUTS      0x02U
+#define SETTINGS_NOTIFY_ACCEL       0x04U
+#define SETTINGS_NOTIFY_BRAKE       0x08U
+#define SETTINGS_NOTIFY_LOGGER      0x10U
+#define SETTINGS_NOTIFY_ALL         0x1FU
+
 typedef struct __attribute__((__packed__)) {
     // which version of memory storage in EEPROM
     // version should be bumped on each ABI breaking change
@@ -97,8 +105,29 @@ typedef struct __attribute__((__packed__)) {
   uint8_t WheelSensor1_pulses_per_rev;
   uint8_t WheelSensor2_pulses_per_rev;
 
+  // next byte
+  // how often we log while braking or fast, logPeriodicity is used
+  // the rest of the time
+  uint8_t logFastPeriodicity: 3;
+  // 0=always log at logPeriodicity
+  uint8_t logAdaptive: 1;
+  // log fast above this speed on ground, revs/sec, 0 only when braking
+  uint8_t logFastSpeed;
+
 } Settings_t;
 
+/**
+ * @brief settings as stored in EEPROM, there are 2 slots which are
+ *        written every other time, the newest valid one is loaded
+ */
+typedef struct __attribute__((__packed__)) {
+  Settings_t settings;
+  // incremented on each save, wraps around
+  uint8_t generation;
+  // crc8 of all bytes above
+  uint8_t crc;
+} Settings_slot_t;
+
 extern Settings_t settings;
 
 /**
@@ -121,9 +150,54 @@ void settingsDefault(void);
  */
 void settingsSave(void);
 
+/**
+ * @brief wake settings thread to run a job handed over by comms
+ */
+void settingsWakeWorker(void);
+
 void settingsGetAll(usbpkg_t *sndpkg);
 void settingsSetAll(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
 
+/*
+ * Fields are read and written one by one by field id, so a host can
+ * change a single value without sending all of Settings_t. Ids never
+ * change, a host finds the field it wants by name hash in field info.
+ */
+
+/**
+ * @brief reply id, nameHash[2], max, notify for each field from the id
+ *        in data[0], as many as fit, none when past the last field
+ */
+void settingsFieldInfo(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+/**
+ * @brief data is field ids, reply id, len, value for each of them
+ */
+void settingsGetFields(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+/**
+ * @brief data is id, len, value for each field to set
+ * Nothing is set unless all are valid, only modules that use a changed
+ * field are notified.
+ */
+void settingsSetFields(usbpkg_t *sndpkg, usbpkg_t *rcvpkg);
+
+/**
+ * @brief start tuning, changes from host are used at once but are not
+ *        saved to EEPROM until commit, a reboot reverts them
+ */
+void settingsTune(usbpkg_t *sndpkg);
+
+/**
+ * @brief save settings as tuned to EEPROM and stop tuning
+ */
+void settingsTuneCommit(usbpkg_t *sndpkg);
+
+/**
+ * @brief go back to settings in EEPROM and stop tuning
+ */
+void settingsTuneRevert(usbpkg_t *sndpkg);
+
 /**
  * @brief ensures values are within allowed window (before save)
  */
@@ -11,30 +11,50 @@
 
 // ----------------------------------------------------------------
 // Private stuff to this module
-/*
-static thread_descriptor_t idleThdDesc = {
-  .name  = "idle",
-  .wbase = NULL,//&__main_thread_stack_base__,
-  .wend  = NULL, //&__main_thread_stack_end__,
-  .prio  = CH_CFG_MAX_THREADS,
-  .funcp = NULL,
-  .arg  = NULL
-};*/
+
+// indexed by prio
+static const thread_descriptor_t *thdDescs[CH_CFG_MAX_THREADS];
+
+#if CH_CFG_ST_FREQUENCY % 1000 != 0
+# error "Uptime needs a systick that is a multiple of 1kHz"
+#endif
+#define TICKS_PER_MS  (CH_CFG_ST_FREQUENCY / 1000)
+
+static uint32_t uptimeMs;
+static systime_t uptimeAt;  // systime uptimeMs is counted up to
 
 // ----------------------------------------------------------------
 // public stuff to this module
 
-// save in RAM to be able to fill threads on init
-//const thread_descriptor_t __attribute__((section(".ram0")))
-//      nil_thd_configs[CH_CFG_MAX_THREADS + 1] = {0};
-
-/*thread_t *addThdAndCreate(thread_descriptor_t *thdDesc) {
-  thread_descriptor_t *thd =
-       (thread_descriptor_t*)&nil_thd_configs[thdDesc->prio];
-  thd->name = thdDesc->name;
-  thd->wbase = thdDesc->wbase;
-  thd->wend = thdDesc->wend;
-  thd->prio = thdDesc->prio;
-  thd->arg = thdDesc->arg;
+thread_t *addThdAndCreate(const thread_descriptor_t *thdDesc) {
+  for (uint32_t *p = (uint32_t*)thdDesc->wbase;
+       p < (uint32_t*)thdDesc->wend; ++p)
+  {
+    *p = THD_STACK_FILL;
+  }
+  thdDescs[thdDesc->prio] = thdDesc;
   return chThdCreate(thdDesc);
-}*/
+}
+
+const thread_descriptor_t *threadsDesc(uint8_t prio) {
+  return prio < CH_CFG_MAX_THREADS ? thdDescs[prio] : NULL;
+}
+
+uint16_t threadsStackUnused(const void *wbase, const void *wend) {
+  // stacks grow downwards, the deepest use ever is the first changed word
+  const uint32_t *p = (const uint32_t*)wbase;
+  while (p < (const uint32_t*)wend && *p == THD_STACK_FILL)
+    ++p;
+  return (uint16_t)((const uint8_t*)p - (const uint8_t*)wbase);
+}
+
+uint32_t threadsUptimeMs(void) {
+  chSysLock();
+  const uint32_t ms = chTimeDiffX(uptimeAt, chVTGetSystemTimeX()) /
+                        TICKS_PER_MS;
+  uptimeAt = chTimeAddX(uptimeAt, ms * TICKS_PER_MS);
+  uptimeMs += ms;
+  const uint32_t now = uptimeMs;
+  chSysUnlock();
+  return now;
+}
@@ -24,14 +24,30 @@
 #define PRIO_USB_CDC_THD        3
 #define PRIO_SETTINGS_I2C_THD   4
 
-//extern const thread_descriptor_t nil_thd_configs[];
+// unused stack is filled with this, same as crt0 fills main and
+// process stacks with, words still holding it have never been used
+#define THD_STACK_FILL          0x55555555U
 
+/**
+ * @brief fill stack of thdDesc, remember it and create the thread
+ * Must be called after chSysInit, thdDesc must stay valid
+ */
+thread_t *addThdAndCreate(const thread_descriptor_t *thdDesc);
+
+/**
+ * @brief descriptor of thread with prio, NULL if not created
+ */
+const thread_descriptor_t *threadsDesc(uint8_t prio);
 
 /**
- * @brief add thdDesc to thdDesc table
- * Must be called before chSysInit
- *//*
-thread_t *addThdAndCreate(thread_descriptor_t *thdDesc);
-*/
+ * @brief bytes at bottom of stack that have never been used
+ */
+uint16_t threadsStackUnused(const void *wbase, const void *wend);
+
+/**
+ * @brief ms since boot, does not wrap every 6.5s as systime_t does
+ * Must be called more often than systime_t wraps, brake loop does that
+ */
+uint32_t threadsUptimeMs(void);
 
 #endif /* THREADS_H_ */
@@ -30,10 +30,27 @@
 // ----------------------------------------------------------------------
 // private to this file
 static usbpkg_t *rcvpkg = NULL,
-                *sndpkg = NULL,
                 rcvbuf;
 static thread_reference_t waitThdp = NULL;
 
+// IN packets, txbuf[txHead] is on the wire while the next is prepared
+static usbpkg_t txbuf[2];
+static uint8_t txHead, txCnt;
+static thread_reference_t txThdp = NULL;
+// comms and settings thread both send, only one may wait on txThdp
+static SEMAPHORE_DECL(txSem, 1);
+
+/**
+ * @brief drop queued packets and wake sender, USB is gone
+ * A packet still on the wire after a suspend stays counted until it is
+ * transmitted, a reset or unconfigure has already aborted it.
+ * @iclass
+ */
+static void txResetI(void) {
+  txCnt = usbGetTransmitStatusI(&USBD1, USBD1_DATA_REQUEST_EP) ? 1 : 0;
+  chThdResumeI(&txThdp, MSG_RESET);
+}
+
 /**
  * @brief   Default data received callback.
  * @details The application must use this function as callback for the OUT
@@ -73,13 +90,16 @@ static void dataReceived(USBDriver *usbp, usbep_t ep) {
  * @param[in] ep        IN endpoint number
  */
 static void dataTransmitted(USBDriver *usbp, usbep_t ep) {
-  (void)usbp;
-  (void)ep;
-
   osalSysLockFromISR();
 
-  if (waitThdp != NULL)
-    chThdResumeI(&waitThdp, MSG_OK);
+  if (txCnt > 0) {
+    txHead ^= 1;
+    // next packet is already in RAM, start it without waiting for SOF
+    if (--txCnt > 0)
+      usbStartTransmitI(usbp, ep, txbuf[txHead].u8buf,
+                        txbuf[txHead].onefrm.len);
+  }
+  chThdResumeI(&txThdp, MSG_OK);
 
   osalSysUnlockFromISR();
 }
@@ -392,6 +412,7 @@ static void usb_event(USBDriver *usbp, usbevent_t event) {
 
     /* Disconnection event on suspend.*/
     //sduSuspendHookI(&SDU1);
+    txResetI();
 
     chSysUnlockFromISR();
     return;
@@ -424,11 +445,6 @@ static void sof_handler(USBDriver *usbp) {
 
   osalSysLockFromISR();
   //sduSOFHookI(&SDU1);
-  if (sndpkg) {
-    usbStartTransmitI(usbp, USBD1_DATA_REQUEST_EP,
-                      sndpkg->u8buf, sndpkg->onefrm.len);
-    sndpkg = NULL;
-  }
   osalSysUnlockFromISR();
 }
 
@@ -459,21 +475,70 @@ msg_t usbWaitRecieve(usbpkg_t *pkg) {
   return msg;
 }
 
-msg_t usbWaitTransmit(usbpkg_t *pkg) {
-  msg_t msg;
+/**
+ * @brief copy pkg to the free buffer, start it if endpoint is idle
+ * @sclass
+ */
+static void txPutS(const usbpkg_t *pkg) {
+  // ISR never touches the free buffer
+  usbpkg_t *buf = &txbuf[(txHead + txCnt) & 1];
+  memcpy(buf->u8buf, pkg->u8buf, pkg->onefrm.len);
+  if (txCnt++ == 0 && !usbGetTransmitStatusI(&USBD1, USBD1_DATA_REQUEST_EP))
+    usbStartTransmitI(&USBD1, USBD1_DATA_REQUEST_EP,
+                      buf->u8buf, buf->onefrm.len);
+}
 
-  if (usbGetDriverStateI(&USBD1) != USB_ACTIVE) {
-    return MSG_RESET;
-  } else if (sndpkg != NULL) {
-    return MSG_RESET;
-  }
+/**
+ * @brief as usbQueueTransmit, caller holds txSem
+ */
+static msg_t txQueue(usbpkg_t *pkg) {
+  msg_t msg = MSG_OK;
 
   osalSysLock();
-  sndpkg = pkg;
+  // both buffers taken, wait for the one on the wire
+  while (txCnt == 2 && msg == MSG_OK)
+    msg = osalThreadSuspendS(&txThdp);
+  if (usbGetDriverStateI(&USBD1) != USB_ACTIVE)
+    msg = MSG_RESET;
+
+  if (msg == MSG_OK)
+    txPutS(pkg);
+  osalSysUnlock();
+
+  return msg;
+}
+
+msg_t usbQueueTransmit(usbpkg_t *pkg) {
+  chSemWait(&txSem);
+  const msg_t msg = txQueue(pkg);
+  chSemSignal(&txSem);
+  return msg;
+}
+
+msg_t usbTryTransmit(usbpkg_t *pkg) {
+  msg_t msg = MSG_OK;
+
+  osalSysLock();
+  if (usbGetDriverStateI(&USBD1) != USB_ACTIVE)
+    msg = MSG_RESET;
+  else if (txCnt == 2)
+    msg = MSG_TIMEOUT;
+  else
+    txPutS(pkg);
+  osalSysUnlock();
+
+  return msg;
+}
+
+msg_t usbWaitTransmit(usbpkg_t *pkg) {
+  chSemWait(&txSem);
+  msg_t msg = txQueue(pkg);
+
+  osalSysLock();
+  while (txCnt > 0 && msg == MSG_OK)
+    msg = osalThreadSuspendS(&txThdp);
   osalSysUnlock();
-  // send when USB host requests a flush (sofHandler)
-  //usbStartTransmitI(&USBD1, USBD1_DATA_REQUEST_EP, pkg->u8buf, pkg->onefrm.len);
-  msg = osalThreadSuspendS(&waitThdp);
 
+  chSemSignal(&txSem);
   return msg;
 }
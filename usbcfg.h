@@ -25,8 +25,24 @@ extern const USBConfig usbcfg;
 
 msg_t usbWaitRecieve(usbpkg_t *pkg);
 
+/**
+ * @brief send pkg and wait until it and all queued before it are sent
+ */
 msg_t usbWaitTransmit(usbpkg_t *pkg);
 
+/**
+ * @brief copy pkg to a free IN buffer and return, it is sent as soon
+ *        as the one before is, so the next can be prepared meanwhile
+ * Blocks only while both buffers are taken.
+ */
+msg_t usbQueueTransmit(usbpkg_t *pkg);
+
+/**
+ * @brief as usbQueueTransmit but never blocks
+ * @returns MSG_TIMEOUT if both buffers are taken, pkg is not sent
+ */
+msg_t usbTryTransmit(usbpkg_t *pkg);
+
 #endif  /* USBCFG_H */
 
 /** @} */
@@ -72,16 +72,36 @@ class CommunicationBase {
         SettingsSetDefault:  0x07,
         SettingsSaveAll:     0x08,
         SettingsGetAll:      0x09,
+        SettingsFieldInfo:   0x0A,
+        SettingsGetFields:   0x0B,
+        SettingsSetFields:   0x0C,
+        SettingsTune:        0x0D,
+        SettingsCommit:      0x0E,
+        SettingsRevert:      0x0F,
         LogGetAll:           0x10,
         LogClearAll:         0x11,
+        CaptureGetAll:       0x12,
+        LogGetSince:         0x13,
+        LogSessions:         0x14,
+        LogGetRange:         0x15,
+        LogSessionStats:     0x16,
         DiagReadAll:         0x18,
         DiagSetVlu:          0x19,
         DiagClearVlu:        0x1A,
+        DiagI2cStats:        0x1B,
+        DiagSubscribe:       0x1C,
+        DiagStream:          0x1D,
+        Batch:               0x1E,
+        DiagProfile:         0x1F,
         Version:             0x20,
         FwHash:              0x21,
+        JobStatus:           0x22,
+        JobCancel:           0x23,
         OK:                  0x7F,
     }
     static IDError = 0xFF;
+    // must match COMMS_VERSION in comms.c
+    static CommsVersion = 0x0D;
     static progress = new ProgressSend();
     static _mutex = new Mutex();
 
@@ -92,6 +112,11 @@ class CommunicationBase {
 
 
     device = null;
+    // from refreshDeviceInfo at each connect, pages read it instead of
+    // asking device again when they first show
+    deviceInfo = null;
+    // from fetchSettingsFields, false if device can't set single fields
+    settingsFields = null;
     //oep = null;
     //iep = null;
     onConnect = null;
@@ -99,6 +124,12 @@ class CommunicationBase {
     _unlock = null;
     _reqId = 0;
     _opened = false;
+    // read past the frame we wanted, kept for next read
+    _unusedBytes = new Uint8Array(0);
+    // called with each pushed diag snapshot, null when not subscribed
+    _streamCb = null;
+    // reqIds of cancelJob, the replies are dropped when they show up
+    _sideIds = new Set();
 
     errorLog = console.error;
     infoLog = console.info;
@@ -172,6 +203,20 @@ class CommunicationBase {
         await this.device.selectAlternateInterface(this.interfaceNumber, 0);
 */
 
+        // might be another device or firmware now
+        this.settingsFields = null;
+
+        // what the UI needs at start, one round trip when batched
+        try {
+          const version = (await this.refreshDeviceInfo()).version;
+          if (version && version[0] !== CommunicationBase.CommsVersion)
+            this.errorLog(`Device talks protocol ${version[0]}, ` +
+                          `expected ${CommunicationBase.CommsVersion}`);
+        } catch(e) {
+          this.deviceInfo = null;
+          this.errorLog("Could not read device info", e);
+        }
+
         // notify that we are connected (outside of try block)
         this.onConnect.emit();
         return true;
@@ -204,6 +249,8 @@ class CommunicationBase {
           this.device.close();
         } catch (e) { /* squeslh */ }
         this._opened = false;
+        this._unusedBytes = new Uint8Array(0);
+        this._streamCb = null;
 
         this.device = null;
 
@@ -281,6 +328,65 @@ class CommunicationBase {
         return rcvd;
     }
 
+    /**
+     * @brief send several requests in one frame, device replies with a
+     *        Batch frame holding the count and then to each in turn
+     * @param {Array} requests [{cmd, byteArr}], single frame replies only
+     * @returns array of replies with header bytes, in request order,
+     *          false if device doesn't know Batch
+     */
+    async talkBatch(requests) {
+        if (!this.isOpen())
+            if (!await this.openDevice()) return false;
+
+        const subs = [];
+        for (const {cmd, byteArr} of requests)
+            subs.push(2 + (byteArr?.length || 0), cmd, ...(byteArr || []));
+        if (subs.length + 3 > this.packetSize) {
+            this.errorLog(`batch to long, ${subs.length} bytes`);
+            return false;
+        }
+        const id = this._getId(),
+              data = new Uint8Array([subs.length + 3,
+                                     CommunicationBase.Cmds.Batch, id, ...subs]);
+
+        const unlock = this._unlock = await CommunicationBase._mutex.lock();
+        if (!this.device)
+          return false;
+
+        const replies = [];
+        let ok = false;
+        if (await this._send(data)) {
+            const reader = this.device.readable.getReader();
+            try {
+                // firmware before batching replies with a single Error
+                let cnt = -1;
+                while (cnt !== replies.length) {
+                    const buf = await this._readPage(reader);
+                    if (buf[1] === CommunicationBase.Cmds.DiagStream) {
+                        this._streamArrived(buf);
+                        continue;
+                    }
+                    this._validateResponse(buf, id);
+                    if (cnt > -1)
+                        replies.push(Array.from(buf));
+                    else if (buf[1] === CommunicationBase.Cmds.Batch)
+                        cnt = buf[3];
+                    else
+                        break;
+                }
+                ok = cnt === requests.length;
+            } catch(e) {
+                this.errorLog("Error during recieve from device", e);
+            } finally {
+                reader.releaseLock();
+            }
+        }
+
+        this._unlock = unlock();
+        return ok ? replies : false;
+    }
+
     /**
      * @brief talkSafe wraps talk() with a try catch
      * @param {*} param0
@@ -329,46 +435,63 @@ class CommunicationBase {
         return res;
     }
 
+    /**
+     * @brief chops up recive into pages based on len prop in recived
+     * Bytes read past the page are kept for next call, pushed frames
+     * might follow right after a reply.
+     */
+    async _readPage(reader) {
+        let pageLen = 0, buf = new Uint8Array();
+
+        // previously fetched more than that page needed, reuse now
+        if (this._unusedBytes.length) {
+          pageLen = this._unusedBytes[0];
+          buf = this._unusedBytes.slice(0, pageLen);
+          this._unusedBytes = this._unusedBytes.slice(pageLen);
+        }
+
+        while (pageLen < 1 || buf.byteLength < pageLen) {
+          const {value, done} = await reader.read();
+          if (done)
+            throw new Error("Port error");
+          else if (pageLen === 0)
+            pageLen = value[0];
+
+          const end = pageLen - buf.byteLength;
+          buf = new Uint8Array([
+            ...buf,
+            ...value.slice(0, end)]);
+          this._unusedBytes = value.slice(end);
+        } // might get a fraction, not a whole frame
+        return buf;
+    }
+
+    /**
+     * @brief hand a pushed diag snapshot to subscriber, if any
+     */
+    _streamArrived(buf) {
+        if (this._streamCb && buf.byteLength > 3)
+            this._streamCb(buf.slice(3));
+    }
+
     async _recieve(id) {
         // recieve from device
         let rcvd = [], multibyte = false, buf,
-            reader = this.device.readable.getReader(),
-            unusedBytes = new Uint8Array(0);
-
-        // chops up recive into pages based on len prop in recived
-        const readPage = async ()=> {
-          let pageLen = 0, tail = 0
-              buf = new Uint8Array();
-
-          // previously fetched more than that page needed, reuse now
-          if (unusedBytes.length) {
-            pageLen = unusedBytes[0];
-            buf = unusedBytes.slice(0, pageLen);
-            unusedBytes = unusedBytes.slice(pageLen);
-          }
-
-          if (pageLen < 1 || buf.byteLength < pageLen) {
-            do {
-              const {value, done} = await reader.read();
-              if (done)
-                throw new Error("Port error");
-              else if (pageLen === 0)
-                pageLen = value[0];
-
-              const end = pageLen - buf.byteLength;
-              buf = new Uint8Array([
-                ...buf,
-                ...value.slice(0, end)]);
-              unusedBytes = value.slice(end);
-            } while(buf.byteLength < pageLen); // might get a fraction, not a whole frame
-          }
-          return buf;
-        }
+            reader = this.device.readable.getReader();
+        const streamCmd = CommunicationBase.Cmds.DiagStream;
+        let aside;
 
         try {
             do {
                 // handle single and multiframe in this loop
-                buf = await readPage();
+                buf = await this._readPage(reader);
+                // pushed snapshots and the reply to cancelJob might come
+                // between frames of a reply
+                aside = buf[1] === streamCmd || this._sideIds.delete(buf[2]);
+                if (buf[1] === streamCmd)
+                    this._streamArrived(buf);
+                if (aside)
+                    continue;
                 this._validateResponse(buf, id);
 
                 // multi frame response
@@ -382,7 +505,7 @@ class CommunicationBase {
                     rcvd = rcvd.concat(Array.from(buf));
                 }
 
-            } while (buf[1] & 0x80); // expects a OK or error cmd to finish response
+            } while ((buf[1] & 0x80) || aside); // expects a OK or error cmd to finish response
 
             if (!multibyte) // if not multibyte, store the result
                 rcvd = rcvd.concat(Array.from(buf));
@@ -501,6 +624,101 @@ class Communication_v1 extends CommunicationBase {
         });
     }
 
+    /**
+     * @brief ask device which settings fields it has, cached until
+     *        next connect
+     * @returns [{id, hash, max, notify}] or false if device can't
+     */
+    async fetchSettingsFields() {
+        if (this.settingsFields !== null)
+            return this.settingsFields;
+        const fields = [];
+        let res;
+        do {
+            res = await this.talkSafe({
+                cmd: CommunicationBase.Cmds.SettingsFieldInfo,
+                byteArr: new Uint8Array([fields.length]),
+                includeHeader: true
+            });
+            if (!res || res[1] !== CommunicationBase.Cmds.SettingsFieldInfo)
+                return this.settingsFields = false;
+            for (let i = 3; i + 5 <= res.length; i += 5)
+                fields.push({id: res[i], hash: (res[i+1] << 8) | res[i+2],
+                             max: res[i+3], notify: res[i+4]});
+        } while (res.length > 3);
+        return this.settingsFields = fields;
+    }
+
+    /**
+     * @brief set settings fields, only modules using them are restarted
+     * @param {Array} fields [{id, vlu}], sent in as many frames as needed
+     * @returns true if all were set
+     */
+    async setSettingsFields(fields) {
+        const perFrame = Math.floor((this.packetSize - 3) / 3);
+        for (let i = 0; i < fields.length; i += perFrame) {
+            const byteArr = new Uint8Array(fields.slice(i, i + perFrame)
+                .flatMap(f=>[f.id, 1, f.vlu]));
+            if (!await this.talkSafe({
+                cmd: CommunicationBase.Cmds.SettingsSetFields,
+                expectedResponseCmd: CommunicationBase.Cmds.OK,
+                byteArr}))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief start live tune, settings changed after this are used by
+     *        device at once but not saved until commitSettings
+     * @returns true/false depending on success
+     */
+    async tuneSettings() {
+        return await this.talkSafe({
+            cmd: CommunicationBase.Cmds.SettingsTune,
+            expectedResponseCmd: CommunicationBase.Cmds.OK
+        });
+    }
+
+    /**
+     * @brief save tuned settings to device EEPROM and end live tune
+     * @returns true/false depending on success
+     */
+    async commitSettings() {
+        return await this.talkSafe({
+            cmd: CommunicationBase.Cmds.SettingsCommit,
+            expectedResponseCmd: CommunicationBase.Cmds.OK
+        });
+    }
+
+    /**
+     * @brief throw away tuned settings, device goes back to those
+     *        saved in EEPROM and ends live tune
+     * @returns true/false depending on success
+     */
+    async revertSettings() {
+        return await this.talkSafe({
+            cmd: CommunicationBase.Cmds.SettingsRevert,
+            expectedResponseCmd: CommunicationBase.Cmds.OK
+        });
+    }
+
+    /**
+     * @brief stop a log or capture transfer in progress, sent beside it
+     *        without waiting for it, the transfer then ends with Error
+     * @returns true if sent
+     */
+    async cancelJob() {
+        if (!this.device || !this._unlock)
+            return false;
+        const id = this._getId();
+        this._sideIds.add(id);
+        return await this._send(new Uint8Array([
+            3, CommunicationBase.Cmds.JobCancel, id]));
+    }
+
     /**
      * @breif clears all logg enties in device EEPROM
      * @returns true/false depending on success
@@ -530,12 +748,160 @@ class Communication_v1 extends CommunicationBase {
         }
     }
 
+    /**
+     * @brief reads log pages written since seq from the device
+     * @param {Number} seq newest page we have, LogRoot.NoSeq if none
+     * @returns same as readLog, data is flags and pages for
+     *          LogRoot.mergePages
+     */
+    async readLogSince(seq) {
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.LogGetSince,
+            byteArr: new Uint8Array([(seq >>> 24) & 0xFF, (seq >> 16) & 0xFF,
+                                     (seq >> 8) & 0xFF, seq & 0xFF]),
+            includeHeader: true
+        });
+        const okCmd = CommunicationBase.Cmds.OK;
+        return {
+            ok: res?.length > 13 ? res[res.length -2] == okCmd : false,
+            totalSize: res?.length > 13 ? this.toInt(res.slice(5, 9)) : 0,
+            logNextAddr: res?.length > 13 ? this.toInt(res.slice(9, 13)) : 0,
+            data: res?.length > 13 ? new Uint8Array(res.slice(13, res.length -3)) : []
+        }
+    }
+
+    /**
+     * @brief reads log pages from seq from to seq to, both included
+     * @returns same as readLogSince, used to fetch a single session
+     */
+    async readLogRange(from, to) {
+        const be32 = (n)=>[(n >>> 24) & 0xFF, (n >> 16) & 0xFF,
+                           (n >> 8) & 0xFF, n & 0xFF];
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.LogGetRange,
+            byteArr: new Uint8Array([...be32(from), ...be32(to)]),
+            includeHeader: true
+        });
+        const okCmd = CommunicationBase.Cmds.OK;
+        return {
+            ok: res?.length > 13 ? res[res.length -2] == okCmd : false,
+            data: res?.length > 13 ? new Uint8Array(res.slice(13, res.length -3)) : []
+        }
+    }
+
+    /**
+     * @brief reads the session directory from the device
+     * @returns {ok, sessions} sessions as from SessionRoot.parse
+     */
+    async readSessions() {
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.LogSessions,
+            includeHeader: true
+        });
+        const okCmd = CommunicationBase.Cmds.OK;
+        const ok = res?.length > 13 ? res[res.length -2] == okCmd : false;
+        // write position in header is seq of next log page
+        return {
+            ok,
+            sessions: ok ? SessionRoot.parse(
+                new Uint8Array(res.slice(13, res.length -3)),
+                this.toInt(res.slice(9, 13)) >>> 0) : []
+        }
+    }
+
+    /**
+     * @brief reads the newest closed session, with its statistics
+     * @returns a session as in SessionRoot.parse, undefined on error
+     */
+    async readSessionStats() {
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.LogSessionStats,
+            includeHeader: true
+        });
+        if (res?.[1] !== CommunicationBase.Cmds.OK ||
+            res.length < 3 + SessionRoot.EntrySize)
+        {
+            return undefined;
+        }
+        return SessionRoot.parse(new Uint8Array(
+            [...res.slice(3, 3 + SessionRoot.EntrySize),
+             ...new Uint8Array(LogRoot.PageSize - SessionRoot.EntrySize)]))[0];
+    }
+
+    /**
+     * @brief reads the brake event capture region from the device
+     * @returns {ok, captures} captures as from CaptureRoot.parse
+     */
+    async readCaptures() {
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.CaptureGetAll,
+            includeHeader: true
+        });
+        const okCmd = CommunicationBase.Cmds.OK;
+        const ok = res?.length > 13 ? res[res.length -2] == okCmd : false;
+        return {
+            ok,
+            captures: ok ? CaptureRoot.parse(
+                new Uint8Array(res.slice(13, res.length -3))) : []
+        }
+    }
+
     async poolDiagData() {
         return await this.talkSafe({
             cmd: CommunicationBase.Cmds.DiagReadAll,
         });
     }
 
+    /**
+     * @brief have device push diag snapshots instead of polling
+     * @param {Number} periodMs time between snapshots, 0 stops,
+     *                 device keeps it within 5 - 5000 ms
+     * @param {Function} callback gets data of each DiagStream frame
+     * @returns true if device accepted
+     */
+    async subscribeDiag(periodMs, callback = null) {
+        // stop dispatching first, a snapshot may come before the reply
+        if (periodMs < 1)
+            this._streamCb = null;
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.DiagSubscribe,
+            expectedResponseCmd: CommunicationBase.Cmds.OK,
+            byteArr: new Uint8Array([(periodMs >> 8) & 0xFF, periodMs & 0xFF])
+        });
+        if (res && periodMs > 0) {
+            const running = this._streamCb !== null;
+            this._streamCb = callback;
+            if (!running) this._pumpStream();
+        }
+        return res;
+    }
+
+    /**
+     * @brief read pushed snapshots while no request is in progress
+     * Holds the port one frame at a time, requests get in between.
+     */
+    async _pumpStream() {
+        while (this._streamCb) {
+            const unlock = this._unlock = await CommunicationBase._mutex.lock();
+            if (!this._streamCb || !this.device) {
+                this._unlock = unlock();
+                break;
+            }
+            const reader = this.device.readable.getReader();
+            try {
+                const buf = await this._readPage(reader);
+                if (buf[1] === CommunicationBase.Cmds.DiagStream)
+                    this._streamArrived(buf);
+            } catch(e) {
+                this.errorLog("Error during diag stream", e);
+                this._streamCb = null;
+            } finally {
+                reader.releaseLock();
+                this._unlock = unlock();
+            }
+        }
+    }
+
     async setDiagVlu(byteArr) {
         return await this.talkSafe({
             cmd: CommunicationBase.Cmds.DiagSetVlu,
@@ -552,6 +918,95 @@ class Communication_v1 extends CommunicationBase {
         });
     }
 
+    /**
+     * @brief fetch I2C bus latency statistics, times in microseconds
+     * @param clear reset statistics in device after read
+     * @returns {accel, settings, logger, comms} each with
+     *          {jobs, errors, avgWait, maxWait, maxHold} or false
+     */
+    async fetchI2cStats(clear = false) {
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.DiagI2cStats,
+            byteArr: new Uint8Array([clear ? 1 : 0])
+        });
+        if (!res?.length) return false;
+
+        const stats = {};
+        ['accel', 'settings', 'logger', 'comms'].forEach((client, i)=>{
+            const u16 = (pos)=>this.toInt(res.slice(i * 10 + pos, i * 10 + pos + 2));
+            stats[client] = {
+                jobs: u16(0), errors: u16(2), avgWait: u16(4),
+                maxWait: u16(6), maxHold: u16(8)
+            };
+        });
+        return stats;
+    }
+
+    /**
+     * @brief fetch CPU load, stack use, ISR timing and I2C errors
+     * @param clear reset max values in device after read
+     * @returns {cpuLoad, cpuLoadMax, stacks, isrs, i2cErrors} or false,
+     *          load in percent, stacks [{name, size, unused}] in bytes,
+     *          isrs [{name, maxUs, maxLatency}] in microseconds
+     */
+    async fetchProfile(clear = false) {
+        const res = await this.talkSafe({
+            cmd: CommunicationBase.Cmds.DiagProfile,
+            byteArr: new Uint8Array([clear ? 1 : 0])
+        });
+        if (!res?.length) return false;
+
+        const u16 = (pos)=>this.toInt(res.slice(pos, pos + 2)),
+              mhz = res[4] || 1;
+        const stacks = ['brake', 'accel', 'logger', 'comms', 'settings',
+                        'idle', 'isr'].map((name, i)=>{
+            return {name, size: u16(5 + i * 4), unused: u16(7 + i * 4)};
+        });
+        let pos = 5 + stacks.length * 4;
+        const isrs = ['tim2', 'wheelDma'].map((name, i)=>{
+            return {name, maxUs: u16(pos + i * 4) / mhz,
+                    maxLatency: u16(pos + i * 4 + 2)};
+        });
+        pos += isrs.length * 4;
+        const i2cErrors = {};
+        ['timeouts', 'busErrors', 'arbLost', 'nacks', 'overruns']
+            .forEach((key, i)=>i2cErrors[key] = u16(pos + i * 2));
+
+        return {cpuLoad: u16(0) / 10, cpuLoadMax: u16(2) / 10,
+                stacks, isrs, i2cErrors};
+    }
+
+    /**
+     * @brief fetch ping, version, firmware hash, settings and diag
+     *        values in one batch, one by one if device can't batch
+     * @returns {pong, version, fwHash, settings, diag} as the single
+     *          request functions return them, also in this.deviceInfo
+     *          where pages find them at connect
+     */
+    async refreshDeviceInfo() {
+        const C = CommunicationBase.Cmds;
+        const replies = await this.talkBatch([
+            {cmd: C.Ping}, {cmd: C.Version}, {cmd: C.FwHash},
+            {cmd: C.SettingsGetAll}, {cmd: C.DiagReadAll}]);
+        if (!replies) {
+            return this.deviceInfo = {
+                pong: await this.sendPing(),
+                version: await this.getVersion(),
+                fwHash: await this.fetchFirmwareHash(),
+                settings: await this.getAllSettings(),
+                diag: await this.poolDiagData()
+            };
+        }
+        const data = (i)=>replies[i][1] !== C.Error && replies[i].slice(3);
+        return this.deviceInfo = {
+            pong: replies[0][1] === C.Pong,
+            version: data(1),
+            fwHash: data(2) && data(2).map(n=>String.fromCharCode(n)).join(''),
+            settings: data(3),
+            diag: data(4)
+        };
+    }
+
     async fetchFirmwareHash() {
       const byteArr =  await this.talkSafe({
         cmd: CommunicationBase.Cmds.FwHash,
@@ -3,6 +3,8 @@
 class ConfigBase {
   static ConfigVersions = [];
   static _instance = null;
+  // values as last read from or written to device, by key
+  static _synced = null;
 
   static PwmFreqOptions = {
     off: 0,
@@ -60,6 +62,35 @@ class ConfigBase {
     }
   }
 
+  /**
+   * @brief remember current values as those in device
+   */
+  static markSynced() {
+    const instance = ConfigBase.instance();
+    ConfigBase._synced = new Map(instance._keys().map(k=>[k, instance[k]]));
+  }
+
+  /**
+   * @brief values changed since markSynced, all if never synced
+   * @param fields as from Communication.fetchSettingsFields
+   * @returns [{id, vlu}] for fields the device has
+   */
+  changedFields(fields) {
+    const byHash = new Map(fields.map(f=>[f.hash, f]));
+    const res = [];
+    for (const key of this._keys()) {
+      const field = byHash.get(LogSchema.nameHash(key));
+      if (!field || ConfigBase._synced?.get(key) === this[key])
+        continue;
+      res.push({id: field.id, vlu: Number(this[key])});
+    }
+    return res;
+  }
+
+  _keys() {
+    return Object.keys(this).filter(k=>k !== 'header');
+  }
+
   header = {
     // which version of memory storage in EEPROM
     // version should be bumped on each ABI breaking change
@@ -235,3 +266,39 @@ class Config_v1 extends ConfigBase {
   }
 }
 ConfigBase.ConfigVersions.push(Config_v1);
+
+class Config_v2 extends Config_v1 {
+  header = {
+    storageVersion: 0x02,
+    size: 17 - 4
+  }
+
+  // log at logFastPeriodicity while braking or fast
+  logFastPeriodicity = ConfigBase.LogPeriodicity.Log_40ms; /*uint8_t : 3;*/
+  // 0 = always log at logPeriodicity
+  logAdaptive = true; /*uint8_t : 1;*/
+  // log fast above this speed on ground, 0 only when braking
+  logFastSpeed = 20; /*uint8_t;*/
+
+  _serialize(byteArr) {
+    super._serialize(byteArr);
+    let idx = 15;
+    // bit field byte 15th
+    let byteVlu  = (this.logFastPeriodicity & 0x07) << 0;
+    byteVlu |= (this.logAdaptive ? 1 : 0) << 3;
+    byteArr[idx++] = byteVlu;
+    byteArr[idx++] = this.logFastSpeed;
+
+    return byteArr;
+  }
+
+  _deserialize(byteArr) {
+    super._deserialize(byteArr);
+    let idx = 15;
+    const byteVlu = byteArr[idx++];
+    this.logFastPeriodicity = byteVlu & 0x07;
+    this.logAdaptive = Boolean(byteVlu & 0x08);
+    this.logFastSpeed = byteArr[idx++];
+  }
+}
+ConfigBase.ConfigVersions.push(Config_v2);
@@ -189,8 +189,13 @@
 
         info: (type) => {
             let min = 0, max = 0, mid = 0, groups = [], bytes = 1;
-            const t = ItemBase.Types;
-            if (type >= t.speedOnGround && type <= t.wheelRPS_2) {
+            const t = ItemBase.Types, extra = ItemBase.ExtraTypes[type];
+            if (extra) {
+                max = Math.pow(2, extra.bytes * 8 - (extra.signed ? 1 : 0)) /
+                        extra.divisor;
+                min = extra.signed ? -max : 0;
+                bytes = extra.bytes;
+            } else if (type >= t.speedOnGround && type <= t.wheelRPS_2) {
                 max = 255;
                 groups = [t.speedOnGround,t.wheelRPS_0,
                           t.wheelRPS_1,t.wheelRPS_2];
@@ -217,6 +222,10 @@
 
     }
 
+    // items from a log schema that aren't in Types, keyed by type
+    // {hash, bytes, signed, divisor}, see LogSchema in logger.js
+    static ExtraTypes = {};
+
     static FloatTypes = [
         // are uint16_t
        // ItemBase.Types.slip0, ItemBase.Types.slip1, ItemBase.Types.slip2
@@ -417,12 +426,20 @@
         case ItemBase.Types.wsSteering:
             return Math.round(this.value *100) / 100;
         default:
+            const extra = ItemBase.ExtraTypes[this.type];
+            if (extra)
+                return Math.round(this.value / extra.divisor *100) / 100;
             return this.value;
         }
     }
 
     translatedType(lang = document.documentElement.lang) {
         const keys = Object.keys(ItemBase.TypesTranslated).slice(1);
+        const extra = ItemBase.ExtraTypes[this.type];
+        if (extra) {
+            const name = `0x${extra.hash.toString(16).padStart(4, "0")}`;
+            return {txt: name, title: name};
+        }
         const tr = ItemBase.TypesTranslated[keys[this.type]] ||
                      ItemBase.TypesTranslated.invalid;
         return {txt: tr.txt[lang], title: tr.title[lang]};
@@ -118,22 +118,44 @@ class DiagnoseBase {
   onRefresh = null;
 
   freq = 0;
+  // pushed snapshots, lost are seq gaps, dropped is what device counted
+  streamStats = {received: 0, lost: 0, dropped: 0};
 
   _fetchTmr = null;
   _poolInFlight = false;
+  _streaming = false;
+  _streamSeq = -1;
 
   static instance() {
-    if (!DiagnoseBase._instance)
+    if (!DiagnoseBase._instance) {
         DiagnoseBase._instance = new DiagnoseBase.DiagnoseBaseVersions[
           DiagnoseBase.DiagnoseBaseVersions.length - 1
         ];
+        // device might have connected before diag was first used
+        DiagnoseBase._instance._deviceInfoArrived(CommunicationBase.instance());
+    }
     return DiagnoseBase._instance;
   }
 
-  constructor(logsize = 30) {
+  constructor(logsize = 100) {
     this.onRefresh = new EventDispatcher(this);
     this.logsize = logsize;
     this.logPoints = [];
+
+    // values read at connect show before any polling starts
+    const comms = CommunicationBase.instance();
+    comms.onConnect.subscribe(this, ()=>this._deviceInfoArrived(comms));
+  }
+
+  _deviceInfoArrived(comms) {
+    const data = comms.deviceInfo?.diag;
+    if (!(data?.length > 3)) return;
+    try {
+      this._refreshDataArrived(Array.from(data));
+      this.onRefresh.emit();
+    } catch(e) {
+      console.error(e);
+    }
   }
 
   /**
@@ -149,13 +171,25 @@ class DiagnoseBase {
       this._fetchTmr = null;
       this._poolInFlight = false;
     }
+    const comms = CommunicationBase.instance();
+    if (this._streaming) {
+      this._streaming = false;
+      if (comms.isOpen())
+        await comms.subscribeDiag(0);
+    }
 
     if (freq > 0) {
-      const comms = CommunicationBase.instance();
-
       if (!comms.isOpen() && !(await comms.openDevice()))
         return false;
 
+      // device pushes snapshots, poll if firmware is too old for that
+      this.streamStats = {received: 0, lost: 0, dropped: 0};
+      this._streamSeq = -1;
+      this._streaming = await comms.subscribeDiag(
+        Math.round(1000 / freq), this._streamArrived.bind(this));
+      if (this._streaming)
+        return true;
+
       this._fetchTmr = setInterval(async ()=>{
         if (this._poolInFlight)
           return;
@@ -225,6 +259,26 @@ class DiagnoseBase {
     return await CommunicationBase.instance().clearDiagVlu(sndPkg);
   }
 
+  /**
+   * @brief a pushed DiagStream frame, seq, timeMs and dropped
+   *        precedes the same values as DiagReadAll replies with
+   */
+  _streamArrived(data) {
+    if (!this._streaming || data.length < 9) return;
+    const seq = data[0] << 8 | data[1];
+    if (this._streamSeq > -1)
+      this.streamStats.lost += (seq - this._streamSeq - 1) & 0xFFFF;
+    this._streamSeq = seq;
+    this.streamStats.dropped = data[6] << 8 | data[7];
+    ++this.streamStats.received;
+    try {
+      this._refreshDataArrived(Array.from(data.slice(8)));
+      this.onRefresh.emit();
+    } catch(e) {
+      console.error(e);
+    }
+  }
+
   _refreshDataArrived(data) {
     if (this.logPoints.length > this.logsize)
       this.logPoints.splice(0, this.logPoints.length - this.logsize);
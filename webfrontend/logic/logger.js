@@ -18,7 +18,16 @@ typedef struct {
  */
 class LogItem extends ItemBase {
 
-    constructor(startPos = -1, parent = null) {
+    constructor(startPos = -1, parent = null, decoded = null) {
+        if (decoded) {
+            // from a compressed record, value is already decoded
+            const {type, value} = decoded;
+            super({size: ItemBase.Types.info(type).bytes, type, value});
+            this.startPos = startPos;
+            this.parent = parent;
+            this.endPos = startPos;
+            return;
+        }
         const headerByte = parent.parent.byteArray[startPos];
         const size = (headerByte & 0x03) +1; // 0 is 1 byte, 3 is 4 bytes
         const type = (headerByte & 0xFC) >> 2;
@@ -125,9 +134,249 @@ class LogEntry {
   }
 }
 
+/**
+ * @brief schema record, written after each coldstart, describes the items
+ * in records that follow, see LogSchemaItem_t in logger.h in firmware.
+ * Items are matched to ItemBase.Types by name hash, items this frontend
+ * doesn't know of are added to ItemBase.ExtraTypes.
+ */
+class LogSchema {
+  static Kind = 0x82;
+  static ItemSize = 5;
+  static Signed = 0x04;
+  // unknown items gets type ExtraBase + id in records
+  static ExtraBase = 0x40;
+
+  /**
+   * @brief FNV-1a hash of name folded to 16 bits, same as firmware
+   */
+  static nameHash(name) {
+    let h = 0x811C9DC5;
+    for (let i = 0; i < name.length; ++i)
+      h = Math.imul(h ^ name.charCodeAt(i), 0x01000193) >>> 0;
+    return ((h >>> 16) ^ h) & 0xFFFF;
+  }
+
+  static _knownHashes = null;
+  static knownType(hash) {
+    if (!LogSchema._knownHashes) {
+      LogSchema._knownHashes = new Map();
+      for (let [name, type] of Object.entries(ItemBase.Types))
+        if (type >= 0 && type < ItemBase.Types.log_end)
+          LogSchema._knownHashes.set(LogSchema.nameHash(name), type);
+    }
+    return LogSchema._knownHashes.get(hash);
+  }
+
+  /**
+   * @param {Number} startPos first byte of record
+   * @param {LogRoot} parent
+   * @param {Boolean} hasCrc record is followed by a crc
+   */
+  constructor(startPos, parent, hasCrc = false) {
+    const bytes = parent.byteArray,
+          cnt = bytes[startPos + 1] || 0,
+          end = startPos + 2 + cnt * LogSchema.ItemSize;
+    this.startPos = startPos;
+    this.items = []; // indexed by id in records
+    this.size = 0;   // stays 0 if broken
+    if (!cnt || end > bytes.length ||
+        (hasCrc && !LogRoot.crcOk(bytes, startPos, end)))
+    {
+      return;
+    }
+
+    for (let pos = startPos + 2; pos < end; pos += LogSchema.ItemSize) {
+      const id = bytes[pos], format = bytes[pos + 1], scale = bytes[pos + 2],
+            hash = (bytes[pos + 3] << 8) | bytes[pos + 4];
+      const item = {
+        hash,
+        bytes: (format & 0x03) + 1,
+        signed: (format & LogSchema.Signed) !== 0,
+        divisor: Math.pow(2, scale & 0x0F) * Math.pow(10, scale >> 4),
+        type: LogSchema.knownType(hash)
+      };
+      if (item.type === undefined) {
+        item.type = LogSchema.ExtraBase + id;
+        ItemBase.ExtraTypes[item.type] = item;
+      }
+      this.items[id] = item;
+    }
+    this.size = end - startPos + (hasCrc ? LogRoot.CrcSize : 0);
+  }
+
+  /**
+   * @brief type in ItemBase.Types for id in records
+   */
+  typeOf(id) {
+    return this.items[id]?.type ?? id;
+  }
+}
+
+/**
+ * @brief a compressed record, kind byte, mask and one value per bit in mask
+ * keyframes hold absolute values, deltas the change since record before,
+ * see logger.h in firmware
+ */
+class CompressedLogEntry extends LogEntry {
+  static Keyframe = 0x80;
+  static Delta = 0x81;
+
+  // first compressed format, records had no time
+  static FormatNoTime = 0x01;
+
+  /**
+   * @param {Number} startPos first byte of record
+   * @param {LogRoot} parent
+   * @param {Object} state {values, time, version, schema, crc} carried
+   *                   between records, a delta needs values and time from
+   *                   record before, version is from the coldstart and
+   *                   schema from the schema record after it, crc tells if
+   *                   records are followed by a crc, updated in place
+   */
+  constructor(startPos, parent, state) {
+    super(startPos, parent);
+    const bytes = parent.byteArray,
+          keyframe = bytes[startPos] === CompressedLogEntry.Keyframe;
+    let pos = startPos + 1;
+
+    const varint = ()=>{
+      let vlu = 0;
+      for (let shift = 0; shift < 35; shift += 7) {
+        if (pos >= bytes.length) return NaN;
+        const byte = bytes[pos++];
+        vlu += (byte & 0x7F) * Math.pow(2, shift);
+        if (!(byte & 0x80)) return vlu;
+      }
+      return NaN;
+    }
+    // zigzag, small negative numbers are stored as small positive
+    const signed = (vlu)=>vlu % 2 ? -(vlu + 1) / 2 : vlu / 2;
+
+    this.keyframe = keyframe;
+    this.children = [];
+    this.size = 0; // stays 0 if broken
+    if (state.version !== CompressedLogEntry.FormatNoTime) {
+      // keyframe has ms since coldstart, delta ms since record before
+      const ms = varint();
+      if (isNaN(ms)) return;
+      state.time = keyframe ? ms : state.time + ms;
+      this.time = state.time;
+    }
+    const mask = varint();
+    if (isNaN(mask)) return;
+    const values = state.values;
+    for (let id = 0, bits = mask; bits > 0; ++id, bits = Math.floor(bits / 2)) {
+      if (!(bits % 2)) continue;
+      const vlu = varint();
+      if (isNaN(vlu)) return;
+      // ids are types unless a schema says otherwise
+      const type = state.schema ? state.schema.typeOf(id) : id;
+      values[type] = keyframe ? signed(vlu) : values[type] + signed(vlu);
+    }
+    // a delta only holds what changed, record has all known values
+    values.forEach((value, type)=>{
+      this.children.push(new LogItem(startPos, this, {type, value}));
+    });
+    if (state.crc) {
+      if (!LogRoot.crcOk(bytes, startPos, pos)) return;
+      pos += LogRoot.CrcSize;
+    }
+    this.size = pos - startPos;
+  }
+
+  itemCnt() {
+    return this.children.length;
+  }
+
+  _generateChildren() {
+    // children are decoded in constructor
+  }
+}
+
+/**
+ * @brief CRC-8 poly 0x07, init 0, same as crc8() in firmware crc.c,
+ *        pass crc so far as init to continue it as crc8Update() does
+ */
+function crc8(byteArray, start = 0, end = byteArray.length, init = 0) {
+    let crc = init;
+    for (let i = start; i < end; ++i) {
+        crc ^= byteArray[i];
+        for (let bit = 0; bit < 8; ++bit)
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+    }
+    return crc;
+}
+
 class LogRoot {
     static _instance = null;
 
+    // must match EEPROM_PAGE_SIZE and LogPageTrailer_t in logger.h
+    static PageSize = 256;
+    static PageTrailerSize = 6;
+
+    // first byte in a LogGetSince reply, LOG_SINCE_* in logger.h
+    static SinceWrapped = 0x01;
+    static SinceNewGen = 0x02;
+    // upper bits of seq is generation, LOG_GEN_SHIFT in logger.h
+    static GenShift = 20;
+    // seq to ask for when there are no cached pages
+    static NoSeq = 0xFFFFFFFF;
+    // log rate record, LOG_KIND_RATE in logger.h, periodicity follows
+    static RateKind = 0x83;
+    static RateSize = 2;
+    // first in each page, LOG_KIND_SYNC in logger.h, page seq follows
+    static SyncKind = 0x84;
+    static SyncSize = 5;
+    // each record is followed by a crc8 since this format
+    static CrcSize = 1;
+    static FormatNoCrc = 0x04;
+    static FormatUncompressed = 0x5A;
+
+    static versionHasCrc(version) {
+        return version > LogRoot.FormatNoCrc &&
+               version !== LogRoot.FormatUncompressed;
+    }
+
+    /**
+     * @brief true if record start..end is followed by its crc
+     */
+    static crcOk(bytes, start, end) {
+        return end < bytes.length && crc8(bytes, start, end) === bytes[end];
+    }
+
+    /**
+     * @brief find next sync record after a broken record at pos
+     * @returns position of sync record, endPos if there is none
+     */
+    static resync(bytes, pos, endPos) {
+        for (let p = pos + 1; p + LogRoot.SyncSize < endPos; ++p) {
+            if (bytes[p] === LogRoot.SyncKind &&
+                LogRoot.crcOk(bytes, p, p + LogRoot.SyncSize))
+            {
+                return p;
+            }
+        }
+        return endPos;
+    }
+
+    /**
+     * @brief true if both seq are from the same clear of the log
+     * A page number that carries into the generation bits follows
+     * directly, a clear always leaves a gap.
+     */
+    static sameGen(olderSeq, newerSeq) {
+        return (olderSeq >>> LogRoot.GenShift) === (newerSeq >>> LogRoot.GenShift) ||
+               olderSeq + 1 === newerSeq;
+    }
+
+    /**
+     * @brief ms between records for a SETTINGS_LOG_* periodicity
+     */
+    static periodMs(periodicity) {
+        return 20 << periodicity;
+    }
+
     /**
      * @param construct a new singleton
      * @returns the LogRoot singleton
@@ -139,6 +388,8 @@ class LogRoot {
     }
 
     constructor() {
+        // pages fetched from device by seq, kept between downloads
+        this.pageCache = new Map();
         this.clear();
     }
 
@@ -149,6 +400,8 @@ class LogRoot {
         this.byteArray = new Uint8Array(128 * 1024);
         this.logEntries = [];
         this.coldStarts = [];
+        // {entry, periodMs}, rate from logEntries[entry] and on
+        this.rateChanges = [];
         this.startPos = -1;
     }
 
@@ -200,6 +453,100 @@ class LogRoot {
     return items;
   }
 
+    /**
+     * @brief reads trailer of page at pos in image
+     * @returns {seq, start, used} or null if page is broken, unused or
+     *          its sync record doesn't match the trailer
+     */
+    static pageInfo(image, pos) {
+        const payloadSz = LogRoot.PageSize - LogRoot.PageTrailerSize,
+              tr = pos + payloadSz,
+              used = image[tr + 4];
+        if (used < 1 || used > payloadSz ||
+            crc8(image, pos, pos + LogRoot.PageSize -1) !== image[tr + 5])
+        {
+            return null;
+        }
+        // torn rewrite of an old page that kept the old trailer
+        if (image[pos] === LogRoot.SyncKind &&
+            (!LogRoot.crcOk(image, pos, pos + LogRoot.SyncSize) ||
+             [0, 1, 2, 3].some(i=>image[pos + 1 + i] !== image[tr + i])))
+        {
+            return null;
+        }
+        const seq = ((image[tr] << 24) | (image[tr+1] << 16) |
+                     (image[tr+2] << 8) | image[tr+3]) >>> 0;
+        return {seq, start: pos, used};
+    }
+
+    /**
+     * @brief merge pages read from device into the page cache
+     * A page with the same seq as a cached page replaces it, the newest
+     * page is sent again when it got more records.
+     * @param {Uint8Array} data reply from LogGetSince, flags then pages
+     * @returns {Uint8Array} records of all cached pages, oldest first
+     */
+    mergePages(data) {
+        const pageSz = LogRoot.PageSize;
+        if (data[0] & LogRoot.SinceNewGen)
+            this.pageCache.clear();
+        for (let pos = 1; pos + pageSz <= data.length; pos += pageSz) {
+            const page = LogRoot.pageInfo(data, pos);
+            if (page)
+                this.pageCache.set(page.seq, data.slice(pos, pos + pageSz));
+        }
+
+        const image = new Uint8Array(this.pageCache.size * pageSz);
+        let pos = 0;
+        for (const page of this.pageCache.values()) {
+            image.set(page, pos);
+            pos += pageSz;
+        }
+        return LogRoot.linearizePages(image);
+    }
+
+    /**
+     * @returns seq of newest cached page, NoSeq if none
+     */
+    newestSeq() {
+        let newest = LogRoot.NoSeq;
+        for (const seq of this.pageCache.keys())
+            if (newest === LogRoot.NoSeq || seq > newest) newest = seq;
+        return newest;
+    }
+
+    /**
+     * @brief convert a paged EEPROM image to a plain record stream
+     * Each page ends with a trailer {seq[4], used, crc}, pages with bad
+     * crc is skipped, the rest is joined in seq order, oldest first.
+     * Pages left from before a clear are in an older generation.
+     * @param {Uint8Array} image the log partition as read from device
+     * @returns {Uint8Array} records, can be given to parseLog with startAddr 0
+     */
+    static linearizePages(image) {
+        const pageSz = LogRoot.PageSize,
+              payloadSz = pageSz - LogRoot.PageTrailerSize;
+        const pages = [];
+        for (let pos = 0; pos + pageSz <= image.length; pos += pageSz) {
+            const page = LogRoot.pageInfo(image, pos);
+            if (page) pages.push(page);
+        }
+        pages.sort((a, b)=>a.seq - b.seq);
+        let first = Math.max(pages.length - 1, 0);
+        while (first > 0 && LogRoot.sameGen(pages[first - 1].seq, pages[first].seq))
+            --first;
+        pages.splice(0, first);
+
+        const bytes = new Uint8Array(
+            pages.reduce((sum, page)=>sum + page.used, 0));
+        let pos = 0;
+        for (const page of pages) {
+            bytes.set(image.subarray(page.start, page.start + page.used), pos);
+            pos += page.used;
+        }
+        return bytes;
+    }
+
     /**
      * @brief parse a new log or continued log,
      *         might be usefull if log contains null bytes
@@ -211,17 +558,94 @@ class LogRoot {
         this.startPos = startAddr;
         const wasEmpty = this.logEntries.length === 0;
 
+        // carried between compressed records, synced at a keyframe
+        const state = {values: [], time: 0, version: undefined,
+                       schema: undefined, synced: false, crc: false};
         const readLogEntries = (pos, endPos) => {
+            // formats without sync records can't recover from a broken record
+            const skip = (pos)=>state.crc ?
+                LogRoot.resync(byteArray, pos, endPos) : endPos;
             while (pos < endPos) {
-                let entry = new LogEntry(pos, this);
-                if (entry.size < 1) break;
-                this.logEntries.push(entry);
-                if (entry.itemCnt() === 1 &&
-                    entry.getChild(ItemBase.Types.log_coldStart))
+                const kind = byteArray[pos];
+                let entry;
+                if (kind === 0) break; // end of records
+                if (kind === CompressedLogEntry.Keyframe ||
+                    kind === CompressedLogEntry.Delta)
                 {
+                    if (kind === CompressedLogEntry.Keyframe) {
+                        state.values = [];
+                        state.synced = true;
+                    }
+                    entry = new CompressedLogEntry(pos, this, state);
+                    if (entry.size < 1) {
+                        pos = skip(pos);
+                        continue;
+                    }
+                    pos += entry.size;
+                    // a delta is useless without its keyframe
+                    if (state.synced) this.logEntries.push(entry);
+                    continue;
+                }
+                if (kind === LogSchema.Kind) {
+                    const schema = new LogSchema(pos, this, state.crc);
+                    if (schema.size < 1) {
+                        pos = skip(pos);
+                        continue;
+                    }
+                    state.schema = schema;
+                    pos += schema.size;
+                    continue;
+                }
+                if (kind === LogRoot.RateKind) {
+                    const end = pos + LogRoot.RateSize;
+                    if (end > endPos ||
+                        (state.crc && !LogRoot.crcOk(byteArray, pos, end)))
+                    {
+                        pos = skip(pos);
+                        continue;
+                    }
+                    this.rateChanges.push({
+                        entry: this.logEntries.length,
+                        periodMs: LogRoot.periodMs(byteArray[pos + 1])
+                    });
+                    pos = end + (state.crc ? LogRoot.CrcSize : 0);
+                    continue;
+                }
+                if (kind === LogRoot.SyncKind) {
+                    // page starts here, it decodes on its own
+                    const end = pos + LogRoot.SyncSize;
+                    if (!LogRoot.crcOk(byteArray, pos, end)) {
+                        pos = skip(pos);
+                        continue;
+                    }
+                    state.crc = true;
+                    state.synced = false;
+                    pos = end + LogRoot.CrcSize;
+                    continue;
+                }
+                entry = new LogEntry(pos, this);
+                if (entry.size < 1 || kind >= 0x80) {
+                    pos = skip(pos);
+                    continue;
+                }
+                const coldStart = entry.itemCnt() === 1 &&
+                    entry.getChild(ItemBase.Types.log_coldStart);
+                // format in a coldstart tells if it has a crc
+                const hasCrc = coldStart ?
+                    LogRoot.versionHasCrc(coldStart.value) : state.crc;
+                if (hasCrc && !LogRoot.crcOk(byteArray, pos, pos + entry.size)) {
+                    pos = skip(pos);
+                    continue;
+                }
+                this.logEntries.push(entry);
+                if (coldStart) {
                   this.coldStarts.push(this.logEntries.length-1);
+                  state.version = coldStart.value;
+                  state.schema = undefined;
+                  state.synced = false;
+                  state.crc = hasCrc;
                 }
-                pos += entry.size;
+                pos += entry.size + (hasCrc ? LogRoot.CrcSize : 0);
             }
         }
 
@@ -238,6 +662,171 @@ class LogRoot {
     }
 }
 
+/**
+ * @brief brake event captures, as stored by capture.c in firmware
+ * Each slot is a header followed by samples taken each brake loop lap.
+ */
+class CaptureRoot {
+    // must match CaptureHeader_t and CAPTURE_SLOT_SIZE in capture.h
+    static HeaderSize = 13;
+    static SampleSize = 13;
+    static SlotPages = 3;
+    static Triggers = {
+        ABS: 1,
+        Touchdown: 2,
+        HardDecel: 3,
+    };
+
+    /**
+     * @brief parse capture region as read from device
+     * @param {Uint8Array} image the capture partition
+     * @returns {Array} captures oldest first, each
+     *    {seq, timeMs, trigger, preSamples, samples: [{timeMs, brakeForce,
+     *     brakeForce_out, speedOnGround, wheelRPS, slip, acceleration}]}
+     *    timeMs of a sample is relative to the trigger sample
+     */
+    static parse(image) {
+        const slotSz = CaptureRoot.SlotPages * LogRoot.PageSize,
+              hdrSz = CaptureRoot.HeaderSize,
+              smplSz = CaptureRoot.SampleSize,
+              captures = [];
+        const u32 = (pos)=>((image[pos] << 24) | (image[pos+1] << 16) |
+                            (image[pos+2] << 8) | image[pos+3]) >>> 0;
+
+        for (let pos = 0; pos + slotSz <= image.length; pos += slotSz) {
+            const cnt = image[pos + 10], pre = image[pos + 9];
+            if (image[pos + 11] !== smplSz || cnt < 1 || pre >= cnt ||
+                hdrSz + cnt * smplSz > slotSz)
+            {
+                continue;
+            }
+            // crc is last in header but covers the samples too
+            const smplStart = pos + hdrSz,
+                  smplEnd = smplStart + cnt * smplSz;
+            const crc = crc8(image, smplStart, smplEnd,
+                             crc8(image, pos, pos + hdrSz -1));
+            if (crc !== image[pos + hdrSz -1])
+                continue;
+
+            const samples = [];
+            for (let p = smplStart; p < smplEnd; p += smplSz) {
+                samples.push({
+                    dt: image[p],
+                    brakeForce: image[p+1],
+                    brakeForce_out: [image[p+2], image[p+3], image[p+4]],
+                    speedOnGround: image[p+5],
+                    wheelRPS: [image[p+6], image[p+7], image[p+8]],
+                    // in 0.4% steps, to permille as in log
+                    slip: [image[p+9] * 4, image[p+10] * 4, image[p+11] * 4],
+                    acceleration: (image[p+12] << 24 >> 24) * 64,
+                });
+            }
+            // time relative trigger, dt is from the sample before
+            samples[pre].timeMs = 0;
+            for (let i = pre +1; i < cnt; ++i)
+                samples[i].timeMs = samples[i-1].timeMs + samples[i].dt;
+            for (let i = pre -1; i >= 0; --i)
+                samples[i].timeMs = samples[i+1].timeMs - samples[i+1].dt;
+
+            captures.push({
+                seq: u32(pos), timeMs: u32(pos + 4),
+                trigger: image[pos + 8], preSamples: pre, samples
+            });
+        }
+        return captures.sort((a, b)=>a.seq - b.seq);
+    }
+}
+
+/**
+ * @brief session directory, as stored by session.c in firmware
+ * Each coldstart opens a session, the entry tells where in the log it
+ * starts. It is closed at power fail with its length and summary.
+ */
+class SessionRoot {
+    // must match SessionEntry_t and SESSION_* in session.h
+    static EntrySize = 44;
+    static Flags = {
+        Closed: 0x01,
+        Moved:  0x02,
+        Braked: 0x04,
+        ABS:    0x08,
+    };
+
+    /**
+     * @brief parse directory as read from device
+     * @param {Uint8Array} image the session partition
+     * @param {Number} headSeq seq of next page in log, from reply header
+     * @returns {Array} sessions oldest first, each
+     *    {number, startSeq, endSeq, startTime, durationMs, records,
+     *     flags, closed, stats} stats as from parseStats
+     *    endSeq is the last page, for a session that lost power hard
+     *    it is taken from the session after, or head of log
+     */
+    static parse(image, headSeq) {
+        const entrySz = SessionRoot.EntrySize,
+              perPage = Math.floor(LogRoot.PageSize / entrySz),
+              sessions = [];
+        const u32 = (pos)=>((image[pos] << 24) | (image[pos+1] << 16) |
+                            (image[pos+2] << 8) | image[pos+3]) >>> 0;
+
+        for (let page = 0; page + LogRoot.PageSize <= image.length;
+             page += LogRoot.PageSize)
+        {
+            for (let i = 0; i < perPage; ++i) {
+                const pos = page + i * entrySz,
+                      number = u32(pos);
+                // zero filled entries pass the crc
+                if (number === 0 ||
+                    crc8(image, pos, pos + entrySz -1) !== image[pos + entrySz -1])
+                {
+                    continue;
+                }
+                const flags = image[pos + 22],
+                      closed = (flags & SessionRoot.Flags.Closed) !== 0,
+                      startSeq = u32(pos + 4),
+                      pages = (image[pos + 20] << 8) | image[pos + 21];
+                sessions.push({
+                    number, startSeq, startTime: u32(pos + 8),
+                    durationMs: u32(pos + 12), records: u32(pos + 16),
+                    endSeq: closed ? startSeq + Math.max(pages, 1) -1 : undefined,
+                    flags, closed,
+                    stats: SessionRoot.parseStats(image, pos + 23)
+                });
+            }
+        }
+        sessions.sort((a, b)=>a.number - b.number);
+
+        sessions.forEach((session, i)=>{
+            if (session.endSeq !== undefined) return;
+            const next = sessions[i + 1];
+            session.endSeq = (next ? next.startSeq : headSeq) - 1;
+            if (session.endSeq < session.startSeq)
+                session.endSeq = session.startSeq;
+        });
+        return sessions;
+    }
+
+    /**
+     * @brief parse SessionStats_t at pos, all 0 while session is open
+     * @returns {maxDecel, maxSlip, absCount, absMs, brakeMs, peakBrake,
+     *           maxSpeed} decel in revs/sec per sec, slip in permille
+     */
+    static parseStats(image, pos) {
+        const u16 = (p)=>(image[p] << 8) | image[p+1],
+              u32 = (p)=>((image[p] << 24) | (image[p+1] << 16) |
+                          (image[p+2] << 8) | image[p+3]) >>> 0;
+        return {
+            maxDecel: u16(pos),
+            maxSlip: [u16(pos + 2), u16(pos + 4), u16(pos + 6)],
+            absCount: u16(pos + 8),
+            absMs: u32(pos + 10),
+            brakeMs: u32(pos + 14),
+            peakBrake: image[pos + 18],
+            maxSpeed: image[pos + 19],
+        };
+    }
+}
+
 // ---- Below code is only for testing -----------------------------
 
 
@@ -509,5 +1098,285 @@ if (testing) {
         console.log("brake1", JSON.stringify(wheel1))
     }
 
+    // paged image, page 1 is older than page 0 and page 2 is broken
+    const buildPage = (seq, records)=>{
+        const page = new Uint8Array(LogRoot.PageSize);
+        page.set(records);
+        const tr = LogRoot.PageSize - LogRoot.PageTrailerSize;
+        page.set([(seq >>> 24) & 0xFF, (seq >> 16) & 0xFF,
+                  (seq >> 8) & 0xFF, seq & 0xFF, records.length], tr);
+        page[LogRoot.PageSize -1] = crc8(page, 0, LogRoot.PageSize -1);
+        return page;
+    }
+    const coldStart = [4, 1, (ItemBase.Types.log_coldStart << 2) | 0, 0x5A],
+          speed = [4, 1, (ItemBase.Types.speedOnGround << 2) | 0, 0x40];
+    const image = new Uint8Array(LogRoot.PageSize * 4);
+    image.set(buildPage(8, [...speed]), 0);
+    image.set(buildPage(7, [...coldStart, ...speed]), LogRoot.PageSize);
+    const broken = buildPage(9, [...speed]);
+    broken[0] = 5;
+    image.set(broken, LogRoot.PageSize * 2);
+    test.equal(crc8(new TextEncoder().encode("123456789")), 0xF4);
+    // continued as capture.c does, values from crc8Update() in crc.c
+    const hdrCrc = crc8(new Uint8Array([1, 2, 3, 4, 5]));
+    test.equal(hdrCrc, 188);
+    test.equal(crc8(new Uint8Array([9, 8, 7, 6]), 0, 4, hdrCrc), 254);
+    const records = LogRoot.linearizePages(image);
+    test.equal(records.length, 12);
+    test.equal(records[0], 4);
+    test.equal(records[3], 0x5A);
+    test.equal(records[11], 0x40);
+    logRoot.clear();
+    logRoot.parseLog(records, 0);
+    test.equal(logRoot.logEntries.length, 3);
+    test.equal(logRoot.coldStarts.length, 1);
+
+    // cleared log, pages from generation before are left in EEPROM
+    const cleared = new Uint8Array(image);
+    cleared.set(buildPage(0x100000, [...coldStart]), LogRoot.PageSize * 3);
+    test.equal(LogRoot.sameGen(7, 0xFFFFF), true);
+    test.equal(LogRoot.sameGen(7, 0x100000), false);
+    test.equal(LogRoot.sameGen(0xFFFFF, 0x100000), true);
+    test.equal(LogRoot.linearizePages(cleared).length, 4);
+    // page number carried into the generation bits, no clear in between
+    const carried = new Uint8Array(LogRoot.PageSize * 2);
+    carried.set(buildPage(0xFFFFF, [...coldStart]), 0);
+    carried.set(buildPage(0x100000, [...speed]), LogRoot.PageSize);
+    test.equal(LogRoot.linearizePages(carried).length, 8);
+
+    // incremental download, newest page is sent again with more records
+    const since = (flags, ...pages)=>{
+        const data = new Uint8Array(1 + pages.length * LogRoot.PageSize);
+        data[0] = flags;
+        pages.forEach((page, i)=>data.set(page, 1 + i * LogRoot.PageSize));
+        return data;
+    }
+    test.equal(logRoot.newestSeq(), LogRoot.NoSeq);
+    let merged = logRoot.mergePages(since(LogRoot.SinceNewGen,
+        buildPage(7, [...coldStart, ...speed]), buildPage(8, [...speed])));
+    test.equal(merged.length, 12);
+    test.equal(logRoot.newestSeq(), 8);
+    merged = logRoot.mergePages(since(0, buildPage(8, [...speed, ...speed]),
+        buildPage(9, [...speed]), broken));
+    test.equal(merged.length, 20);
+    test.equal(logRoot.newestSeq(), 9);
+    // seq from another generation drops the cache
+    merged = logRoot.mergePages(since(LogRoot.SinceNewGen,
+        buildPage(0x100000, [...coldStart])));
+    test.equal(merged.length, 4);
+    test.equal(logRoot.newestSeq(), 0x100000);
+    logRoot.pageCache.clear();
+
+    // compressed records, format version 2 in coldstart
+    const T = ItemBase.Types;
+    const compressed = new Uint8Array([
+        4, 1, (T.log_coldStart << 2) | 0, 0x02,
+        // keyframe at 300ms, zigzag speedOnGround 60, accelX -3, accelZ 300
+        0x80, 0xAC, 0x02, 0x81, 0x80, 0x0A, 0x78, 0x05, 0xD8, 0x04,
+        // delta 20ms later, speedOnGround -1, accelZ +2
+        0x81, 20, 0x81, 0x80, 0x08, 0x01, 0x04,
+        // delta 640ms later, nothing changed
+        0x81, 0x80, 0x05, 0x00,
+        0, 0
+    ]);
+    logRoot.clear();
+    logRoot.parseLog(compressed, 0);
+    test.equal(logRoot.logEntries.length, 4);
+    test.equal(logRoot.coldStarts.length, 1);
+    const key = logRoot.logEntries[1];
+    test.equal(key.size, 10);
+    test.equal(key.time, 300);
+    test.equal(key.itemCnt(), 3);
+    test.equal(key.getChild(T.speedOnGround).value, 60);
+    test.equal(key.getChild(T.accelX).value, -3);
+    test.equal(key.getChild(T.accelZ).value, 300);
+    test.equal(key.getChild(T.accelZ).size, 2);
+    const delta = logRoot.logEntries[2];
+    test.equal(delta.size, 7);
+    test.equal(delta.time, 320);
+    test.equal(delta.getChild(T.speedOnGround).value, 59);
+    test.equal(delta.getChild(T.accelX).value, -3);
+    test.equal(delta.getChild(T.accelZ).value, 302);
+    test.equal(logRoot.logEntries[3].getChild(T.accelZ).value, 302);
+    test.equal(logRoot.logEntries[3].time, 960);
+    // delta without keyframe is skipped
+    logRoot.clear();
+    logRoot.parseLog(compressed.slice(14), 0);
+    test.equal(logRoot.logEntries.length, 0);
+    // version 1 records have no time
+    const noTime = compressed.filter((b, i)=>[5, 6, 15, 22, 23].indexOf(i) < 0);
+    noTime[3] = CompressedLogEntry.FormatNoTime;
+    logRoot.clear();
+    logRoot.parseLog(noTime, 0);
+    test.equal(logRoot.logEntries.length, 4);
+    test.equal(logRoot.logEntries[1].time, undefined);
+    test.equal(logRoot.logEntries[2].getChild(T.accelZ).value, 302);
+
+    // schema after coldstart, ids in records differ from types here
+    test.equal(LogSchema.nameHash("speedOnGround"), 0xD061);
+    test.equal(LogSchema.nameHash("accelZ"), 0xC3B4);
+    const withSchema = new Uint8Array([
+        4, 1, (T.log_coldStart << 2) | 0, 0x03,
+        // id 0 is accelZ, id 1 a new item scaled by 1/20, id 2 is slip0
+        LogSchema.Kind, 3,
+        0, 0x01 | LogSchema.Signed, 9, 0xC3, 0xB4,
+        1, 0x00, 0x11, 0x12, 0x34,
+        2, 0x01, 0x10, 0x26, 0x61,
+        // keyframe at 0ms, zigzag accelZ -512, new item 30, slip0 250
+        0x80, 0x00, 0x07, 0xFF, 0x07, 0x3C, 0xF4, 0x03,
+        // delta 20ms later, new item +2
+        0x81, 20, 0x02, 0x04,
+        0, 0
+    ]);
+    logRoot.clear();
+    logRoot.parseLog(withSchema, 0);
+    test.equal(logRoot.logEntries.length, 3);
+    const extraType = LogSchema.ExtraBase + 1;
+    const schemaKey = logRoot.logEntries[1];
+    test.equal(schemaKey.itemCnt(), 3);
+    test.equal(schemaKey.getChild(T.accelZ).value, -512);
+    test.equal(schemaKey.getChild(T.accelZ).realVlu(), -1);
+    test.equal(schemaKey.getChild(T.slip0).value, 250);
+    test.equal(logRoot.logEntries[2].getChild(extraType).value, 32);
+    test.equal(logRoot.logEntries[2].getChild(extraType).realVlu(), 1.6);
+    test.equal(ItemBase.ExtraTypes[extraType].hash, 0x1234);
+
+    // rate records after coldstart and when logger goes fast
+    const withRate = new Uint8Array([
+        4, 1, (T.log_coldStart << 2) | 0, 0x04,
+        LogRoot.RateKind, 2,
+        0x80, 0x00, 0x01, 0x02,
+        LogRoot.RateKind, 0,
+        0x81, 80, 0x01, 0x02,
+        0x81, 20, 0x01, 0x02,
+        0, 0
+    ]);
+    logRoot.clear();
+    logRoot.parseLog(withRate, 0);
+    test.equal(logRoot.logEntries.length, 4);
+    test.equal(logRoot.rateChanges.length, 2);
+    test.equal(logRoot.rateChanges[0].entry, 1);
+    test.equal(logRoot.rateChanges[0].periodMs, 80);
+    test.equal(logRoot.rateChanges[1].entry, 2);
+    test.equal(logRoot.rateChanges[1].periodMs, 20);
+    test.equal(logRoot.logEntries[3].time, 100);
+
+    // records with crc, a broken record skips to next page, page 3 is
+    // a torn rewrite that kept the trailer of page 12
+    const withCrc = (rec)=>[...rec, crc8(new Uint8Array(rec))];
+    const sync = (seq)=>withCrc([LogRoot.SyncKind, (seq >>> 24) & 0xFF,
+                     (seq >> 16) & 0xFF, (seq >> 8) & 0xFF, seq & 0xFF]);
+    const brokenDelta = withCrc([0x81, 20, 0x01, 0x02]);
+    brokenDelta[3] = 0x04;
+    const crcImage = new Uint8Array(LogRoot.PageSize * 3);
+    crcImage.set(buildPage(10, [...sync(10),
+        ...withCrc([4, 1, (T.log_coldStart << 2) | 0, 0x05]),
+        ...withCrc([0x80, 0x00, 0x01, 0x02]),
+        ...brokenDelta,
+        ...withCrc([0x81, 20, 0x01, 0x02])]), 0);
+    crcImage.set(buildPage(11, [...sync(11),
+        ...withCrc([0x80, 100, 0x01, 0x08]),
+        ...withCrc([0x81, 20, 0x01, 0x02])]), LogRoot.PageSize);
+    crcImage.set(buildPage(12, [...sync(3),
+        ...withCrc([0x80, 0x00, 0x01, 0x02])]), LogRoot.PageSize * 2);
+    test.equal(LogRoot.pageInfo(crcImage, LogRoot.PageSize * 2), null);
+    logRoot.clear();
+    logRoot.parseLog(LogRoot.linearizePages(crcImage), 0);
+    test.equal(logRoot.coldStarts.length, 1);
+    test.equal(logRoot.logEntries.length, 4);
+    test.equal(logRoot.logEntries[1].getChild(T.speedOnGround).value, 1);
+    test.equal(logRoot.logEntries[2].time, 100);
+    test.equal(logRoot.logEntries[3].getChild(T.speedOnGround).value, 5);
+
+    // capture slots, slot 1 is older than slot 0 and slot 2 is torn
+    const buildCapture = (seq, trigger, pre, samples)=>{
+        const slot = new Uint8Array(CaptureRoot.SlotPages * LogRoot.PageSize);
+        slot.set([(seq >>> 24) & 0xFF, (seq >> 16) & 0xFF, (seq >> 8) & 0xFF,
+                  seq & 0xFF, 0, 0, 0x30, 0x39, trigger, pre,
+                  samples.length, CaptureRoot.SampleSize]);
+        samples.forEach((smpl, i)=>slot.set(smpl,
+                  CaptureRoot.HeaderSize + i * CaptureRoot.SampleSize));
+        slot[CaptureRoot.HeaderSize -1] = crc8(slot, CaptureRoot.HeaderSize,
+            CaptureRoot.HeaderSize + samples.length * CaptureRoot.SampleSize,
+            crc8(slot, 0, CaptureRoot.HeaderSize -1));
+        return slot;
+    }
+    const smpl = (dt, speed, slip, accel)=>
+                    [dt, 80, 80, 60, 0, speed, speed, speed -5, 0, slip, 0, 0, accel];
+    const capImage = new Uint8Array(CaptureRoot.SlotPages * LogRoot.PageSize * 3);
+    const slotSz = CaptureRoot.SlotPages * LogRoot.PageSize;
+    capImage.set(buildCapture(5, CaptureRoot.Triggers.ABS, 2,
+        [smpl(5, 50, 0, 0), smpl(5, 49, 10, 0xFF),
+         smpl(5, 40, 60, 0xFE), smpl(20, 38, 62, 3)]), 0);
+    capImage.set(buildCapture(4, CaptureRoot.Triggers.Touchdown, 0,
+        [smpl(20, 30, 0, 0)]), slotSz);
+    const torn = buildCapture(6, CaptureRoot.Triggers.HardDecel, 0,
+        [smpl(20, 30, 0, 0)]);
+    torn[CaptureRoot.HeaderSize] = 7;
+    capImage.set(torn, slotSz * 2);
+    const captures = CaptureRoot.parse(capImage);
+    test.equal(captures.length, 2);
+    test.equal(captures[0].seq, 4);
+    test.equal(captures[0].trigger, CaptureRoot.Triggers.Touchdown);
+    const abs = captures[1];
+    test.equal(abs.timeMs, 12345);
+    test.equal(abs.preSamples, 2);
+    test.equal(abs.samples.length, 4);
+    test.equal(abs.samples[0].timeMs, -10);
+    test.equal(abs.samples[2].timeMs, 0);
+    test.equal(abs.samples[3].timeMs, 20);
+    test.equal(abs.samples[2].slip[0], 240);
+    test.equal(abs.samples[1].acceleration, -64);
+    test.equal(abs.samples[3].wheelRPS[1], 33);
+
+    // session directory, 10 entries a page, slot 1 is older than slot 0
+    const buildEntry = (number, startSeq, startTime, ms, records, pages, flags,
+                        stats = [])=>{
+        const be32 = (n)=>[(n >>> 24) & 0xFF, (n >> 16) & 0xFF,
+                           (n >> 8) & 0xFF, n & 0xFF];
+        const entry = new Uint8Array(SessionRoot.EntrySize);
+        entry.set([...be32(number), ...be32(startSeq), ...be32(startTime),
+                   ...be32(ms), ...be32(records), pages >> 8, pages & 0xFF,
+                   flags, ...stats]);
+        entry[SessionRoot.EntrySize -1] = crc8(entry, 0, SessionRoot.EntrySize -1);
+        return entry;
+    }
+    const dirImage = new Uint8Array(LogRoot.PageSize * 2);
+    const F = SessionRoot.Flags;
+    dirImage.set(buildEntry(3, 20, 70, 0, 0, 0, 0), 0);
+    dirImage.set(buildEntry(2, 12, 40, 30500, 1500, 8, F.Closed | F.Braked,
+                 [0x01, 0x2C, 0, 250, 0x01, 0x10, 0, 0, 0, 3,
+                  0, 0, 0x01, 0xF4, 0, 0, 0x13, 0x88, 90, 62]),
+                 SessionRoot.EntrySize);
+    // hard power loss, closed at next boot never happened
+    dirImage.set(buildEntry(1, 3, 0, 0, 0, 0, F.Moved), SessionRoot.EntrySize * 2);
+    // a torn entry and a newest one on next page
+    const tornEntry = buildEntry(9, 1, 0, 0, 0, 0, 0);
+    tornEntry[5] = 0x55;
+    dirImage.set(tornEntry, SessionRoot.EntrySize * 3);
+    dirImage.set(buildEntry(4, 25, 71, 0, 0, 0, 0), LogRoot.PageSize);
+    const sessions = SessionRoot.parse(dirImage, 30);
+    test.equal(sessions.length, 4);
+    test.equal(sessions[0].number, 1);
+    test.equal(sessions[0].closed, false);
+    test.equal(sessions[0].endSeq, 11);
+    test.equal(sessions[1].closed, true);
+    test.equal(sessions[1].startSeq, 12);
+    test.equal(sessions[1].endSeq, 19);
+    test.equal(sessions[1].records, 1500);
+    test.equal(sessions[1].durationMs, 30500);
+    test.equal(sessions[1].flags & F.Braked, F.Braked);
+    test.equal(sessions[1].stats.maxDecel, 300);
+    test.equal(sessions[1].stats.maxSlip[1], 272);
+    test.equal(sessions[1].stats.absCount, 3);
+    test.equal(sessions[1].stats.absMs, 500);
+    test.equal(sessions[1].stats.brakeMs, 5000);
+    test.equal(sessions[1].stats.peakBrake, 90);
+    test.equal(sessions[1].stats.maxSpeed, 62);
+    test.equal(sessions[0].stats.maxSpeed, 0);
+    test.equal(sessions[2].endSeq, 24);
+    test.equal(sessions[3].startTime, 71);
+    test.equal(sessions[3].endSeq, 29);
+
     test.finished();
 }
\ No newline at end of file
@@ -18,6 +18,9 @@ const WheelDirTranslated = {
 
 // FIXME cleanup these render function to be oop
 
+// while live tuning spinboxes are rendered as sliders
+let liveTune = false;
+
 function renderBase(tag, {key, rdonly = false, txt, title}) {
   const readonly = rdonly ? " readonly" : "";
   return {
@@ -34,6 +37,11 @@ function renderTextbox({key, vlu, txt, title, rdonly = false}) {
 
 function renderSpinbox({key, vlu, txt, title, rdonly = false, min = 0, max = 100}) {
   const {lbl, part} = renderBase("input", {key, txt, title, rdonly});
+  if (liveTune)
+    return `${lbl}\n${part} type="range" value="${vlu}" min="${min}" max="${max}"
+          oninput="ConfigBase.changeVlu('${key}', event.target.value);
+                   this.nextElementSibling.value = event.target.value"/>
+          <output>${vlu}</output>`;
   return `${lbl}\n${part} type="number" value="${vlu}" min="${min}" max="${max}"
           onchange="ConfigBase.changeVlu('${key}', event.target.value)"/>`;
 }
@@ -63,6 +71,8 @@ function renderSelect({key, vlu, txt, title, rdonly = false,
 
 class ConfigureHtmlCls {
   warnOverWrite = true;
+  _tuneSending = false;
+  _tunePending = false;
 
   async setDefault() {
     console.log("defaultValues")
@@ -76,12 +86,17 @@ class ConfigureHtmlCls {
     }
   }
 
-  async fetchSettings() {
+  /**
+   * @param byteArr settings already read, as at connect, else fetched
+   */
+  async fetchSettings(byteArr = null) {
     try {
-      const byteArr = await CommunicationBase.instance().getAllSettings();
+      if (!byteArr)
+        byteArr = await CommunicationBase.instance().getAllSettings();
       if (!byteArr) throw "Could't get settings from device";
       this.warnOverWrite = false;
       ConfigBase.deserialize(byteArr);
+      ConfigBase.markSynced();
       router.routeMain(); // for refresh values
     } catch(err) {
       console.error(err);
@@ -99,15 +114,84 @@ class ConfigureHtmlCls {
     }
 
     try {
-      const byteArr = ConfigBase.instance().serialize();
-      const res = CommunicationBase.instance().saveAllSettings(byteArr);
+      // only what changed, so device restarts as little as possible
+      const comms = CommunicationBase.instance(),
+            config = ConfigBase.instance(),
+            fields = await comms.fetchSettingsFields();
+      const res = fields ?
+        await comms.setSettingsFields(config.changedFields(fields)) :
+        await comms.saveAllSettings(config.serialize());
       if (!res) throw "Could not save settings to device";
+      ConfigBase.markSynced();
+    } catch (err) {
+      console.error(err);
+      notifyUser({msg: err?.message || err, type: notifyTypes.Warn});
+    }
+  }
+
+  async startTune() {
+    const t = this.translationObj[document.documentElement.lang];
+    try {
+      const comms = CommunicationBase.instance();
+      if (!await comms.fetchSettingsFields()) throw t.tuneUnsupported;
+      // sliders start from what device has
+      if (this.warnOverWrite) await this.fetchSettings();
+      if (!await comms.tuneSettings()) throw t.tuneFailed;
+      liveTune = true;
+      router.routeMain();
+    } catch (err) {
+      console.error(err);
+      notifyUser({msg: err?.message || err, type: notifyTypes.Warn});
+    }
+  }
+
+  async endTune(keep) {
+    try {
+      const comms = CommunicationBase.instance();
+      if (keep ? !await comms.commitSettings() : !await comms.revertSettings())
+        throw "Could not end live tune";
+      liveTune = false;
+      // device is back to what it has in EEPROM
+      if (!keep)
+        return await this.fetchSettings();
+      router.routeMain();
     } catch (err) {
       console.error(err);
       notifyUser({msg: err?.message || err, type: notifyTypes.Warn});
     }
   }
 
+  /**
+   * @brief send what changed to device while live tuning, values changed
+   *        while a send is in flight go in the next one
+   */
+  async sendTuned() {
+    if (this._tuneSending) {
+      this._tunePending = true;
+      return;
+    }
+    this._tuneSending = true;
+    try {
+      const comms = CommunicationBase.instance(),
+            config = ConfigBase.instance();
+      do {
+        this._tunePending = false;
+        const fields = config.changedFields(await comms.fetchSettingsFields());
+        if (!fields.length) continue;
+        ConfigBase.markSynced();
+        if (!await comms.setSettingsFields(fields)) {
+          ConfigBase._synced = null; // resend all next time
+          throw "Could not set settings in device";
+        }
+      } while (this._tunePending);
+    } catch (err) {
+      console.error(err);
+      notifyUser({msg: err?.message || err, type: notifyTypes.Warn});
+    } finally {
+      this._tuneSending = false;
+    }
+  }
+
   async saveSettingsToFile() {
     const date = new Date().toISOString();
     const fileHandle = await window.showSaveFilePicker({
@@ -366,6 +450,37 @@ class ConfigureHtmlCls {
             renderOptions: {
               selections: ConfigBase.LogPeriodicity
             }
+          },
+          {
+            key: "logAdaptive",
+            txt: {en: "Log faster when busy", sv: "Logga oftare vid aktivitet"},
+            title: {
+              en: "Log at the fast rate while braking or above fast speed",
+              sv: "Logga med snabb takt vid bromsning eller över snabb hastighet"
+            },
+            render: renderCheckbox
+          },
+          {
+            key: "logFastPeriodicity",
+            txt: {en: "Log fast each", sv: "Logga snabbt varje"},
+            title: {
+              en: "How often we should log while braking or fast",
+              sv: "Hur ofta den skall logga vid bromsning eller hög fart"
+            },
+            render: renderSelect,
+            renderOptions: {
+              selections: ConfigBase.LogPeriodicity
+            }
+          },
+          {
+            key: "logFastSpeed",
+            txt: {en: "Fast speed", sv: "Snabb hastighet"},
+            title: {
+              en: "Log fast above this wheel speed, revs/sec\n0 is only when braking",
+              sv: "Logga snabbt över denna hjulhastighet, varv/sek\n0 är bara vid bromsning"
+            },
+            render: renderSpinbox,
+            renderOptions: {max: 255}
           }
         ]
       }
@@ -383,7 +498,13 @@ class ConfigureHtmlCls {
           openConfigureFromFileBtn: "Open settings from file",
           setDefaultConfigureBtn: "Set device default values",
           curSettings: "Settings:",
-          warnOverWrite: "Warning! Press again if you want to overwrite changes without fecthing from device"
+          warnOverWrite: "Warning! Press again if you want to overwrite changes without fecthing from device",
+          tuneBtn: "Live tune",
+          tuneCommitBtn: "Keep tuned settings",
+          tuneRevertBtn: "Revert to saved settings",
+          tuneInfo: "Live tune: device uses changes at once, they are lost at power off unless kept",
+          tuneUnsupported: "Device firmware can't live tune, update it",
+          tuneFailed: "Could not start live tune"
       },
       sv: {
           header: "Konfigurera din device",
@@ -395,7 +516,13 @@ class ConfigureHtmlCls {
           openConfigureFromFileBtn: "Öppna inställningar från fil",
           setDefaultConfigureBtn: "Sätt default värden i enheten",
           curSettings: "Inställningar:",
-          warnOverWrite: "Varning! Tryck igen för att skriva över inställningar utan att ha hämtat från"
+          warnOverWrite: "Varning! Tryck igen för att skriva över inställningar utan att ha hämtat från",
+          tuneBtn: "Justera live",
+          tuneCommitBtn: "Behåll justerade inställningar",
+          tuneRevertBtn: "Återgå till sparade inställningar",
+          tuneInfo: "Justera live: enheten använder ändringar direkt, de försvinner vid avstängning om de inte behålls",
+          tuneUnsupported: "Enhetens firmware kan inte justera live, uppdatera den",
+          tuneFailed: "Kunde inte börja justera live"
       },
   }
 
@@ -431,12 +558,16 @@ class ConfigureHtmlCls {
     }
     const tr = this.translationObj[lang];
 
-    parentNode.innerHTML = `
-      <div class="w3-row-padding w3-padding-64 w3-container">
-      <div class="w3-content">
-        <div class="w3-twothird">
-          <h1>${tr.header}</h1>
-
+    const buttons = liveTune ? `
+          <button class="w3-button w3-blue w3-padding-large w3-large w3-margin-top"
+                  onclick="this.endTune(true)">
+            ${tr.tuneCommitBtn}
+          </button>
+          <button class="w3-button w3-gray w3-padding-large w3-large w3-margin-top"
+                  onclick="this.endTune(false)">
+            ${tr.tuneRevertBtn}
+          </button>
+          <p class="w3-text-grey">${tr.tuneInfo}</p>` : `
           <button class="w3-button w3-blue w3-padding-large w3-large w3-margin-top"
                   onclick="this.fetchSettings();">
             ${tr.fetchConfigureBtn}
@@ -453,6 +584,17 @@ class ConfigureHtmlCls {
                   onclick="this.saveSettingsToFile()">
             ${tr.saveConfigureToFileBtn}
           </button>
+          <button class="w3-button w3-gray w3-padding-large w3-large w3-margin-top"
+                  onclick="this.startTune()">
+            ${tr.tuneBtn}
+          </button>`;
+
+    parentNode.innerHTML = `
+      <div class="w3-row-padding w3-padding-64 w3-container">
+      <div class="w3-content">
+        <div class="w3-twothird">
+          <h1>${tr.header}</h1>
+          ${buttons}
           <h5 class="w3-padding-8">${tr.curSettings}</h5>
           <form id="config">
             ${renderFormItem(this.formItems)}
@@ -471,8 +613,15 @@ class ConfigureHtmlCls {
   }
 
   afterHook(parentNode, lang) {
-    if (this.warnOverWrite && CommunicationBase.instance().isOpen())
-      this.fetchSettings();
+    if (liveTune) {
+      const form = parentNode.querySelector("#config");
+      form.addEventListener("input", ()=>this.sendTuned());
+      form.addEventListener("change", ()=>this.sendTuned());
+    }
+    // nothing changed here yet, settings read at connect are current
+    const comms = CommunicationBase.instance();
+    if (this.warnOverWrite && comms.isOpen())
+      this.fetchSettings(comms.deviceInfo?.settings);
   }
 };
 
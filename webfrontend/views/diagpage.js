@@ -5,6 +5,7 @@
 class DiagPageCls {
   showDiagItems = [];
   chartWgt = null;
+  profileTimer = null;
 
   translationObj = {
     en: {
@@ -16,6 +17,18 @@ class DiagPageCls {
       start: "Start",
       stop: "Stop",
       setVluExplain: "Double click on row to set a value",
+      lost: "lost",
+      profile: "Profile",
+      clearMax: "Clear max",
+      cpuLoad: "CPU load",
+      max: "max",
+      thread: "Thread",
+      stackSize: "Stack",
+      stackUsed: "Used",
+      isr: "Interrupt",
+      isrTime: "Max time µs",
+      isrLatency: "Max latency µs",
+      i2cErrors: "I2C errors",
     },
     sv: {
       header: "Diagnos sida",
@@ -25,7 +38,19 @@ class DiagPageCls {
       chooseAll: "Välj alla",
       start: "Start",
       stop: "Stop",
-      setVluExplain: "Dubbelklicka på raden för att sätta ett värde"
+      setVluExplain: "Dubbelklicka på raden för att sätta ett värde",
+      lost: "tappade",
+      profile: "Profilering",
+      clearMax: "Nollställ max",
+      cpuLoad: "CPU last",
+      max: "max",
+      thread: "Tråd",
+      stackSize: "Stack",
+      stackUsed: "Använt",
+      isr: "Avbrott",
+      isrTime: "Max tid µs",
+      isrLatency: "Max latens µs",
+      i2cErrors: "I2C fel",
     }
   }
 
@@ -40,17 +65,70 @@ class DiagPageCls {
 
     CommunicationBase.instance().onDisconnect.subscribe(this, async ()=>{
       DiagnoseBase.instance().setFetchRefreshFreq(0);
+      this.stopProfile();
     });
   }
 
   async startStop(evt) {
     const diagObj = DiagnoseBase.instance();
     const started = await DiagnoseBase.instance()
-                    .setFetchRefreshFreq(diagObj.freq > 0 ? 0 : 5);
+                    .setFetchRefreshFreq(diagObj.freq > 0 ? 0 : 20);
     const t = this.translationObj[document.documentElement.lang];
     evt.target.innerText = started ? t.stop : t.start;
   }
 
+  toggleProfile(evt) {
+    if (this.profileTimer !== null)
+      return this.stopProfile();
+    this.profileTimer = setInterval(()=>this.refreshProfile(), 1000);
+    this.refreshProfile();
+  }
+
+  stopProfile() {
+    clearInterval(this.profileTimer);
+    this.profileTimer = null;
+    const node = document.getElementById("profileContainer");
+    if (node) node.innerHTML = "";
+  }
+
+  async clearProfile(evt) {
+    await this.refreshProfile(true);
+  }
+
+  async refreshProfile(clear = false) {
+    const node = document.getElementById("profileContainer");
+    // page changed since timer started
+    if (!node) return this.stopProfile();
+    const prof = await CommunicationBase.instance().fetchProfile(clear);
+    if (!prof) return;
+
+    const t = this.translationObj[document.documentElement.lang];
+    const stacks = prof.stacks.filter(s=>s.size > 0).map(s=>`
+          <tr><td>${s.name}</td><td>${s.size}</td>
+              <td>${s.size - s.unused}</td></tr>`);
+    const isrs = prof.isrs.map(i=>`
+          <tr><td>${i.name}</td><td>${i.maxUs.toFixed(1)}</td>
+              <td>${i.maxLatency}</td></tr>`);
+    const errors = Object.keys(prof.i2cErrors)
+                   .map(k=>`${k}: ${prof.i2cErrors[k]}`);
+    node.innerHTML = `
+      <p>${t.cpuLoad}: ${prof.cpuLoad.toFixed(1)}%
+         (${t.max} ${prof.cpuLoadMax.toFixed(1)}%)
+        <button class="w3-button w3-small w3-light-grey"
+                onclick="this.clearProfile(event)">${t.clearMax}</button>
+      </p>
+      <table class="w3-table w3-striped w3-small">
+        <tr><th>${t.thread}</th><th>${t.stackSize}</th><th>${t.stackUsed}</th></tr>
+        ${stacks.join("")}
+      </table>
+      <table class="w3-table w3-striped w3-small">
+        <tr><th>${t.isr}</th><th>${t.isrTime}</th><th>${t.isrLatency}</th></tr>
+        ${isrs.join("")}
+      </table>
+      <p>${t.i2cErrors}: ${errors.join(", ")}</p>`;
+    router.fixEvents(this, node);
+  }
+
   createWidgets() {
     // create dropdown
     const selectNode = this.parentNode.querySelector("#showDiagItm");
@@ -92,6 +170,15 @@ class DiagPageCls {
       this.liveDataGraph,
       this.liveDataGraph.render.bind(this.liveDataGraph)
     );
+
+    // snapshots device couldn't send or that never arrived
+    const statsNode = this.parentNode.querySelector("#diagStreamStats");
+    diagObj.onRefresh.subscribe(statsNode, ()=>{
+      const st = diagObj.streamStats,
+            t = this.translationObj[document.documentElement.lang];
+      statsNode.innerText = st.received ?
+        `${st.received} / ${st.dropped + st.lost} ${t.lost}` : "";
+    });
   }
 
   html(parentNode, lang) {
@@ -111,13 +198,18 @@ class DiagPageCls {
               <div class="w3-dropdown-hover" id="showDiagItm">
                 <button class="w3-button">${tr.showDiagItem}</button>
               </div>
+              <button class="w3-button" onclick="this.toggleProfile(event)">
+                ${tr.profile}
+              </button>
               <span class="w3-small">${tr.setVluExplain}</span>
+              <span class="w3-small w3-right" id="diagStreamStats"></span>
             </div>
             <div class="w3-border" id="diagViewContainer"
                  style="display:flex; flex-direction:row-reverse;">
               <div id="chartContainer"
                  style="min-width:55%"></div>
             </div>
+            <div id="profileContainer"></div>
             <p class="w3-text-grey">${tr.p1}</p>
           </div>
          </div>
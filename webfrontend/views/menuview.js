@@ -68,6 +68,12 @@ document.addEventListener('DOMContentLoaded', () =>{
 
     let progress = document.createElement("progress");
     progress.value = 0;
+    progress.title = {en: "Click to cancel transfer",
+                      sv: "Klicka för att avbryta överföring"}[lang];
+    progress.addEventListener("click", ()=>{
+        if (progress.value > 0 && progress.value < 1)
+            CommunicationBase.instance().cancelJob();
+    });
     menuBar.appendChild(progress);
 
     CommunicationBase.progress.onUpdate.subscribe(this, (value)=>{
@@ -190,7 +190,10 @@ class SettingsHtmlCls {
     }
 
     afterHook(parentNode, lang) {
-      if (CommunicationBase.instance().isOpen())
+      const comms = CommunicationBase.instance();
+      if (comms.deviceInfo?.fwHash)
+        document.getElementById("fwHash").value = comms.deviceInfo.fwHash;
+      else if (comms.isOpen())
         this.fetchFwHash();
     }
 };
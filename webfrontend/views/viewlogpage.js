@@ -10,6 +10,7 @@ class ViewLogCls {
   showLogItems = [];
   activeDisplayWgt = new WidgetBaseCls();
   selectMenuWgt = null;
+  deviceSessions = [];
 
 
   constructor() {
@@ -23,24 +24,68 @@ class ViewLogCls {
   async fetchLog(evt) {
     evt.target.disabled = true;
     console.log("Fetch log from device");
-    let {ok, data, totalSize, logNextAddr} = await CommunicationBase.instance().readLog();
+    const logRoot = LogRoot.instance(),
+          comms = CommunicationBase.instance();
+    // only pages written since last fetch, older firmware sends all
+    let {ok, data, totalSize} = await comms.readLogSince(logRoot.newestSeq());
+    if (!ok) {
+      ({ok, data, totalSize} = await comms.readLog());
+      data = new Uint8Array([LogRoot.SinceNewGen, ...data]);
+    }
     evt.target.disabled = false;
 
     if (!ok)
       return;
 
-    const logRoot = LogRoot.instance();
+    if (data[0] & LogRoot.SinceWrapped)
+      notifyUser({msg: this.translationObj[document.documentElement.lang].logWrapped,
+                  type: notifyTypes.Warn});
     logRoot.clear();
-    logRoot.parseLog(data, logNextAddr);
+    // device sends its pages as stored, saved files hold the records
+    logRoot.parseLog(logRoot.mergePages(data), 0);
     this.updateLogControls(`Device, read ${totalSize} bytes`);
   }
 
+  async listSessions(evt) {
+    evt.target.disabled = true;
+    const {ok, sessions} = await CommunicationBase.instance().readSessions();
+    evt.target.disabled = false;
+    if (!ok)
+      return;
+
+    this.deviceSessions = sessions;
+    const sel = document.querySelector("#deviceSessionBtn > div");
+    sel.innerHTML = this.buildDeviceSessions().join("\n");
+    router.fixEvents(this, sel);
+    document.getElementById("deviceSessionBtn").style.display = "";
+  }
+
+  async fetchSession(evt, idx) {
+    const session = this.deviceSessions[idx];
+    const logRoot = LogRoot.instance();
+    const {ok, data} = await CommunicationBase.instance().readLogRange(
+                              session.startSeq, session.endSeq);
+    if (!ok)
+      return;
+
+    if (data[0] & LogRoot.SinceWrapped)
+      notifyUser({msg: this.translationObj[document.documentElement.lang].logWrapped,
+                  type: notifyTypes.Warn});
+    // keep pages for next fetch, but only show this session
+    logRoot.mergePages(data);
+    logRoot.clear();
+    logRoot.parseLog(LogRoot.linearizePages(data.subarray(1)), 0);
+    this.updateLogControls(`Device, session ${session.number}`);
+  }
+
   async clearLog(evt) {
     console.log("Clear log in device");
     evt.target.disabled = true;
     const res = await CommunicationBase.instance().clearLogEntries();
     if (res) {
       LogRoot.instance().clear();
+      LogRoot.instance().pageCache.clear();
+      this.deviceSessions = [];
       /*if (!await CommunicationBase.instance().sendReset())
         notifyUser({msg: "Culd not reset device",
                     type: notifyTypes.Warn});*/
@@ -145,6 +190,22 @@ class ViewLogCls {
     return starts;
   }
 
+  buildDeviceSessions(lang = document.documentElement.lang) {
+    const tr = this.translationObj[lang];
+    const items = [];
+    for (let i = this.deviceSessions.length -1; i > -1; --i) {
+      const s = this.deviceSessions[i];
+      const secs = s.closed ? ` ${(s.durationMs / 1000).toFixed(0)} s` : "";
+      const braked = s.flags & SessionRoot.Flags.Braked ? ` ${tr.braked}` : "";
+      const abs = s.stats.absCount ? `, ABS ${s.stats.absCount}` : "";
+      items.push(`<button class="w3-bar-item w3-button"
+                          onclick="this.fetchSession(event, ${i})">
+                    ${tr.session} ${s.number}${secs}${braked}${abs}
+                  </button>`);
+    }
+    return items;
+  }
+
   setLogOrigin(origin) {
     const logOrigin = document.getElementById("logOrigin");
     if (logOrigin) logOrigin.innerText = origin;
@@ -159,6 +220,11 @@ class ViewLogCls {
       clearLogBtn: "Clear log in device",
       saveLogBtn: "Save log to file",
       readLogBtn: "Read log from file",
+      listSessionsBtn: "List sessions in device",
+      logWrapped: "Log wrapped around in device, some records were lost",
+      deviceSessions: "Sessions in device",
+      session: "Session",
+      braked: "braked",
       fetchedLogPoints: "Fetched log:",
       selectLog: "Select log",
       latestSession: "Latest session",
@@ -176,6 +242,11 @@ class ViewLogCls {
       clearLogBtn: "Nollställ loggminne i enhet",
       saveLogBtn: "Spara logg till fil",
       readLogBtn: "Läs logg från fil",
+      listSessionsBtn: "Lista sessioner i enhet",
+      logWrapped: "Loggen har gått runt i enheten, några poster förlorades",
+      deviceSessions: "Sessioner i enhet",
+      session: "Session",
+      braked: "bromsade",
       fetchedLogPoints: "Hämtad logg:",
       selectLog: "Välj logg",
       latestSession: "Senaste session",
@@ -202,6 +273,10 @@ class ViewLogCls {
                   onclick="this.fetchLog(event)">
             ${tr.fetchLogBtn}
           </button>
+          <button class="w3-button w3-blue w3-padding-large w3-large w3-margin-top"
+                  onclick="this.listSessions(event)">
+            ${tr.listSessionsBtn}
+          </button>
           <button class="w3-button w3-orange w3-padding-large w3-large w3-margin-top"
                   onclick="this.clearLog(event)">
             ${tr.clearLogBtn}
@@ -224,6 +299,13 @@ class ViewLogCls {
                 ${this.buildSessions(lang).join("\n")}
               </div>
             </div>
+            <div class="w3-dropdown-hover" id="deviceSessionBtn"
+                 style="${this.deviceSessions.length ? "" : "display:none"}">
+              <button class="w3-button">${tr.deviceSessions}</button>
+              <div class="w3-dropdown-content w3-bar-block w3-card-4">
+                ${this.buildDeviceSessions(lang).join("\n")}
+              </div>
+            </div>
             <div class="w3-dropdown-hover" id="showLogItm">
               <button class="w3-button">${tr.showLogItem}</button>
             </div>
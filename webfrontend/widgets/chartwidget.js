@@ -25,6 +25,8 @@ class ChartWidgetCls extends WidgetBaseCls {
   selectedType = -1;
   contex = null;
   showPnt = null;
+  xPos = [];     // x for each entry in data
+  msPerStep = 0; // 0 when entries have no time, plotted by index
 
   constructor(shownColumns, parentNode, renderXlabels = true) {
     super(shownColumns);
@@ -59,10 +61,31 @@ class ChartWidgetCls extends WidgetBaseCls {
    * @param logEntries array with each row of log entries
    */
   setData(colData, data) {
-    this.setWidth(data.length * stepFactor + vertBarWidth);
+    this._calcXPositions(data);
+    this.setWidth((this.xPos[this.xPos.length -1] || 0) + stepFactor);
     super.setData(colData, data);
   }
 
+  /**
+   * @brief place entries on x axis by their time when they have it,
+   *        shortest interval in data is one step
+   * @param {Array} data the log entries
+   */
+  _calcXPositions(data) {
+    this.msPerStep = 0;
+    if (data.length && data.every(entry=>entry.time !== undefined)) {
+      let step = Infinity;
+      for (let i = 1; i < data.length; ++i) {
+        const ms = data[i].time - data[i-1].time;
+        if (ms > 0 && ms < step) step = ms;
+      }
+      this.msPerStep = step < Infinity ? step : 0;
+    }
+
+    this.xPos = data.map((entry, i)=>origoAt.x + stepFactor * (this.msPerStep ?
+                  (entry.time - data[0].time) / this.msPerStep : i));
+  }
+
   /**
    * Set the width of canvas element
    * @param {number} width the new width
@@ -74,6 +97,9 @@ class ChartWidgetCls extends WidgetBaseCls {
 
   render() {
     //console.time("render")
+    // live data grows without setData
+    if (this.xPos.length !== this.data.length)
+      this._calcXPositions(this.data);
     this.clear();
     super.render();
     this._renderHorizontalBar();
@@ -124,11 +150,11 @@ class ChartWidgetCls extends WidgetBaseCls {
     const factor = (origoAt.y-headerHeight) / info.max;
     this.contex.beginPath();
     this.contex.lineWidth = itm.type === this.selectedType ? "4" : "2";
-    this.contex.moveTo(origoAt.x, origoAt.y - factor * itm.realVlu());
+    this.contex.moveTo(this.xPos[0], origoAt.y - factor * itm.realVlu());
     for(let i = 1; i < this.data.length; ++i) {
       itm = this.data[i].children[axelIdx];
       if (itm)
-        this.contex.lineTo(origoAt.x + i * stepFactor, origoAt.y - factor * itm.realVlu());
+        this.contex.lineTo(this.xPos[i], origoAt.y - factor * itm.realVlu());
     }
     this.contex.stroke();
   }
@@ -143,7 +169,8 @@ class ChartWidgetCls extends WidgetBaseCls {
     this.contex.lineWidth = "5";
     this.contex.moveTo(origoAt.x, origoAt.y);
     this.contex.strokeStyle = "#999";
-    this.contex.lineTo(origoAt.x + this.data.length * stepFactor, origoAt.y);
+    this.contex.lineTo((this.xPos[this.xPos.length -1] || origoAt.x) + stepFactor,
+                       origoAt.y);
     this.contex.stroke();
     this.contex.beginPath();
     this.contex.lineWidth = 1;
@@ -153,13 +180,23 @@ class ChartWidgetCls extends WidgetBaseCls {
     this.contex.textAlign = "center";
     // do the small lines for each entry
     for(let i = 0; i < this.data.length; ++i) {
-      const x = vertBarWidth + i * stepFactor;
+      const x = this.xPos[i];
       this.contex.moveTo(x, origoAt.y-2);
       this.contex.lineTo(x, origoAt.y+4);
-      if (this.renderXlabels && (i && (i % 10 == 0))) {
+      if (this.renderXlabels && !this.msPerStep && (i && (i % 10 == 0))) {
         this.contex.fillText(i, x, origoAt.y + 6);
       }
     }
+    // time in seconds from first entry each 10 steps
+    if (this.renderXlabels && this.msPerStep && this.data.length) {
+      const end = this.xPos[this.xPos.length -1],
+            msPerLabel = this.msPerStep * 10;
+      for (let x = origoAt.x + stepFactor * 10, ms = msPerLabel; x <= end;
+           x += stepFactor * 10, ms += msPerLabel)
+      {
+        this.contex.fillText(Math.round(ms / 10) / 100 + "s", x, origoAt.y + 6);
+      }
+    }
     this.contex.stroke();
   }
 
@@ -235,8 +272,10 @@ class ChartWidgetCls extends WidgetBaseCls {
   _showPoint(pnt, logItm) {
     if (this.showPnt) return;
     this.showPnt = {pnt, logItm};
-    const txt = logItm.translatedType().txt + ": " + logItm.realVlu() + logItm.unit() +
-                  " (" + pnt.entry + ")";
+    const time = this.data[pnt.entry].time,
+          txt = logItm.translatedType().txt + ": " + logItm.realVlu() + logItm.unit() +
+                  " (" + pnt.entry +
+                  (time !== undefined ? ", " + time / 1000 + "s" : "") + ")";
     const textMetrix = this.contex.measureText(txt);
     const textHeight = textMetrix.actualBoundingBoxAscent +
                      textMetrix.actualBoundingBoxDescent;
@@ -289,10 +328,16 @@ class ChartWidgetCls extends WidgetBaseCls {
     const rect = this.rootNode.getBoundingClientRect();
     pnt.x = pnt.evtX- rect.left;
     pnt.y = pnt.evtY - rect.top;
-    const x = Math.round((pnt.x - vertBarWidth) / stepFactor),
-          y = Math.floor(origoAt.y - pnt.y);
+    const y = Math.floor(origoAt.y - pnt.y);
+    // nearest entry, xPos is sorted
+    let lo = 0, hi = this.xPos.length -1;
+    while (lo < hi) {
+      const mid = (lo + hi) >> 1;
+      if (this.xPos[mid] < pnt.x) lo = mid +1; else hi = mid;
+    }
+    const x = lo > 0 && pnt.x - this.xPos[lo-1] < this.xPos[lo] - pnt.x ? lo -1 : lo;
 
-    if (!this.data[x]) return;
+    if (!this.data[x] || Math.abs(this.xPos[x] - pnt.x) > stepFactor) return;
 
     for(const itm of this.data[x].children.values()) {
       if (this.shownColumns.indexOf(itm.type) < 0)
@@ -112,6 +112,8 @@ class TableWidgetCls extends WidgetBaseCls {
         let td = document.createElement("td");
         td.className = "index";
         td.textContent = counter++;
+        if (entry.time !== undefined)
+          td.title = entry.time / 1000 + "s";
         tr.insertBefore(td, tr.firstChild);
         tbody.appendChild(tr);
       }